@@ -0,0 +1,368 @@
+/*
+        Design notes
+
+        Hot side
+
+        A log call on a hot thread does no formatting and no syscall. It claims one 64-byte record in the thread's own
+        SPSC ring, stores the TSC, a format-string id and the raw argument bytes, and publishes. That is an rdtsc, a
+        few stores and one release store.
+
+        - the format string is a template argument; its id is assigned once at static-init time, together with a
+          decoder that knows the argument types, so nothing about the format travels through the ring.
+        - arithmetic args, and value types that opt in with a `log_by_value` member typedef (Price), are memcpy'd
+          and formatted by their std::formatter on the background thread; strings (string_view / const char* /
+          std::string) are copied inline, truncated to what fits in the record, so no pointer to caller memory
+          outlives the call.
+        - a full ring drops the record and counts it. The hot thread never blocks on the logger.
+
+        Cold side
+
+        One background thread drains every ring, formats with std::format into a large batch buffer and writes it
+        through io_uring, double buffered: one buffer is being written by the kernel while the next one fills.
+        Only one write is in flight at a time, so output order is preserved.
+
+        Timestamps are converted from TSC to wall-clock on the background thread, through the shared TscClock.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <liburing.h>
+
+#include "spsc-ring.h"
+#include "tsc-clock.h"
+
+namespace Log
+{
+    template <std::size_t N>
+    struct FixedString {
+        char data[N]{};
+        constexpr FixedString(const char (&s)[N]) { std::copy_n(s, N, data); }
+        constexpr std::string_view view() const noexcept { return {data, N - 1}; }
+    };
+
+    constexpr std::size_t RECORD_ARG_BYTES = 48;
+    constexpr std::size_t MAX_FORMATS = 4096;
+
+    struct CACHE_ALIGNED Record {
+        uint64_t tsc;
+        uint16_t fmt_id;
+        uint16_t size;                      // bytes of `args` in use
+        uint32_t reserved;
+        std::byte args[RECORD_ARG_BYTES];
+    };
+    static_assert(sizeof(Record) == CACHELINE_SIZE);
+
+    template <class A>
+    concept Scalar = std::is_arithmetic_v<A> || std::is_enum_v<A> ||
+                     (std::is_trivially_copyable_v<A> && requires { typename A::log_by_value; });
+
+    // Every string-like argument is stored (and decoded) as a string_view.
+    template <class A>
+    using stored_t = std::conditional_t<Scalar<std::decay_t<A>>, std::decay_t<A>, std::string_view>;
+
+    template <class A>
+    constexpr std::size_t min_bytes() noexcept { return Scalar<A> ? sizeof(A) : 1; }
+
+    template <Scalar A>
+    inline std::byte* encode(std::byte* p, std::byte*, A v) noexcept {
+        std::memcpy(p, &v, sizeof(A));
+        return p + sizeof(A);
+    }
+    inline std::byte* encode(std::byte* p, std::byte* end, std::string_view s) noexcept {
+        const std::size_t n = std::min<std::size_t>({s.size(), static_cast<std::size_t>(end - p) - 1, 255});
+        p[0] = static_cast<std::byte>(n);
+        std::memcpy(p + 1, s.data(), n);
+        return p + 1 + n;
+    }
+
+    template <class A>
+    inline A decode(const std::byte*& p) noexcept {
+        if constexpr (Scalar<A>) {
+            A v;
+            std::memcpy(&v, p, sizeof(A));
+            p += sizeof(A);
+            return v;
+        } else {
+            const auto n = static_cast<std::size_t>(p[0]);
+            std::string_view s(reinterpret_cast<const char*>(p + 1), n);
+            p += 1 + n;
+            return s;
+        }
+    }
+
+    using FormatFn = void (*)(const Record&, std::string&);
+
+    struct Registry {
+        std::array<FormatFn, MAX_FORMATS> fns{};
+        std::atomic<uint16_t> count{0};
+
+        uint16_t add(FormatFn fn) noexcept {
+            const uint16_t id = count.fetch_add(1, std::memory_order_relaxed);
+            fns[id] = fn;
+            return id;
+        }
+    };
+    inline Registry& registry() { static Registry r; return r; }
+
+    template <FixedString Fmt, class... A>
+    void format_record(const Record& r, std::string& out) {
+        [[maybe_unused]] const std::byte* p = r.args;
+        // braced init evaluates left to right, which is the order the args were encoded in
+        std::tuple<A...> vals{decode<A>(p)...};
+        std::apply([&out](const auto&... v) {
+            std::vformat_to(std::back_inserter(out), Fmt.view(), std::make_format_args(v...));
+        }, vals);
+    }
+
+    // One id per (format, argument types); assigned before main, read as a plain load on the hot path.
+    template <FixedString Fmt, class... A>
+    struct FormatId {
+        static inline const uint16_t value = registry().add(&format_record<Fmt, A...>);
+    };
+}
+
+// ---------- the logger ----------
+class AsyncLogger {
+public:
+    static constexpr std::size_t RING_RECORDS = 4096;           // per thread, 256KB
+    static constexpr std::size_t BATCH_BYTES = 64 * 1024;       // write when a batch reaches this size
+
+    static AsyncLogger& instance() {
+        static AsyncLogger logger(STDOUT_FILENO);
+        return logger;
+    }
+
+    // Taking the clock here orders its static destruction after ours; the backend converts stamps until the end.
+    explicit AsyncLogger(int fd) : fd_(fd), clock_(TscClock::instance()) {
+        if (io_uring_queue_init(8, &ring_, 0) < 0) throw std::runtime_error("AsyncLogger: io_uring_queue_init failed");
+        for (auto& b : batch_) b.reserve(2 * BATCH_BYTES);
+        backend_ = std::thread([this] { run(); });
+    }
+
+    ~AsyncLogger() {
+        running_.store(false, std::memory_order_release);
+        backend_.join();
+        io_uring_queue_exit(&ring_);
+    }
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Hot path. Never blocks, never allocates after the thread's first call.
+    template <Log::FixedString Fmt, class... A>
+    void log(const A&... args) noexcept {
+        static_assert((Log::min_bytes<Log::stored_t<A>>() + ... + 0) <= Log::RECORD_ARG_BYTES,
+                      "log arguments do not fit in one record");
+        ThreadRing* tr = t_ring_ ? t_ring_ : register_thread();
+        Log::Record* rec = tr->ring.claim();
+        if (!rec) [[unlikely]] {
+            tr->dropped.store(tr->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        rec->tsc = TscClock::now_tsc();
+        rec->fmt_id = Log::FormatId<Fmt, Log::stored_t<A>...>::value;
+        std::byte* p = rec->args;
+        [[maybe_unused]] std::byte* const end = rec->args + Log::RECORD_ARG_BYTES;
+        ((p = Log::encode(p, end, static_cast<Log::stored_t<A>>(args))), ...);
+        rec->size = static_cast<uint16_t>(p - rec->args);
+        tr->ring.publish();
+    }
+
+    // Block until everything logged before this call is written out.
+    void flush() {
+        const uint64_t want = flush_req_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        while (flush_ack_.load(std::memory_order_acquire) < want) std::this_thread::yield();
+    }
+
+    // Send subsequent output to `fd` (after flushing what is pending to the old one).
+    void redirect(int fd) {
+        flush();
+        fd_.store(fd, std::memory_order_release);
+    }
+
+    // Records dropped because a ring was full, all threads.
+    uint64_t dropped() const {
+        std::lock_guard lk(rings_mutex_);
+        uint64_t n = 0;
+        for (const auto& r : rings_) n += r->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+private:
+    struct ThreadRing {
+        SpscRing<Log::Record, RING_RECORDS> ring;
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    ThreadRing* register_thread() {
+        auto tr = std::make_unique<ThreadRing>();
+        t_ring_ = tr.get();
+        std::lock_guard lk(rings_mutex_);
+        rings_.push_back(std::move(tr));
+        rings_gen_.fetch_add(1, std::memory_order_release);
+        return t_ring_;
+    }
+
+    void format(const Log::Record& r, std::string& out) {
+        const uint64_t ns = clock_.tsc_to_wall_ns(r.tsc);
+        std::format_to(std::back_inserter(out), "{}.{:09} ", ns / 1'000'000'000, ns % 1'000'000'000);
+        Log::registry().fns[r.fmt_id](r, out);
+        out.push_back('\n');
+    }
+
+    // Hand batch_[cur_] to the kernel; waits for the previous write first so output stays ordered.
+    void submit() {
+        std::string& b = batch_[cur_];
+        if (b.empty()) return;
+        reap();
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring_);
+        io_uring_prep_write(sqe, fd_.load(std::memory_order_acquire), b.data(), static_cast<unsigned>(b.size()), -1);
+        io_uring_submit(&ring_);
+        inflight_ = true;
+        cur_ ^= 1;
+        batch_[cur_].clear();
+    }
+
+    void reap() {
+        if (!inflight_) return;
+        io_uring_cqe* cqe = nullptr;
+        while (io_uring_wait_cqe(&ring_, &cqe) < 0) {}
+        const std::string& done = batch_[cur_ ^ 1];
+        const int res = cqe->res;
+        io_uring_cqe_seen(&ring_, cqe);
+        inflight_ = false;
+        // short write (pipe/terminal) - finish synchronously, we are the cold thread
+        std::size_t off = res > 0 ? static_cast<std::size_t>(res) : 0;
+        while (off < done.size()) {
+            const ssize_t w = ::write(fd_.load(std::memory_order_acquire), done.data() + off, done.size() - off);
+            if (w <= 0) break;
+            off += static_cast<std::size_t>(w);
+        }
+    }
+
+    void run() {
+        std::vector<ThreadRing*> rings;
+        uint64_t gen = ~0ull;
+        for (;;) {
+            const bool stopping = !running_.load(std::memory_order_acquire);
+            const uint64_t flush_req = flush_req_.load(std::memory_order_acquire);
+            if (rings_gen_.load(std::memory_order_acquire) != gen) {
+                std::lock_guard lk(rings_mutex_);
+                gen = rings_gen_.load(std::memory_order_relaxed);
+                rings.clear();
+                for (auto& r : rings_) rings.push_back(r.get());
+            }
+
+            bool any = false;
+            for (ThreadRing* tr : rings) {
+                while (const Log::Record* rec = tr->ring.front()) {
+                    format(*rec, batch_[cur_]);
+                    tr->ring.pop();
+                    any = true;
+                    if (batch_[cur_].size() >= BATCH_BYTES) submit();
+                }
+            }
+            if (any) continue;
+
+            // idle: push out the partial batch, then acknowledge flushes that were requested before this pass
+            submit();
+            reap();
+            flush_ack_.store(flush_req, std::memory_order_release);
+            if (stopping) return;
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    static inline thread_local ThreadRing* t_ring_ = nullptr;
+
+    std::atomic<int> fd_;
+    io_uring ring_{};
+    std::string batch_[2];
+    int cur_{0};
+    bool inflight_{false};
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<ThreadRing>> rings_;
+    std::atomic<uint64_t> rings_gen_{0};
+
+    std::atomic<bool> running_{true};
+    std::atomic<uint64_t> flush_req_{0};
+    std::atomic<uint64_t> flush_ack_{0};
+
+    TscClock& clock_;
+
+    std::thread backend_;
+};
+
+// Format string must be a literal: HFT_LOG("px={} qty={}", px, qty);
+#define HFT_LOG(fmt, ...) AsyncLogger::instance().log<fmt>(__VA_ARGS__)
+
+// Two threads log into a temp file; returns the messages (timestamps stripped) in file order, '|' separated.
+std::string ASYNC_LOGGER_Test()
+{
+    char path[] = "/tmp/hft-async-logger-XXXXXX";
+    const int fd = mkstemp(path);
+    AsyncLogger& log = AsyncLogger::instance();
+    log.redirect(fd);
+
+    HFT_LOG("order id={} px={} side={}", uint64_t{7}, 101.25, 'B');
+    HFT_LOG("payload {}", std::string_view("hello"));
+    std::thread t([] { HFT_LOG("from thread {}", 2); });
+    t.join();
+    HFT_LOG("done");
+    log.flush();
+    log.redirect(STDOUT_FILENO);
+    close(fd);
+
+    std::ifstream f(path);
+    std::string line, ret;
+    std::vector<std::string> lines;
+    while (std::getline(f, line)) lines.push_back(line.substr(line.find(' ') + 1));
+    unlink(path);
+    // threads drain in ring order, so sort for a stable answer
+    std::sort(lines.begin(), lines.end());
+    for (const auto& l : lines) ret += (ret.empty() ? "" : "|") + l;
+    return ret;
+}
+
+// Hot-side cost per call. Batches stay below the ring size so nothing is dropped and only the enqueue is timed.
+void ASYNC_LOGGER_BENCH()
+{
+    AsyncLogger& log = AsyncLogger::instance();
+    const int devnull = open("/dev/null", O_WRONLY);
+    log.redirect(devnull);
+
+    constexpr int BATCH = 2048, ROUNDS = 500;
+    uint64_t ns = 0;
+    for (int r = 0; r < ROUNDS; ++r) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < BATCH; ++i) {
+            HFT_LOG("tick instr={} px={} qty={} ts={}", uint32_t(i), 101.25 + i, uint32_t(10), uint64_t(r));
+        }
+        const auto t1 = std::chrono::steady_clock::now();
+        ns += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        log.flush();
+    }
+    log.redirect(STDOUT_FILENO);
+    close(devnull);
+    std::cout << "ASYNC_LOGGER_BENCH " << static_cast<double>(ns) / (BATCH * ROUNDS) << " ns/log call (hot side), dropped "
+              << log.dropped() << "\n";
+}
@@ -0,0 +1,518 @@
+/*
+        Design notes
+
+        Coroutine event loop over io_uring
+
+        The io_uring tests are hand-rolled loops: post an SQE, wait, switch on user_data, re-post. That does not scale
+        to many sessions, timers and recovery traffic on one thread. Here each flow is a coroutine:
+
+            Coro::Task<void> session(int fd) {
+                char buf[256];
+                while (int n = co_await Coro::recv(fd, buf, sizeof(buf))) { ... co_await Coro::send(fd, out, len); }
+            }
+
+        - every co_await on I/O prepares one SQE whose user_data is the awaiter (it lives in the suspended frame),
+          and suspends. Nothing is submitted until the coroutines that are running have suspended, so all ops
+          issued while handling one batch of completions go to the kernel in a single io_uring_enter.
+        - IoLoop::run() reaps completions in batches, stores cqe->res in the awaiter and resumes the coroutine
+          directly, on the loop's thread. Run the loop on a HotThread and every coroutine runs pinned.
+        - sleep_until(tsc) takes a TscClock deadline and becomes an IORING_OP_TIMEOUT for the remaining time;
+          a deadline already in the past does not suspend at all.
+        - Task<T> is lazy and resumes its awaiter by symmetric transfer, so chains of awaited tasks cost no stack and
+          no trip through the loop. Root tasks are handed to spawn() and free themselves when they finish.
+        - coroutine frames come from a FixedPool carved out of a NumaArena owned by the loop, never from the heap.
+          Slots are FRAME_BYTES; a frame that does not fit, or an exhausted pool, makes the coroutine call return
+          an empty Task (no throw, no allocation). spawn() refuses empty tasks; check `if (!task)` before awaiting
+          one where the pool can run dry. Size max_frames for the most coroutines alive at once.
+        - exceptions are not part of the hot path: an exception escaping a coroutine terminates.
+*/
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <liburing.h>
+#include <sys/socket.h>
+
+#include "custom-allocator.h"
+#include "hot-thread.h"
+#include "tsc-clock.h"
+
+namespace Coro {
+
+class IoLoop;
+template <class T> class Task;
+
+struct LoopOptions {
+    unsigned entries = 256;          // SQ size; also the most ops the loop prepares before submitting
+    std::size_t max_frames = 1024;   // coroutines alive at once
+    int numa_node = 0;               // where the frame arena lives
+    bool busy_poll = false;          // spin on the CQ instead of sleeping in io_uring_enter
+};
+
+namespace detail {
+    // What the loop sees of a pending op: where to put the result and whom to resume.
+    struct Completion {
+        int res = 0;
+        std::coroutine_handle<> waiter;
+    };
+
+    struct alignas(16) Frame { std::byte bytes[1024]; };
+    inline constexpr std::size_t FRAME_HEADER = 16;   // owning loop, keeps the frame 16-byte aligned
+
+    inline thread_local IoLoop* t_loop = nullptr;
+
+    void* alloc_frame(std::size_t n) noexcept;
+    void free_frame(void* p) noexcept;
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;   // awaiting coroutine, if any
+        IoLoop* owner = nullptr;                // set by spawn(): free the frame on completion
+        std::coroutine_handle<> self;
+        PromiseBase* prev = nullptr;            // spawned roots, so the loop can destroy what never finished
+        PromiseBase* next = nullptr;
+    };
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept;
+        void await_resume() const noexcept {}
+    };
+}
+
+// ---------- loop ----------
+class IoLoop {
+public:
+    static constexpr std::size_t FRAME_BYTES = sizeof(detail::Frame) - detail::FRAME_HEADER;
+    static constexpr unsigned REAP_BATCH = 64;
+
+    explicit IoLoop(LoopOptions opt = {})
+    : opt_(opt),
+      arena_(opt.max_frames * FramePool::slot_bytes(), opt.numa_node),
+      frames_(arena_, opt.max_frames)
+    {
+        if (io_uring_queue_init(opt_.entries, &ring_, 0) < 0) throw std::runtime_error("IoLoop: io_uring_queue_init failed");
+        detail::t_loop = this;   // coroutines created on this thread draw frames from us
+    }
+
+    IoLoop(const IoLoop&) = delete;
+    IoLoop& operator=(const IoLoop&) = delete;
+
+    ~IoLoop() {
+        // Kernel first: after this no completion can land in a frame we are about to free.
+        io_uring_queue_exit(&ring_);
+        while (roots_) {
+            detail::PromiseBase* p = roots_;
+            unlink(p);
+            p->self.destroy();
+        }
+        if (detail::t_loop == this) detail::t_loop = nullptr;
+    }
+
+    // Start `t` now (it runs until its first suspension) and let it own itself. False for an empty task.
+    template <class T>
+    bool spawn(Task<T>&& t) noexcept {
+        auto h = t.release();
+        if (!h) return false;
+        detail::PromiseBase& p = h.promise();
+        p.owner = this;
+        p.self = h;
+        p.next = roots_;
+        if (roots_) roots_->prev = &p;
+        roots_ = &p;
+        ++live_;
+        h.resume();
+        return true;
+    }
+
+    // Reap and resume until every spawned task finished or stop() was called. Must run on one thread.
+    void run() {
+        detail::t_loop = this;
+        stop_ = false;
+        io_uring_cqe* cqes[REAP_BATCH];
+        detail::Completion* done[REAP_BATCH];
+        while (live_ > 0 && !stop_) {
+            if (opt_.busy_poll) io_uring_submit(&ring_);
+            else io_uring_submit_and_wait(&ring_, 1);
+
+            const unsigned n = io_uring_peek_batch_cqe(&ring_, cqes, REAP_BATCH);
+            for (unsigned i = 0; i < n; ++i) {
+                done[i] = static_cast<detail::Completion*>(io_uring_cqe_get_data(cqes[i]));
+                done[i]->res = cqes[i]->res;
+            }
+            // hand the CQ slots back before user code runs and issues more ops
+            io_uring_cq_advance(&ring_, n);
+            for (unsigned i = 0; i < n; ++i) done[i]->waiter.resume();
+        }
+    }
+
+    void stop() noexcept { stop_ = true; }
+
+    // Next free SQE, submitting what is queued if the SQ is full. nullptr only if the kernel refuses to take any.
+    io_uring_sqe* sqe() noexcept {
+        io_uring_sqe* s = io_uring_get_sqe(&ring_);
+        if (!s) [[unlikely]] {
+            io_uring_submit(&ring_);
+            s = io_uring_get_sqe(&ring_);
+        }
+        return s;
+    }
+
+    std::size_t live_tasks() const noexcept { return live_; }
+    std::size_t frames_in_use() const noexcept { return frames_in_use_; }
+    uint64_t frame_failures() const noexcept { return frame_failures_; }
+    io_uring& ring() noexcept { return ring_; }
+
+private:
+    using FramePool = FixedPool<detail::Frame>;
+
+    friend void* detail::alloc_frame(std::size_t) noexcept;
+    friend void detail::free_frame(void*) noexcept;
+    friend struct detail::FinalAwaiter;
+
+    void unlink(detail::PromiseBase* p) noexcept {
+        if (p->prev) p->prev->next = p->next;
+        else roots_ = p->next;
+        if (p->next) p->next->prev = p->prev;
+        p->prev = p->next = nullptr;
+    }
+
+    void task_done(detail::PromiseBase* p) noexcept {
+        unlink(p);
+        --live_;
+    }
+
+    LoopOptions opt_;
+    NumaArena arena_;
+    FramePool frames_;
+    io_uring ring_{};
+    detail::PromiseBase* roots_ = nullptr;
+    std::size_t live_ = 0;
+    std::size_t frames_in_use_ = 0;
+    uint64_t frame_failures_ = 0;
+    bool stop_ = false;
+};
+
+namespace detail {
+    inline void* alloc_frame(std::size_t n) noexcept {
+        IoLoop* loop = t_loop;
+        if (!loop) return nullptr;
+        Frame* f = n <= IoLoop::FRAME_BYTES ? loop->frames_.allocate() : nullptr;
+        if (!f) [[unlikely]] {
+            ++loop->frame_failures_;
+            return nullptr;
+        }
+        ++loop->frames_in_use_;
+        *reinterpret_cast<IoLoop**>(f->bytes) = loop;
+        return f->bytes + FRAME_HEADER;
+    }
+
+    inline void free_frame(void* p) noexcept {
+        auto* f = reinterpret_cast<Frame*>(static_cast<std::byte*>(p) - FRAME_HEADER);
+        IoLoop* loop = *reinterpret_cast<IoLoop**>(f->bytes);
+        --loop->frames_in_use_;
+        loop->frames_.deallocate(f);
+    }
+
+    template <class P>
+    std::coroutine_handle<> FinalAwaiter::await_suspend(std::coroutine_handle<P> h) noexcept {
+        PromiseBase& p = h.promise();
+        if (p.continuation) return p.continuation;
+        if (IoLoop* loop = p.owner) {
+            loop->task_done(&p);
+            h.destroy();
+        }
+        return std::noop_coroutine();
+    }
+
+    template <class T>
+    struct Result {
+        T value{};
+        void return_value(T v) noexcept { value = std::move(v); }
+        T take() noexcept { return std::move(value); }
+    };
+    template <>
+    struct Result<void> {
+        void return_void() noexcept {}
+        void take() noexcept {}
+    };
+}
+
+// ---------- task ----------
+template <class T = void>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : detail::PromiseBase, detail::Result<T> {
+        Task get_return_object() noexcept { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        static Task get_return_object_on_allocation_failure() noexcept { return Task{}; }
+        static void* operator new(std::size_t n) noexcept { return detail::alloc_frame(n); }
+        static void operator delete(void* p) noexcept { detail::free_frame(p); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        detail::FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+    using handle = std::coroutine_handle<promise_type>;
+
+    Task() noexcept = default;
+    Task(Task&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Task& operator=(Task&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    ~Task() { if (h_) h_.destroy(); }
+
+    explicit operator bool() const noexcept { return static_cast<bool>(h_); }
+    handle release() noexcept { return std::exchange(h_, {}); }
+
+    // co_await runs the task to completion and resumes us by symmetric transfer.
+    // An empty task (frame allocation failed) completes immediately with T{}.
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle h;
+            bool await_ready() const noexcept { return !h; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> c) noexcept {
+                h.promise().continuation = c;
+                return h;
+            }
+            T await_resume() noexcept {
+                if constexpr (std::is_void_v<T>) { if (h) h.promise().take(); }
+                else { return h ? h.promise().take() : T{}; }
+            }
+        };
+        return Awaiter{h_};
+    }
+
+private:
+    explicit Task(handle h) noexcept : h_(h) {}
+    handle h_{};
+};
+
+// ---------- awaitables ----------
+// One SQE, prepared by `prep`, completing with cqe->res. Runs on the current thread's loop.
+template <class Prep>
+struct IoOp : detail::Completion {
+    Prep prep;
+    explicit IoOp(Prep p) : prep(std::move(p)) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        io_uring_sqe* s = detail::t_loop->sqe();
+        if (!s) [[unlikely]] {
+            res = -EBUSY;
+            return false;
+        }
+        prep(s);
+        io_uring_sqe_set_data(s, static_cast<detail::Completion*>(this));
+        waiter = h;
+        return true;
+    }
+    int await_resume() const noexcept { return res; }
+};
+
+// Bytes received, 0 on orderly shutdown, -errno on failure.
+inline auto recv(int fd, void* buf, std::size_t len, int flags = 0) noexcept {
+    return IoOp([=](io_uring_sqe* s) { io_uring_prep_recv(s, fd, buf, len, flags); });
+}
+
+// Bytes sent (may be short on a stream socket), -errno on failure.
+inline auto send(int fd, const void* buf, std::size_t len, int flags = MSG_NOSIGNAL) noexcept {
+    return IoOp([=](io_uring_sqe* s) { io_uring_prep_send(s, fd, buf, len, flags); });
+}
+
+// Round trip through the ring with no I/O; measures the runtime itself.
+inline auto nop() noexcept {
+    return IoOp([](io_uring_sqe* s) { io_uring_prep_nop(s); });
+}
+
+// Resume at or after TscClock tick `deadline_tsc`.
+struct SleepUntil : detail::Completion {
+    uint64_t deadline;
+    __kernel_timespec ts{};
+
+    bool await_ready() const noexcept { return TscClock::now_tsc() >= deadline; }
+    bool await_suspend(std::coroutine_handle<> h) noexcept {
+        const uint64_t now = TscClock::now_tsc();
+        if (now >= deadline) return false;
+        // round up: a timeout a fraction of a ns short would resume before the deadline
+        const uint64_t ns = TscClock::instance().ticks_to_ns(deadline - now) + 1;
+        ts.tv_sec = static_cast<long long>(ns / 1'000'000'000);
+        ts.tv_nsec = static_cast<long long>(ns % 1'000'000'000);
+        io_uring_sqe* s = detail::t_loop->sqe();
+        if (!s) [[unlikely]] return false;
+        io_uring_prep_timeout(s, &ts, 0, 0);
+        io_uring_sqe_set_data(s, static_cast<detail::Completion*>(this));
+        waiter = h;
+        return true;
+    }
+    void await_resume() const noexcept {}
+};
+
+inline SleepUntil sleep_until(uint64_t deadline_tsc) noexcept { return SleepUntil{{}, deadline_tsc}; }
+
+} // namespace Coro
+
+// Echo session over a socketpair driven entirely by coroutines on a pinned loop thread, plus a nested Task<int>,
+// a timer, and a frame pool that runs dry. Nothing asserts how long anything took: the tasks that only need to
+// suspend wait one loop tick (a nop completes as soon as it is submitted), and the timer is only checked to resume
+// at or after its deadline, which a loaded host can only make later.
+std::string CORO_LOOP_Test()
+{
+    std::stringstream ss;
+    HotThreadConfig cfg;
+    cfg.name = "coro-loop";
+    cfg.cpu = first_allowed_cpu();
+    cfg.require_isolated = false;
+    cfg.require_realtime = false;
+    HotThread t(cfg, [&ss] {
+        int sv[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        Coro::LoopOptions opt;
+        opt.max_frames = 4;
+        Coro::IoLoop loop(opt);
+        TscClock& clock = TscClock::instance();
+
+        auto echo_upper = [](int fd) -> Coro::Task<> {
+            char buf[64];
+            for (;;) {
+                const int n = co_await Coro::recv(fd, buf, sizeof(buf));
+                if (n <= 0) break;
+                for (int i = 0; i < n; ++i) buf[i] = static_cast<char>(std::toupper(static_cast<unsigned char>(buf[i])));
+                co_await Coro::send(fd, buf, static_cast<std::size_t>(n));
+            }
+            close(fd);
+        };
+        auto add_later = [](int a, int b) -> Coro::Task<int> {
+            co_await Coro::nop();
+            co_return a + b;
+        };
+        auto client = [&](int fd) -> Coro::Task<> {
+            const char* msgs[] = {"ping", "order", "cancel"};
+            char buf[64];
+            for (const char* m : msgs) {
+                co_await Coro::send(fd, m, std::strlen(m));
+                const int n = co_await Coro::recv(fd, buf, sizeof(buf));
+                ss << std::string(buf, static_cast<std::size_t>(n)) << (m == msgs[2] ? " " : "|");
+            }
+            shutdown(fd, SHUT_WR);
+
+            const uint64_t deadline = TscClock::now_tsc() + static_cast<uint64_t>(clock.ticks_per_ns() * 100'000);
+            co_await Coro::sleep_until(deadline);
+            const bool on_time = TscClock::now_tsc() >= deadline;
+            const int sum = co_await add_later(2, 3);
+            ss << "sum=" << sum << " slept=" << on_time;
+            close(fd);
+        };
+
+        loop.spawn(echo_upper(sv[1]));
+        loop.spawn(client(sv[0]));
+        // echo and client hold two of the four frames: the first two idles take the rest, the third is refused.
+        // The idles finish on the loop's first tick, long before the client's add_later needs a frame.
+        auto idle = []() -> Coro::Task<> { co_await Coro::nop(); };
+        loop.spawn(idle());
+        const bool refused = loop.spawn(idle()) && !loop.spawn(idle());
+        loop.run();
+        ss << " frames=" << loop.frames_in_use() << " refused=" << refused;
+    });
+    t.join();
+    return ss.str();
+}
+
+// Per-op cost of the coroutine runtime against the equivalent handwritten loops on the same ring setup.
+void CORO_LOOP_BENCH()
+{
+    constexpr int N = 200'000;
+    auto report = [](const char* what, std::chrono::steady_clock::time_point t0, int n) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "CORO_LOOP_BENCH " << what << ": " << static_cast<double>(ns) / n << " ns/op\n";
+    };
+
+    // NOP: pure submission/completion/resume overhead
+    {
+        io_uring ring;
+        io_uring_queue_init(256, &ring, 0);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            io_uring_prep_nop(io_uring_get_sqe(&ring));
+            io_uring_submit_and_wait(&ring, 1);
+            io_uring_cqe* cqe;
+            io_uring_peek_cqe(&ring, &cqe);
+            io_uring_cqe_seen(&ring, cqe);
+        }
+        report("handwritten nop", t0, N);
+        io_uring_queue_exit(&ring);
+    }
+    {
+        Coro::IoLoop loop;
+        auto body = []() -> Coro::Task<> { for (int i = 0; i < N; ++i) co_await Coro::nop(); };
+        const auto t0 = std::chrono::steady_clock::now();
+        loop.spawn(body());
+        loop.run();
+        report("coroutine nop", t0, N);
+    }
+
+    // 64-byte ping-pong over a socketpair
+    char msg[64] = {}, a_buf[64], b_buf[64];
+    {
+        int sv[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        io_uring ring;
+        io_uring_queue_init(256, &ring, 0);
+        auto wait2 = [&ring] {
+            io_uring_submit_and_wait(&ring, 2);
+            for (int got = 0; got < 2;) {
+                io_uring_cqe* cqe;
+                if (io_uring_wait_cqe(&ring, &cqe) == 0) { io_uring_cqe_seen(&ring, cqe); ++got; }
+            }
+        };
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            io_uring_prep_send(io_uring_get_sqe(&ring), sv[0], msg, sizeof(msg), 0);
+            io_uring_prep_recv(io_uring_get_sqe(&ring), sv[1], b_buf, sizeof(b_buf), MSG_WAITALL);
+            wait2();
+            io_uring_prep_send(io_uring_get_sqe(&ring), sv[1], b_buf, sizeof(b_buf), 0);
+            io_uring_prep_recv(io_uring_get_sqe(&ring), sv[0], a_buf, sizeof(a_buf), MSG_WAITALL);
+            wait2();
+        }
+        report("handwritten ping-pong", t0, N);
+        io_uring_queue_exit(&ring);
+        close(sv[0]);
+        close(sv[1]);
+    }
+    {
+        int sv[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+        Coro::IoLoop loop;
+        auto client = [&]() -> Coro::Task<> {
+            for (int i = 0; i < N; ++i) {
+                co_await Coro::send(sv[0], msg, sizeof(msg), 0);
+                co_await Coro::recv(sv[0], a_buf, sizeof(a_buf), MSG_WAITALL);
+            }
+        };
+        auto server = [&]() -> Coro::Task<> {
+            for (int i = 0; i < N; ++i) {
+                co_await Coro::recv(sv[1], b_buf, sizeof(b_buf), MSG_WAITALL);
+                co_await Coro::send(sv[1], b_buf, sizeof(b_buf), 0);
+            }
+        };
+        const auto t0 = std::chrono::steady_clock::now();
+        loop.spawn(client());
+        loop.spawn(server());
+        loop.run();
+        report("coroutine ping-pong", t0, N);
+        close(sv[0]);
+        close(sv[1]);
+    }
+}
@@ -29,6 +29,13 @@
 
         Prefaulting touches every 4KB to avoid demand faults.
 
+        Prefault is split across worker threads pinned to the arena's node (first touch on the right node, and the
+        page-fault path scales with cores). Each worker first asks the kernel to populate its chunk with
+        MADV_POPULATE_WRITE (5.14+), which skips the per-page fault entirely, and only falls back to touching pages.
+        When a touched 2MB-aligned page turns out resident end to end (THP backed it), the rest of it is skipped.
+        MAP_POPULATE is not used: numa_alloc_onnode mmaps before it mbinds, so MAP_POPULATE would fault pages in
+        under the default policy, possibly on the wrong node.
+
         No munmap/mprotect during runtime → avoids TLB shootdowns.
 
         Keep pools long-lived; don’t frequently resize.
@@ -43,23 +50,63 @@
 
         For the absolute lowest jitter, allocate and free on the same thread.
         If another thread must free, implement a per-owner MPSC “return queue”: other threads push returned nodes there, and the owner periodically drains into its freelist. This prevents contended CAS on a shared stack and avoids ABA hazards.
+
+        Guard mode (debug only)
+
+        FixedPool takes a compile-time guard policy. PoolNoGuard (release) adds nothing: every guard hook sits behind
+        `if constexpr`, so allocate()/deallocate() are the same instructions as without the policy.
+
+        PoolGuardChecked (Debug config, or -DHFT_POOL_GUARD) adds canary words before and after each payload,
+        an allocated-bitmap that catches double frees and pointers that never came from this pool, and fills freed
+        payloads with a poison byte that is verified on the next allocate (write-after-free).
+
+        Under -fsanitize=address the pool also poisons free payloads manually, so ASan reports use-after-free on
+        pool memory just as it would for heap memory.
 */
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <chrono>
 #include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
 #include <new>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <vector>
 #include <unistd.h>
 #include <sys/mman.h>
 #include <numa.h>
 #include <numaif.h>
 
+#include "fixed-price.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define HFT_POOL_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define HFT_POOL_ASAN 1
+#endif
+#endif
+
+#ifdef HFT_POOL_ASAN
+#include <sanitizer/asan_interface.h>
+#define POOL_ASAN_POISON(addr, size)   ASAN_POISON_MEMORY_REGION((addr), (size))
+#define POOL_ASAN_UNPOISON(addr, size) ASAN_UNPOISON_MEMORY_REGION((addr), (size))
+#else
+#define POOL_ASAN_POISON(addr, size)   ((void)(addr), (void)(size))
+#define POOL_ASAN_UNPOISON(addr, size) ((void)(addr), (void)(size))
+#endif
 
 // ---------- cacheline helpers ----------
 #ifndef CACHELINE_SIZE
@@ -71,13 +118,123 @@
 template <class T>
 concept PoolStorable = std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>;
 
+// ---------- prefault ----------
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+
+struct PrefaultOptions {
+    unsigned threads = 0;           // 0: one per CPU of the node (bounded by arena size), 1: calling thread only
+    bool kernel_populate = true;    // try MADV_POPULATE_WRITE before touching pages by hand
+};
+
+namespace Prefault
+{
+    constexpr std::size_t SMALL_PAGE = 4096;
+    constexpr std::size_t HUGE_PAGE = 2 * 1024 * 1024;
+    constexpr std::size_t MIN_CHUNK = 64ULL * 1024 * 1024;   // below this per worker, a thread costs more than it saves
+
+    // THP can back madvise(MADV_HUGEPAGE) regions on this box.
+    inline bool thp_available() {
+        static const bool on = [] {
+            std::ifstream f("/sys/kernel/mm/transparent_hugepage/enabled");
+            std::string s;
+            std::getline(f, s);
+            return s.find("[always]") != std::string::npos || s.find("[madvise]") != std::string::npos;
+        }();
+        return on;
+    }
+
+    inline bool resident(const std::byte* page) {
+        unsigned char v = 0;
+        return mincore(const_cast<std::byte*>(page), SMALL_PAGE, &v) == 0 && (v & 1);
+    }
+
+    // Fault in [b, b + n). With `huge` set, a 2MB-aligned page whose last 4KB is already resident after the first
+    // touch was backed by a huge page, so the other 511 touches are skipped.
+    inline void touch(std::byte* b, std::size_t n, bool huge, bool kernel_populate) {
+        if (kernel_populate && madvise(b, n, MADV_POPULATE_WRITE) == 0) return;
+        volatile std::byte* p = b;
+        for (std::size_t i = 0; i < n; ) {
+            p[i] = std::byte{0};
+            const bool aligned = (reinterpret_cast<std::uintptr_t>(b + i) & (HUGE_PAGE - 1)) == 0;
+            if (huge && aligned && i + HUGE_PAGE <= n && resident(b + i + HUGE_PAGE - SMALL_PAGE)) {
+                i += HUGE_PAGE;
+            } else {
+                i += SMALL_PAGE;
+            }
+        }
+    }
+
+    inline std::vector<int> node_cpus(int node) {
+        std::vector<int> cpus;
+        bitmask* mask = numa_allocate_cpumask();
+        if (numa_node_to_cpus(node, mask) == 0) {
+            for (unsigned c = 0; c < mask->size; ++c) {
+                if (numa_bitmask_isbitset(mask, c)) cpus.push_back(static_cast<int>(c));
+            }
+        }
+        numa_free_cpumask(mask);
+        return cpus;
+    }
+
+    // Prefault [base, base + size) from workers pinned to `node`. Returns the wall time spent in ns.
+    inline uint64_t run(void* base, std::size_t size, int node, bool huge, PrefaultOptions opt) {
+        const auto t0 = std::chrono::steady_clock::now();
+        auto* b = static_cast<std::byte*>(base);
+
+        std::vector<int> cpus = node_cpus(node);
+        std::size_t workers = opt.threads ? opt.threads : std::max<std::size_t>(cpus.size(), 1);
+        workers = std::max<std::size_t>(1, std::min(workers, size / MIN_CHUNK));
+
+        if (workers == 1) {
+            touch(b, size, huge, opt.kernel_populate);
+        } else {
+            // chunks end on 2MB boundaries so no huge page is split between two workers. numa_alloc_onnode only
+            // page-aligns the base, so offsets are taken from the 2MB boundary at or below it, `lead` bytes back.
+            const std::size_t lead = reinterpret_cast<std::uintptr_t>(b) & (HUGE_PAGE - 1);
+            const std::size_t span = lead + size;
+            const std::size_t chunk = (span / workers + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+            std::vector<std::thread> pool;
+            pool.reserve(workers);
+            for (std::size_t w = 0; w < workers && w * chunk < span; ++w) {
+                const std::size_t lo = std::max(w * chunk, lead);
+                const std::size_t hi = std::min((w + 1) * chunk, span);
+                const int cpu = cpus.empty() ? -1 : cpus[w % cpus.size()];
+                pool.emplace_back([=] {
+                    if (cpu >= 0) {
+                        cpu_set_t set;
+                        CPU_ZERO(&set);
+                        CPU_SET(cpu, &set);
+                        (void)sched_setaffinity(0, sizeof(set), &set);
+                    }
+                    touch(b + (lo - lead), hi - lo, huge, opt.kernel_populate);
+                });
+            }
+            for (auto& t : pool) t.join();
+        }
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - t0).count());
+    }
+}
+
 // ---------- NUMA arena ----------
+// Throws unless `node` is one of this box's NUMA nodes; numa_node_of_cpu() gives -1 for a cpu that does not exist,
+// and libnuma crashes on it further down.
+inline void require_numa_node(int node, const char* who) {
+    if (node < 0 || node > numa_max_node())
+        throw std::runtime_error(std::string(who) + ": no NUMA node " + std::to_string(node) + " (nodes 0.." +
+                                 std::to_string(numa_max_node()) + ")");
+}
+
 class NumaArena {
 public:
-    NumaArena(std::size_t bytes, int numa_node, bool prefer_thp = true)
+    NumaArena(std::size_t bytes, int numa_node, bool prefer_thp = true, PrefaultOptions prefault = {})
     : size_(round_up(bytes, page_size())), node_(numa_node)
     {
-        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        // MCL_ONFAULT: lock pages as they are faulted instead of populating new mappings inside mmap(), which
+        // would happen before mbind() and outside our NUMA-local, parallel prefault.
+        if (mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) != 0) {
             // Not fatal for all systems, but strongly recommended
             // You can throw if you prefer hard-fail:
             // throw std::runtime_error("mlockall failed");
@@ -85,6 +242,7 @@ public:
 
         if (numa_available() < 0)
             throw std::runtime_error("libnuma: NUMA not available");
+        require_numa_node(node_, "NumaArena");
 
         // Allocate on a specific NUMA node. This is anonymous, page-aligned memory.
 #if 1
@@ -95,7 +253,7 @@ public:
 
         // Hint kernel for huge pages (transparent HP); avoids many TLB misses.
         if (prefer_thp) {
-            (void)madvise(base_, size_, MADV_HUGEPAGE);
+            thp_ = madvise(base_, size_, MADV_HUGEPAGE) == 0 && Prefault::thp_available();
         }
 #else
         /*
@@ -122,7 +280,7 @@ public:
 #endif
 
         // Prefault: touch each page so there are no first-touch faults at runtime.
-        prefault_pages();
+        prefault_pages(prefault);
     }
 
     ~NumaArena() {
@@ -135,6 +293,8 @@ public:
     void* base() const noexcept { return base_; }
     std::size_t size() const noexcept { return size_; }
     int node() const noexcept { return node_; }
+    bool thp() const noexcept { return thp_; }
+    uint64_t prefault_ns() const noexcept { return prefault_ns_; }
 
 private:
     static std::size_t page_size() {
@@ -144,36 +304,175 @@ private:
     static std::size_t round_up(std::size_t x, std::size_t a) {
         return (x + a - 1) & ~(a - 1);
     }
-    void prefault_pages() {
-        constexpr std::size_t stride = 4096; // touch per 4KB; THP/HP will coalesce under the hood
-        volatile std::byte* p = static_cast<std::byte*>(base_);
-        for (std::size_t i = 0; i < size_; i += stride) {
-            p[i] = std::byte{0};
-        }
+    void prefault_pages(PrefaultOptions opt) {
+        prefault_ns_ = Prefault::run(base_, size_, node_, thp_, opt);
     }
 
     void* base_{nullptr};
     std::size_t size_{0};
     int node_{0};
+    bool thp_{false};
+    uint64_t prefault_ns_{0};
+};
+
+// ---------- Pool guard policies ----------
+enum class PoolViolation {
+    ForeignPointer,   // deallocate() of an address that is not a slot of this pool
+    DoubleFree,       // deallocate() of a slot that is already free
+    CanaryClobbered,  // write past either end of the payload
+    WriteAfterFree,   // poison pattern of a free slot changed before it was handed out again
+    FreelistCorrupt,  // allocate() popped a slot the bitmap says is still live
 };
 
+inline const char* to_string(PoolViolation v) noexcept {
+    switch (v) {
+        case PoolViolation::ForeignPointer:  return "foreign_pointer";
+        case PoolViolation::DoubleFree:      return "double_free";
+        case PoolViolation::CanaryClobbered: return "canary_clobbered";
+        case PoolViolation::WriteAfterFree:  return "write_after_free";
+        case PoolViolation::FreelistCorrupt: return "freelist_corrupt";
+    }
+    return "unknown";
+}
+
+// Release policy: empty, every hook is compiled out with `if constexpr`.
+struct PoolNoGuard {
+    static constexpr bool enabled = false;
+    static constexpr std::size_t tail_bytes = 0;
+};
+
+// Debug policy: canaries + allocated-bitmap + poison-on-free.
+// Slot layout (slot_size_ is a multiple of 64):
+//   [ next | ... | head canary ][ payload (sizeof(T)) ][ tail canary | ... ]
+//   ^ offset 0     ^ storage-8   ^ offsetof(Node, storage)
+// The head canary lives in the padding between `next` and the cache-aligned payload, so it costs no space.
+class PoolGuardChecked {
+public:
+    static constexpr bool enabled = true;
+    static constexpr std::size_t tail_bytes = sizeof(uint64_t);
+
+    static constexpr uint64_t kHeadCanary = 0xC0FFEE11DEADBEEFull;
+    static constexpr uint64_t kTailCanary = 0xFEEDFACECAFEF00Dull;
+    static constexpr unsigned char kPoison = 0xDD;
+
+    using ViolationHandler = void (*)(PoolViolation, const void* addr);
+
+    // Default handler reports and aborts; tests install their own to observe violations.
+    static void set_violation_handler(ViolationHandler h) noexcept { handler_ = h ? h : &abort_handler; }
+
+    void init(std::size_t capacity) {
+        words_ = (capacity + 63) / 64;
+        bitmap_ = std::make_unique<std::atomic<uint64_t>[]>(words_);
+        for (std::size_t i = 0; i < words_; ++i) bitmap_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void on_init_slot(std::byte* payload, std::size_t size) noexcept {
+        std::memcpy(payload - sizeof(uint64_t), &kHeadCanary, sizeof(uint64_t));
+        std::memcpy(payload + size, &kTailCanary, sizeof(uint64_t));
+        std::memset(payload, kPoison, size);
+    }
+
+    // Called with the payload already unpoisoned for ASan.
+    void on_allocate(std::byte* payload, std::size_t size, std::size_t index) noexcept {
+        if (!canaries_intact(payload, size)) report(PoolViolation::CanaryClobbered, payload);
+        for (std::size_t i = 0; i < size; ++i) {
+            if (static_cast<unsigned char>(payload[i]) != kPoison) {
+                report(PoolViolation::WriteAfterFree, payload + i);
+                break;
+            }
+        }
+        const uint64_t bit = uint64_t{1} << (index % 64);
+        if (bitmap_[index / 64].fetch_or(bit, std::memory_order_acq_rel) & bit)
+            report(PoolViolation::FreelistCorrupt, payload);
+    }
+
+    // Returns false if the slot must not be linked back into the freelist.
+    bool on_deallocate(std::byte* payload, std::size_t size, std::size_t index) noexcept {
+        if (index == npos) {
+            report(PoolViolation::ForeignPointer, payload);
+            return false;
+        }
+        const uint64_t bit = uint64_t{1} << (index % 64);
+        if (!(bitmap_[index / 64].fetch_and(~bit, std::memory_order_acq_rel) & bit)) {
+            report(PoolViolation::DoubleFree, payload);
+            return false;
+        }
+        if (!canaries_intact(payload, size)) {
+            report(PoolViolation::CanaryClobbered, payload);
+            // repair so the next allocate of this slot does not report the same overflow again
+            std::memcpy(payload - sizeof(uint64_t), &kHeadCanary, sizeof(uint64_t));
+            std::memcpy(payload + size, &kTailCanary, sizeof(uint64_t));
+        }
+        std::memset(payload, kPoison, size);
+        return true;
+    }
+
+    std::size_t live_count() const noexcept {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < words_; ++i) n += std::popcount(bitmap_[i].load(std::memory_order_relaxed));
+        return n;
+    }
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+private:
+    static bool canaries_intact(const std::byte* payload, std::size_t size) noexcept {
+        uint64_t head, tail;
+        std::memcpy(&head, payload - sizeof(uint64_t), sizeof(uint64_t));
+        std::memcpy(&tail, payload + size, sizeof(uint64_t));
+        return head == kHeadCanary && tail == kTailCanary;
+    }
+
+    static void abort_handler(PoolViolation v, const void* addr) {
+        std::cerr << "FixedPool guard: " << to_string(v) << " at " << addr << "\n";
+        std::abort();
+    }
+
+    static void report(PoolViolation v, const void* addr) noexcept { handler_(v, addr); }
+
+    static inline ViolationHandler handler_ = &abort_handler;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> bitmap_;
+    std::size_t words_{0};
+};
+
+#if defined(HFT_POOL_GUARD)
+using DefaultPoolGuard = PoolGuardChecked;
+#else
+using DefaultPoolGuard = PoolNoGuard;
+#endif
+
 // ---------- Fixed-size freelist pool ----------
-template <PoolStorable T>
+template <PoolStorable T, class Guard = DefaultPoolGuard>
 class CACHE_ALIGNED FixedPool {
 public:
     // slot_size allows headroom for alignment/padding, but we default to sizeof(T)
     explicit FixedPool(NumaArena& arena, std::size_t capacity, std::size_t slot_size = sizeof(T))
+    : FixedPool(arena.base(), arena.size(), capacity, slot_size) {}
+
+    // Carve the pool out of [storage, storage + bytes), e.g. one sub-range of a larger arena per pool.
+    // storage must be cache-line aligned and outlive the pool.
+    FixedPool(void* storage, std::size_t bytes, std::size_t capacity, std::size_t slot_size = sizeof(T))
     : capacity_(capacity),
-      slot_size_(round_up(std::max<std::size_t>(slot_size, sizeof(Node)), CACHELINE_SIZE))
+      slot_size_(slot_bytes(slot_size))
     {
         const std::size_t needed = capacity_ * slot_size_;
-        if (needed > arena.size()) {
+        if (needed > bytes) {
             throw std::runtime_error("Arena too small for requested capacity");
         }
-        storage_ = static_cast<std::byte*>(arena.base());
+        storage_ = static_cast<std::byte*>(storage);
+        if constexpr (Guard::enabled) guard_.init(capacity_);
         init_freelist();
     }
 
+    // Bytes one slot occupies for a given payload size; lets callers size an arena before building the pool.
+    static constexpr std::size_t slot_bytes(std::size_t slot_size = sizeof(T)) noexcept {
+        return round_up(std::max<std::size_t>(slot_size, std::max(sizeof(Node), offsetof(Node, storage) + sizeof(T) + Guard::tail_bytes)), CACHELINE_SIZE);
+    }
+
+    // Hand the storage back unpoisoned: the arena may be unmapped and the range reused by the next mapping.
+    ~FixedPool() { POOL_ASAN_UNPOISON(storage_, capacity_ * slot_size_); }
+
     // Non-copyable; you usually create one pool per thread/NUMA node
     FixedPool(const FixedPool&) = delete;
     FixedPool& operator=(const FixedPool&) = delete;
@@ -193,6 +492,8 @@ public:
         }
         // Placement-new is skipped since T is trivially constructible. Zero if you need clean buffers:
         // std::memset(head->payload(), 0, sizeof(T));
+        POOL_ASAN_UNPOISON(head->storage, sizeof(T));
+        if constexpr (Guard::enabled) guard_.on_allocate(head->storage, sizeof(T), slot_index(head));
         return head->payload();
     }
 
@@ -202,6 +503,10 @@ public:
         Node* node = Node::from(obj);
         // (Optional) scrub sensitive data:
         // std::memset(obj, 0, sizeof(T));
+        if constexpr (Guard::enabled) {
+            if (!guard_.on_deallocate(node->storage, sizeof(T), slot_index(node))) return;
+        }
+        POOL_ASAN_POISON(node->storage, sizeof(T));
         Node* head = free_head_.load(std::memory_order_acquire);
         do {
             node->next = head;
@@ -216,11 +521,14 @@ public:
         return 0;
     }
 
+    // Guard builds only: number of slots currently handed out (O(capacity/64)).
+    std::size_t live_count() const noexcept requires (Guard::enabled) { return guard_.live_count(); }
+
 private:
     struct CACHE_ALIGNED Node {
         Node* next;
         alignas(CACHELINE_SIZE) std::byte storage[sizeof(T)];
-        T* payload() noexcept { return std::bit_cast<T*>(storage); }
+        T* payload() noexcept { return std::launder(reinterpret_cast<T*>(storage)); }
         static Node* from(T* p) noexcept {
             // storage is first member after 'next'; compute Node* from payload.
             auto* b = reinterpret_cast<std::byte*>(p);
@@ -228,12 +536,24 @@ private:
         }
     };
 
-    void init_freelist() noexceptmjn {
+    // Slot number of `n`, or Guard::npos if `n` does not point at the start of one of our slots.
+    std::size_t slot_index(const Node* n) const noexcept requires (Guard::enabled) {
+        const auto addr = reinterpret_cast<std::uintptr_t>(n);
+        const auto base = reinterpret_cast<std::uintptr_t>(storage_);
+        if (addr < base) return Guard::npos;
+        const std::uintptr_t off = addr - base;
+        if (off % slot_size_ != 0 || off / slot_size_ >= capacity_) return Guard::npos;
+        return off / slot_size_;
+    }
+
+    void init_freelist() noexcept {
         // Build a contiguous array of Nodes inside storage_, linked as a freelist.
         std::byte* p = storage_;
         Node* prev = nullptr;
         for (std::size_t i = 0; i < capacity_; ++i) {
             Node* n = reinterpret_cast<Node*>(p);
+            if constexpr (Guard::enabled) guard_.on_init_slot(n->storage, sizeof(T));
+            POOL_ASAN_POISON(n->storage, sizeof(T));
             n->next = prev;
             prev = n;
             p += slot_size_;
@@ -243,7 +563,7 @@ private:
         // This is usually not necessary if prefaulted.
     }
 
-    static std::size_t round_up(std::size_t x, std::size_t a) {
+    static constexpr std::size_t round_up(std::size_t x, std::size_t a) {
         return (x + a - 1) & ~(a - 1);
     }
 
@@ -254,6 +574,7 @@ private:
     std::byte* storage_{nullptr};
     std::size_t capacity_{0};
     std::size_t slot_size_{0};
+    [[no_unique_address]] Guard guard_{};
 };
 
 // ---------- Per-thread pool wrapper (NUMA pinned) ----------
@@ -267,8 +588,19 @@ inline void pin_thread_to_cpu(int cpu_id) {
     (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
 }
 
+// Lowest-numbered cpu in our affinity mask (for dev boxes where no cpu is isolated).
+inline int first_allowed_cpu() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &allowed)) return c;
+    }
+    return 0;
+}
+
 inline int cpu_to_numa_node(int cpu_id) {
-    int node = 0;
+    unsigned node = 0;
     (void)getcpu(nullptr, &node); // glibc; may require _GNU_SOURCE; or use numa API
     // Fallback: libnuma mapping
     return numa_node_of_cpu(cpu_id);
@@ -279,16 +611,16 @@ struct CACHE_ALIGNED OrderMsg {
     uint64_t ts_ns;
     uint64_t order_id;
     uint32_t instr_id;
-    double   price;
+    Price    price;
     uint32_t qty;
     char     side;      // 'B' or 'S'
     char     pad[7];    // keep 64B aligned
 };
 
-CUST_ALLOC_TEST()
+int CUST_ALLOC_TEST()
 {
     // Choose CPU/core and NUMA node
-    const int cpu = 2;
+    const int cpu = first_allowed_cpu();
     pin_thread_to_cpu(cpu);
     const int node = cpu_to_numa_node(cpu);
 
@@ -303,7 +635,7 @@ CUST_ALLOC_TEST()
     // Allocate
     OrderMsg* m = pool.allocate();
     if (!m) { std::cerr << "Pool exhausted\n"; return 1; }
-    m->ts_ns = 0; m->order_id = 42; m->instr_id = 7; m->price = 101.25; m->qty = 10; m->side = 'B';
+    m->ts_ns = 0; m->order_id = 42; m->instr_id = 7; m->price = 101.25_px; m->qty = 10; m->side = 'B';
 
     // … use m …
 
@@ -313,3 +645,61 @@ CUST_ALLOC_TEST()
     std::cout << "OK\n";
     return 0;
 }
+
+// Exercises every guard check on a small pool. Returns the violations seen, in order, comma separated.
+std::string CUST_ALLOC_GUARD_TEST()
+{
+    static std::string seen;
+    seen.clear();
+    PoolGuardChecked::set_violation_handler([](PoolViolation v, const void*) {
+        if (!seen.empty()) seen += ",";
+        seen += to_string(v);
+    });
+
+    NumaArena arena(1ULL * 1024 * 1024, 0, /*prefer_thp=*/false);
+    FixedPool<OrderMsg, PoolGuardChecked> pool(arena, 64);
+
+    OrderMsg* a = pool.allocate();
+    OrderMsg* b = pool.allocate();
+    a->order_id = 1;
+    b->order_id = 2;
+
+    pool.deallocate(a);
+    pool.deallocate(a);                                     // double_free
+
+    alignas(CACHELINE_SIZE) static std::byte foreign[3 * CACHELINE_SIZE];
+    pool.deallocate(reinterpret_cast<OrderMsg*>(foreign + CACHELINE_SIZE)); // foreign_pointer
+
+    reinterpret_cast<std::byte*>(b)[sizeof(OrderMsg)] = std::byte{0};
+    pool.deallocate(b);                                     // canary_clobbered
+
+#ifndef HFT_POOL_ASAN // under ASan the scribble itself is reported as use-after-poison, which is the point
+    // b is now on top of the freelist; scribble into it and pop it again
+    reinterpret_cast<volatile char*>(b)[8] = 'X';
+    OrderMsg* c = pool.allocate();                          // write_after_free
+    pool.deallocate(c);
+#endif
+
+    PoolGuardChecked::set_violation_handler(nullptr);
+    return seen + (pool.live_count() == 0 ? "" : ",leak");
+}
+
+// Arena startup time against arena size: serial 4KB touch (the old behaviour) vs parallel, node-pinned
+// MADV_POPULATE_WRITE with THP-aware touching as fallback.
+void NUMA_PREFAULT_BENCH()
+{
+    const PrefaultOptions serial{.threads = 1, .kernel_populate = false};
+    const PrefaultOptions parallel{};
+    std::cout << "NUMA_PREFAULT_BENCH node 0, " << Prefault::node_cpus(0).size() << " cpus, THP "
+              << (Prefault::thp_available() ? "available" : "off") << "\n";
+    for (std::size_t mb : {64, 256, 1024, 2048}) {
+        const std::size_t bytes = mb * 1024 * 1024;
+        double ms[2];
+        int i = 0;
+        for (const PrefaultOptions& opt : {serial, parallel}) {
+            NumaArena arena(bytes, 0, /*prefer_thp=*/true, opt);
+            ms[i++] = static_cast<double>(arena.prefault_ns()) / 1e6;
+        }
+        std::cout << "  " << mb << " MB: serial " << ms[0] << " ms, parallel+populate " << ms[1] << " ms\n";
+    }
+}
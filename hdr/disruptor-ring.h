@@ -0,0 +1,438 @@
+/*
+        Design notes
+
+        Disruptor-style sequenced ring
+
+        One producer (the feed decode loop) feeds a chain of dependent stages - book -> strategy -> risk -> gateway -
+        plus observers that only need to see every event (recorder, monitor). Chained SPSC rings copy every event
+        once per hop and put a queue between each pair of stages. Here there is one pre-allocated ring of entries and
+        every stage is just a sequence number walking over it:
+
+        - the producer claims a batch of slots (claim(n)), writes them in place and publishes the batch with one
+          release store of the cursor. Entries are never copied again.
+        - each consumer owns a Sequence (last slot it finished) and reads through a SequenceBarrier: "slots up to X
+          are published and every stage I depend on has finished them". Dependencies form any DAG; a consumer takes
+          everything available in one go (natural batching when it falls behind).
+        - the producer is gated by the sequences of the last stages (add_gating()), so it never laps a slow reader.
+        - multi-producer mode claims with fetch_add on the cursor and publishes per slot into an availability array
+          (the round number of the slot), so consumers only see contiguous fully written runs.
+        - wait strategies: BusySpinWait (dedicated cores), YieldingWait (spin, then sched_yield), BlockingWait
+          (futex on the cursor; producers only pay a notify when someone actually sleeps).
+        - every sequence sits alone on its cache line; entries and the availability array live in a caller-owned
+          NumaArena on the consumers' node.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <x86intrin.h>
+
+#include "custom-allocator.h"
+#include "spsc-ring.h"
+
+// ---------- sequence ----------
+struct CACHE_ALIGNED Sequence {
+    static constexpr int64_t INITIAL = -1;
+
+    int64_t get() const noexcept { return value_.load(std::memory_order_acquire); }
+    void set(int64_t v) noexcept { value_.store(v, std::memory_order_release); }
+
+    std::atomic<int64_t> value_{INITIAL};
+    char pad_[CACHELINE_SIZE - sizeof(std::atomic<int64_t>)]{};
+};
+
+// ---------- wait strategies ----------
+// on_cursor: the producer has not published what we need yet. on_dependents: it has, an upstream stage has not.
+// signal: called by publish().
+struct BusySpinWait {
+    void on_cursor(const std::atomic<int64_t>&, int64_t, uint32_t&) noexcept { _mm_pause(); }
+    void on_dependents(uint32_t&) noexcept { _mm_pause(); }
+    void signal(std::atomic<int64_t>&) noexcept {}
+};
+
+struct YieldingWait {
+    static constexpr uint32_t SPIN_TRIES = 100;
+    void on_cursor(const std::atomic<int64_t>&, int64_t, uint32_t& spins) noexcept { idle(spins); }
+    void on_dependents(uint32_t& spins) noexcept { idle(spins); }
+    void signal(std::atomic<int64_t>&) noexcept {}
+
+    static void idle(uint32_t& spins) noexcept {
+        if (spins < SPIN_TRIES) { ++spins; _mm_pause(); }
+        else sched_yield();
+    }
+};
+
+struct BlockingWait {
+    void on_cursor(const std::atomic<int64_t>& cursor, int64_t seen, uint32_t& spins) noexcept {
+        if (spins < YieldingWait::SPIN_TRIES) { ++spins; _mm_pause(); return; }
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        cursor.wait(seen, std::memory_order_seq_cst);
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    void on_dependents(uint32_t& spins) noexcept { YieldingWait::idle(spins); }
+    void signal(std::atomic<int64_t>& cursor) noexcept {
+        // pairs with the seq_cst increment above: either we see the waiter or it sees the new cursor
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_relaxed)) cursor.notify_all();
+    }
+
+    CACHE_ALIGNED std::atomic<uint32_t> waiters_{0};
+};
+
+enum class ProducerMode { Single, Multi };
+
+// ---------- ring ----------
+template <PoolStorable T, std::size_t N, ProducerMode Mode = ProducerMode::Single, class Wait = BusySpinWait>
+class DisruptorRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    static constexpr int SHIFT = std::countr_zero(N);
+
+public:
+    class Barrier;
+
+    // Bytes of arena the ring needs (entries, plus the availability array in multi-producer mode).
+    static constexpr std::size_t bytes_needed() noexcept {
+        std::size_t b = (N * sizeof(T) + CACHELINE_SIZE - 1) & ~(CACHELINE_SIZE - 1);
+        if constexpr (Mode == ProducerMode::Multi) b += N * sizeof(std::atomic<int32_t>);
+        return b;
+    }
+
+    // Entries live in `arena` (from its base); the arena must outlive the ring.
+    explicit DisruptorRing(NumaArena& arena) {
+        if (arena.size() < bytes_needed()) throw std::runtime_error("DisruptorRing: arena too small");
+        entries_ = static_cast<T*>(arena.base());
+        if constexpr (Mode == ProducerMode::Multi) {
+            auto* p = static_cast<std::byte*>(arena.base()) + (bytes_needed() - N * sizeof(std::atomic<int32_t>));
+            available_ = reinterpret_cast<std::atomic<int32_t>*>(p);
+            for (std::size_t i = 0; i < N; ++i) new (&available_[i]) std::atomic<int32_t>(-1);
+        }
+    }
+
+    DisruptorRing(const DisruptorRing&) = delete;
+    DisruptorRing& operator=(const DisruptorRing&) = delete;
+
+    // Producer never wraps past these (the last stage of each branch). Call before publishing starts.
+    void add_gating(const Sequence& s) { gating_.push_back(&s); }
+
+    // Consumer side: published slots that every sequence in `deps` has also finished.
+    Barrier barrier(std::initializer_list<const Sequence*> deps = {}) { return Barrier(*this, deps); }
+
+    // ---------- producer ----------
+    // Claim n consecutive slots, waiting for space. Returns the highest; the batch is [hi - n + 1, hi].
+    int64_t claim(std::size_t n = 1) noexcept {
+        int64_t hi;
+        if constexpr (Mode == ProducerMode::Single) hi = (next_ += static_cast<int64_t>(n));
+        else hi = cursor_.fetch_add(static_cast<int64_t>(n), std::memory_order_acq_rel) + static_cast<int64_t>(n);
+        wait_for_space(hi);
+        return hi;
+    }
+
+    // As claim(), but gives up instead of waiting. -1 if there is no room for n.
+    int64_t try_claim(std::size_t n = 1) noexcept {
+        if constexpr (Mode == ProducerMode::Single) {
+            const int64_t hi = next_ + static_cast<int64_t>(n);
+            if (!has_space(hi)) return -1;
+            return next_ = hi;
+        } else {
+            int64_t cur = cursor_.load(std::memory_order_acquire);
+            do {
+                if (!has_space(cur + static_cast<int64_t>(n))) return -1;
+            } while (!cursor_.compare_exchange_weak(cur, cur + static_cast<int64_t>(n), std::memory_order_acq_rel));
+            return cur + static_cast<int64_t>(n);
+        }
+    }
+
+    T& operator[](int64_t seq) noexcept { return entries_[static_cast<std::size_t>(seq) & (N - 1)]; }
+    const T& operator[](int64_t seq) const noexcept { return entries_[static_cast<std::size_t>(seq) & (N - 1)]; }
+
+    void publish(int64_t lo, int64_t hi) noexcept {
+        if constexpr (Mode == ProducerMode::Single) {
+            (void)lo;
+            cursor_.store(hi, std::memory_order_release);
+        } else {
+            for (int64_t s = lo; s <= hi; ++s)
+                available_[static_cast<std::size_t>(s) & (N - 1)].store(round(s), std::memory_order_release);
+        }
+        wait_.signal(cursor_);
+    }
+    void publish(int64_t seq) noexcept { publish(seq, seq); }
+
+    static constexpr std::size_t capacity() noexcept { return N; }
+
+    // ---------- consumer ----------
+    class Barrier {
+    public:
+        // Wait until `seq` is available; returns the highest available sequence (>= seq).
+        int64_t wait_for(int64_t seq) noexcept {
+            uint32_t spins = 0;
+            for (;;) {
+                const int64_t avail = available(seq);
+                if (avail >= seq) return avail;
+                const int64_t c = ring_->cursor_.load(std::memory_order_acquire);
+                if (c < seq) ring_->wait_.on_cursor(ring_->cursor_, c, spins);
+                else ring_->wait_.on_dependents(spins);
+            }
+        }
+
+        // Non-blocking: highest sequence available, which is < seq if nothing new is.
+        int64_t available(int64_t seq) const noexcept {
+            int64_t avail = ring_->cursor_.load(std::memory_order_acquire);
+            for (const Sequence* d : deps_) avail = std::min(avail, d->get());
+            if constexpr (Mode == ProducerMode::Multi) avail = ring_->highest_published(seq, avail);
+            return avail;
+        }
+
+        // Handle everything available after `mine`, then advance it. Returns how many events were handled.
+        template <class F>
+        std::size_t poll(Sequence& mine, F&& f) noexcept {
+            const int64_t next = mine.get() + 1;
+            const int64_t avail = available(next);
+            if (avail < next) return 0;
+            for (int64_t s = next; s <= avail; ++s) f((*ring_)[s], s);
+            mine.set(avail);
+            return static_cast<std::size_t>(avail - next + 1);
+        }
+
+        // As poll(), but waits for at least one event.
+        template <class F>
+        std::size_t process(Sequence& mine, F&& f) noexcept {
+            const int64_t next = mine.get() + 1;
+            const int64_t avail = wait_for(next);
+            for (int64_t s = next; s <= avail; ++s) f((*ring_)[s], s);
+            mine.set(avail);
+            return static_cast<std::size_t>(avail - next + 1);
+        }
+
+    private:
+        friend class DisruptorRing;
+        Barrier(DisruptorRing& r, std::initializer_list<const Sequence*> deps) : ring_(&r), deps_(deps) {}
+
+        DisruptorRing* ring_;
+        std::vector<const Sequence*> deps_;
+    };
+
+private:
+    static int32_t round(int64_t seq) noexcept { return static_cast<int32_t>(seq >> SHIFT); }
+
+    int64_t min_gating(int64_t fallback) const noexcept {
+        int64_t m = fallback;
+        for (const Sequence* s : gating_) m = std::min(m, s->get());
+        return m;
+    }
+
+    bool has_space(int64_t hi) noexcept {
+        const int64_t wrap = hi - static_cast<int64_t>(N);
+        // acquire/release: in multi-producer mode another producer may have refreshed the cache, and we must
+        // still happen-after the consumer that freed the slot
+        if (wrap <= gating_cache_.load(std::memory_order_acquire)) return true;
+        const int64_t g = min_gating(hi);
+        gating_cache_.store(g, std::memory_order_release);
+        return wrap <= g;
+    }
+
+    void wait_for_space(int64_t hi) noexcept {
+        uint32_t spins = 0;
+        while (!has_space(hi)) YieldingWait::idle(spins);   // back-pressure is rare; never sleep on it
+    }
+
+    // Multi-producer: last slot of the contiguous published run starting at lo, capped at avail.
+    int64_t highest_published(int64_t lo, int64_t avail) const noexcept {
+        for (int64_t s = lo; s <= avail; ++s) {
+            if (available_[static_cast<std::size_t>(s) & (N - 1)].load(std::memory_order_acquire) != round(s)) return s - 1;
+        }
+        return avail;
+    }
+
+    // producer line
+    CACHE_ALIGNED std::atomic<int64_t> cursor_{Sequence::INITIAL};   // published (single) / claimed (multi)
+    CACHE_ALIGNED int64_t next_{Sequence::INITIAL};                    // single producer's claim counter
+    std::atomic<int64_t> gating_cache_{Sequence::INITIAL};
+    std::vector<const Sequence*> gating_;
+    // read-mostly
+    CACHE_ALIGNED T* entries_{nullptr};
+    std::atomic<int32_t>* available_{nullptr};
+    Wait wait_{};
+};
+
+// ---------- tests ----------
+namespace DisruptorDetail {
+    struct CACHE_ALIGNED Event {
+        uint64_t value;
+        uint64_t book;
+        uint64_t strategy;
+        uint32_t producer;
+    };
+}
+
+// Single producer, book -> strategy -> risk chain plus a parallel observer, small ring so it wraps many times;
+// then three producers into one consumer.
+std::string DISRUPTOR_Test()
+{
+    using DisruptorDetail::Event;
+    std::stringstream ss;
+    constexpr uint64_t COUNT = 20'000;
+    {
+        using Ring = DisruptorRing<Event, 64, ProducerMode::Single, BlockingWait>;
+        NumaArena arena(Ring::bytes_needed(), 0);
+        Ring ring(arena);
+        Sequence book, strategy, risk, observer;
+        auto b_book = ring.barrier();
+        auto b_strategy = ring.barrier({&book});
+        auto b_risk = ring.barrier({&strategy});
+        auto b_observer = ring.barrier();
+        ring.add_gating(risk);
+        ring.add_gating(observer);
+
+        const auto last = static_cast<int64_t>(COUNT - 1);
+        bool order_ok = true, chain_ok = true;
+        uint64_t observed_sum = 0;
+        std::thread t_book([&] {
+            while (book.get() < last) b_book.process(book, [&](Event& e, int64_t s) {
+                order_ok &= e.value == static_cast<uint64_t>(s);
+                e.book = e.value * 2;
+            });
+        });
+        std::thread t_strategy([&] {
+            while (strategy.get() < last) b_strategy.process(strategy, [&](Event& e, int64_t) { e.strategy = e.book + 1; });
+        });
+        std::thread t_risk([&] {
+            while (risk.get() < last) b_risk.process(risk, [&](Event& e, int64_t) { chain_ok &= e.strategy == e.value * 2 + 1; });
+        });
+        std::thread t_observer([&] {
+            while (observer.get() < last) b_observer.process(observer, [&](const Event& e, int64_t) { observed_sum += e.value; });
+        });
+
+        // batches of 1..7
+        for (uint64_t v = 0; v < COUNT;) {
+            const std::size_t n = std::min<std::size_t>(1 + v % 7, COUNT - v);
+            const int64_t hi = ring.claim(n);
+            for (int64_t s = hi - static_cast<int64_t>(n) + 1; s <= hi; ++s) ring[s] = Event{v++, 0, 0, 0};
+            ring.publish(hi - static_cast<int64_t>(n) + 1, hi);
+        }
+        t_book.join(); t_strategy.join(); t_risk.join(); t_observer.join();
+        ss << "order=" << order_ok << " chain=" << chain_ok << " observed=" << (observed_sum == COUNT * (COUNT - 1) / 2);
+    }
+    {
+        using Ring = DisruptorRing<Event, 128, ProducerMode::Multi, YieldingWait>;
+        NumaArena arena(Ring::bytes_needed(), 0);
+        Ring ring(arena);
+        Sequence consumer;
+        auto barrier = ring.barrier();
+        ring.add_gating(consumer);
+
+        constexpr uint32_t PRODUCERS = 3;
+        constexpr uint64_t EACH = 5'000;
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < PRODUCERS; ++p) {
+            producers.emplace_back([&ring, p] {
+                for (uint64_t v = 0; v < EACH; v += 2) {
+                    const int64_t hi = ring.claim(2);
+                    ring[hi - 1] = Event{v, 0, 0, p};
+                    ring[hi] = Event{v + 1, 0, 0, p};
+                    ring.publish(hi - 1, hi);
+                }
+            });
+        }
+        uint64_t next[PRODUCERS] = {};
+        bool fifo = true;
+        const auto last = static_cast<int64_t>(PRODUCERS * EACH - 1);
+        while (consumer.get() < last) barrier.process(consumer, [&](const Event& e, int64_t) {
+            fifo &= e.value == next[e.producer]++;
+        });
+        for (auto& t : producers) t.join();
+        ss << " mp=" << next[0] + next[1] + next[2] << " fifo=" << fifo;
+    }
+    return ss.str();
+}
+
+// Producer -> 3 dependent stages: one Disruptor ring vs three chained SPSC rings. On machines with fewer cores than
+// threads both sides use yielding waits, otherwise busy spin.
+void DISRUPTOR_BENCH()
+{
+    using DisruptorDetail::Event;
+    constexpr uint64_t COUNT = 5'000'000;
+    constexpr std::size_t N = 1 << 14;
+    constexpr int64_t BATCH = 16;
+    const bool spin = std::thread::hardware_concurrency() >= 4;
+    const auto last = static_cast<int64_t>(COUNT - 1);
+    auto idle = [spin](uint32_t& spins) { if (spin) _mm_pause(); else YieldingWait::idle(spins); };
+    auto report = [](const char* what, std::chrono::steady_clock::time_point t0) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "DISRUPTOR_BENCH " << what << ": " << static_cast<double>(ns) / COUNT << " ns/event, "
+                  << static_cast<double>(COUNT) * 1e3 / static_cast<double>(ns) << " M events/s\n";
+    };
+    std::cout << "DISRUPTOR_BENCH waits: " << (spin ? "busy spin" : "yielding") << "\n";
+
+    {
+        using Ring = DisruptorRing<Event, N, ProducerMode::Single, YieldingWait>;
+        NumaArena arena(Ring::bytes_needed(), 0);
+        Ring ring(arena);
+        Sequence s1, s2, s3;
+        auto b1 = ring.barrier(), b2 = ring.barrier({&s1}), b3 = ring.barrier({&s2});
+        ring.add_gating(s3);
+        uint64_t sink = 0;
+        auto stage = [&](Sequence& mine, Ring::Barrier& b, auto&& f) {
+            uint32_t spins = 0;
+            while (mine.get() < last) {
+                if (b.poll(mine, f)) spins = 0;
+                else idle(spins);
+            }
+        };
+        const auto t0 = std::chrono::steady_clock::now();
+        std::thread a([&] { stage(s1, b1, [](Event& e, int64_t) { e.book = e.value + 1; }); });
+        std::thread b([&] { stage(s2, b2, [](Event& e, int64_t) { e.strategy = e.book + 1; }); });
+        std::thread c([&] { stage(s3, b3, [&](const Event& e, int64_t) { sink += e.strategy; }); });
+        for (uint64_t v = 0; v < COUNT; v += BATCH) {
+            const int64_t hi = ring.claim(BATCH);
+            for (int64_t s = hi - BATCH + 1; s <= hi; ++s) ring[s].value = static_cast<uint64_t>(s);
+            ring.publish(hi - BATCH + 1, hi);
+        }
+        a.join(); b.join(); c.join();
+        report("disruptor 3 stages", t0);
+        std::cout << "(sink " << (sink & 1) << ")\n";
+    }
+    {
+        auto r1 = std::make_unique<SpscRing<Event, N>>(), r2 = std::make_unique<SpscRing<Event, N>>(),
+             r3 = std::make_unique<SpscRing<Event, N>>();
+        uint64_t sink = 0;
+        auto hop = [&](SpscRing<Event, N>& in, SpscRing<Event, N>* out, auto&& f) {
+            uint32_t spins = 0;
+            for (uint64_t n = 0; n < COUNT;) {
+                const Event* e = in.front();
+                if (!e) { idle(spins); continue; }
+                spins = 0;
+                Event copy = *e;
+                in.pop();
+                f(copy);
+                if (out) while (!out->try_push(copy)) idle(spins);
+                ++n;
+            }
+        };
+        const auto t0 = std::chrono::steady_clock::now();
+        std::thread a([&] { hop(*r1, r2.get(), [](Event& e) { e.book = e.value + 1; }); });
+        std::thread b([&] { hop(*r2, r3.get(), [](Event& e) { e.strategy = e.book + 1; }); });
+        std::thread c([&] { hop(*r3, nullptr, [&](Event& e) { sink += e.strategy; }); });
+        uint32_t spins = 0;
+        for (uint64_t v = 0; v < COUNT; ++v) {
+            Event e{};
+            e.value = v;
+            while (!r1->try_push(e)) idle(spins);
+        }
+        a.join(); b.join(); c.join();
+        report("chained SPSC 3 hops", t0);
+        std::cout << "(sink " << (sink & 1) << ")\n";
+    }
+}
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <cstring>
 #include <cstdint>
 #include <cstdlib>
@@ -18,18 +19,24 @@
 #include <rte_mbuf.h>
 #include <rte_memcpy.h>
 
+#include "hot-thread.h"
+#include "tsc-clock.h"
+#include "disruptor-ring.h"
+#include "ticker-wire.h"
+
 constexpr uint16_t RX_RING_SIZE = 1024;
 constexpr uint16_t NUM_MBUFS = 8192;
 constexpr uint16_t MBUF_CACHE_SIZE = 250;
 constexpr uint16_t BURST_SIZE = 32;
 constexpr size_t MAX_PKT_SIZE = 4096;
 
-struct TickerData {
-    uint64_t ts_ns;
-    uint32_t instr_id;
-    double price;
-    uint32_t qty;
-} __attribute__((__packed__));
+// A decoded tick as it travels down the pipeline (book -> strategy -> risk -> gateway, plus observers).
+struct TickEvent {
+    uint64_t rx_tsc;
+    TickerData tick;
+    Price price;            // tick.price, decoded once here; stages read this, not the wire double
+};
+using TickRing = DisruptorRing<TickEvent, 1 << 16>;
 
 class TickToTradeHandler
 {
@@ -38,6 +45,9 @@ public:
     : dpdk_nic_id(port_id), myMulticastAddr(multicastAddr) {}
 
     std::string ret;
+    uint64_t last_rx_tsc = 0;   // TscClock stamp of the packet being decoded
+    TickRing* tick_ring = nullptr;   // if set, decoded ticks are also published here for the downstream stages
+    uint64_t bad_prices = 0;    // ticks dropped because their wire double was not a price
 
     bool init()
 	{
@@ -125,7 +135,7 @@ private:
 
     void process_packet(rte_mbuf* mbuf)
 	{
-        size_t offset = 0;
+        last_rx_tsc = TscClock::now_tsc();
         struct rte_ether_hdr* eth_hdr = rte_pktmbuf_mtod(mbuf, struct rte_ether_hdr*);
 
         struct rte_ipv4_hdr* ip_hdr = (struct rte_ipv4_hdr*)(eth_hdr + 1);
@@ -140,19 +150,42 @@ private:
         uint16_t payload_len = rte_be_to_cpu_16(udp_hdr->dgram_len) - sizeof(struct rte_udp_hdr);
 
         // Process multiple TickerData entries efficiently
-        while (offset + sizeof(TickerData) <= payload_len)
+        const TickerData* ticks = reinterpret_cast<const TickerData*>(udp_hdr + 1);
+        const size_t count = std::min<size_t>(payload_len / sizeof(TickerData), MAX_PKT_SIZE / sizeof(TickerData));
+
+        // decode the prices first, so a tick whose price is not a price never takes a ring slot
+        uint16_t good[MAX_PKT_SIZE / sizeof(TickerData)];
+        Price prices[MAX_PKT_SIZE / sizeof(TickerData)];
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (ticker_price(ticks[i], prices[n])) [[likely]]
+                good[n++] = static_cast<uint16_t>(i);
+            else
+                ++bad_prices;
+        }
+        if (tick_ring && n)
+        {
+            // one claim and one publish per datagram; the ticks are written straight into the ring entries
+            const int64_t hi = tick_ring->claim(n);
+            const int64_t lo = hi - static_cast<int64_t>(n) + 1;
+            for (size_t i = 0; i < n; ++i)
+            {
+                (*tick_ring)[lo + static_cast<int64_t>(i)] = TickEvent{last_rx_tsc, ticks[good[i]], prices[i]};
+            }
+            tick_ring->publish(lo, hi);
+        }
+        for (size_t i = 0; i < n; ++i)
 		{
-            TickerData* td = (TickerData*)(udp_hdr + 1);
-            handle_tick(*td);
-            offset += sizeof(TickerData);
+            handle_tick(ticks[good[i]], prices[i]);
         }
     }
 
-    void handle_tick(const TickerData& td)
+    void handle_tick(const TickerData& td, Price px)
 	{
         auto ts = std::chrono::nanoseconds(td.ts_ns);
         std::stringstream ss;
-        ss << "Tick: instr=" << td.instr_id << " price=" << td.price << " qty=" << td.qty << " ts_ns=" << ts.count();
+        ss << "Tick: instr=" << td.instr_id << " price=" << px << " qty=" << td.qty << " ts_ns=" << ts.count();
         ret += ss.str();
     }
 };
@@ -164,6 +197,13 @@ std::string DPDK_TBT_Test(const std::string& multicastAddr, int port_id)
     {
         return "EXIT_FAILURE";
     }
-    handler.run();
+    // The feed loop runs on a pinned hot thread; placement is relaxed so the test also runs without isolcpus/rtprio.
+    HotThreadConfig cfg;
+    cfg.name = "feed";
+    cfg.cpu = first_allowed_cpu();
+    cfg.require_isolated = false;
+    cfg.require_realtime = false;
+    HotThread feed(cfg, [&handler] { handler.run(); });
+    feed.join();
     return handler.ret;
 }
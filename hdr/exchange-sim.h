@@ -0,0 +1,430 @@
+/*
+        Design notes
+
+        Local exchange simulator
+
+        A stand-in exchange on the same box so tick -> order -> ack can be measured end to end without a venue:
+        a TCP order entry port speaking order-wire.h, a MatchingEngine behind it, and a UDP feed publishing what
+        the engine did as TickerData (by default to 239.255.0.1:12345, where the feed handler listens).
+
+        - one thread, kernel sockets and epoll: it is the far side of the measurement, so it only has to be
+          deterministic and not the bottleneck. Pin it away from the cores under test.
+        - each inbound message is answered before the next one is read: Ack (or Reject) first, then the fills
+          it caused, to the taker's session and to every maker's session.
+        - replies are appended to a per-session outbox and flushed once per poll round with one send(); a
+          session that cannot take more gets EPOLLOUT armed until its outbox drains.
+        - the feed is batched the same way: every trade and level change of the round goes into as few datagrams
+          as fit (TickerData has no type field, so a trade is price/qty traded and a level change is
+          price/new level total, in that order per message).
+        - a session that disconnects has its resting orders cancelled (and published), as venues do.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "order-wire.h"
+#include "ticker-wire.h"
+#include "matching-engine.h"
+#include "tsc-clock.h"
+
+struct ExchangeSimOptions {
+    std::string bind_ip = "127.0.0.1";
+    uint16_t port = 9000;                   // 0 = ephemeral, see ExchangeSim::port()
+    std::string feed_ip = "239.255.0.1";
+    uint16_t feed_port = 12345;
+    std::string feed_if = "127.0.0.1";      // IP_MULTICAST_IF; loopback keeps the feed on this box
+    MatchingEngineOptions engine;           // tick size, price band, resting capacity
+};
+
+struct ExchangeSimStats {
+    uint64_t sessions = 0;
+    uint64_t messages = 0;
+    uint64_t rejects = 0;
+    uint64_t trades = 0;
+    uint64_t ticks = 0;
+    uint64_t datagrams = 0;
+};
+
+class ExchangeSim {
+public:
+    static constexpr std::size_t MAX_TICKS_PER_DATAGRAM = 1472 / sizeof(TickerData);   // fits one Ethernet frame
+
+    explicit ExchangeSim(ExchangeSimOptions opt = {}) : opt_(std::move(opt)), engine_(opt_.engine) {
+        ep_ = epoll_create1(0);
+        if (ep_ < 0) throw std::runtime_error("epoll_create1 failed");
+
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (listen_fd_ < 0) throw std::runtime_error("socket failed");
+        int one = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr = make_addr(opt_.bind_ip, opt_.port);
+        if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd_, 64) < 0)
+            throw std::runtime_error("cannot listen on " + opt_.bind_ip + ":" + std::to_string(opt_.port));
+        socklen_t len = sizeof(addr);
+        getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = listen_fd_;
+        epoll_ctl(ep_, EPOLL_CTL_ADD, listen_fd_, &ev);
+
+        feed_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (feed_fd_ < 0) throw std::runtime_error("feed socket failed");
+        in_addr ifaddr{};
+        inet_pton(AF_INET, opt_.feed_if.c_str(), &ifaddr);
+        const unsigned char loop = 1, ttl = 1;
+        setsockopt(feed_fd_, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr));
+        setsockopt(feed_fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        setsockopt(feed_fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        feed_addr_ = make_addr(opt_.feed_ip, opt_.feed_port);
+
+        events_.resize(64);
+        feed_.reserve(MAX_TICKS_PER_DATAGRAM);
+    }
+
+    ExchangeSim(const ExchangeSim&) = delete;
+    ExchangeSim& operator=(const ExchangeSim&) = delete;
+
+    ~ExchangeSim() {
+        for (auto& [fd, s] : sessions_) close(fd);
+        if (feed_fd_ >= 0) close(feed_fd_);
+        if (listen_fd_ >= 0) close(listen_fd_);
+        if (ep_ >= 0) close(ep_);
+    }
+
+    // Serve until stop() (from any thread or a signal handler).
+    void run() {
+        running_.store(true, std::memory_order_relaxed);
+        while (running_.load(std::memory_order_relaxed)) poll(100);
+    }
+
+    void stop() noexcept { running_.store(false, std::memory_order_relaxed); }
+
+    // One epoll round: accept, read and match everything ready, then flush replies and the feed.
+    int poll(int timeout_ms) {
+        const int n = epoll_wait(ep_, events_.data(), static_cast<int>(events_.size()), timeout_ms);
+        for (int i = 0; i < n; ++i) {
+            const int fd = events_[i].data.fd;
+            if (fd == listen_fd_) {
+                accept_all();
+                continue;
+            }
+            const auto it = sessions_.find(fd);
+            if (it == sessions_.end()) continue;
+            if (events_[i].events & EPOLLOUT) flush(it->second);
+            if (events_[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) read_session(it->second);
+        }
+        for (int fd : dirty_) {
+            const auto it = sessions_.find(fd);
+            if (it != sessions_.end()) flush(it->second);
+        }
+        dirty_.clear();
+        for (int fd : closing_) drop(fd);
+        closing_.clear();
+        publish();
+        return n < 0 ? 0 : n;
+    }
+
+    uint16_t port() const noexcept { return port_; }
+    const ExchangeSimStats& stats() const noexcept { return stats_; }
+    const MatchingEngine& engine() const noexcept { return engine_; }
+
+private:
+    struct Session {
+        int fd;
+        std::vector<char> in;       // partial inbound message
+        std::string out;            // replies not yet accepted by the socket
+        std::size_t out_off = 0;
+        bool want_out = false;
+        bool dirty = false;
+    };
+
+    static sockaddr_in make_addr(const std::string& ip, uint16_t port) {
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_port = htons(port);
+        if (inet_pton(AF_INET, ip.c_str(), &a.sin_addr) != 1) throw std::runtime_error("bad address " + ip);
+        return a;
+    }
+
+    static std::size_t message_size(char type) noexcept {
+        switch (type) {
+        case NewOrderType: return sizeof(NewOrderMsg);
+        case ReplaceType: return sizeof(ReplaceMsg);
+        case CancelType: return sizeof(CancelMsg);
+        default: return 0;
+        }
+    }
+
+    void accept_all() {
+        for (;;) {
+            const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd < 0) return;
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(ep_, EPOLL_CTL_ADD, fd, &ev);
+            sessions_.emplace(fd, Session{fd, {}, {}, 0, false, false});
+            ++stats_.sessions;
+        }
+    }
+
+    void read_session(Session& s) {
+        char buf[4096];
+        for (;;) {
+            const ssize_t r = recv(s.fd, buf, sizeof(buf), 0);
+            if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                closing_.push_back(s.fd);
+                return;
+            }
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+            s.in.insert(s.in.end(), buf, buf + r);
+            std::size_t off = 0;
+            while (off < s.in.size()) {
+                const std::size_t need = message_size(s.in[off]);
+                if (!need) {                        // not our protocol: no way to resync a byte stream
+                    closing_.push_back(s.fd);
+                    return;
+                }
+                if (s.in.size() - off < need) break;
+                handle(s, s.in.data() + off);
+                off += need;
+            }
+            s.in.erase(s.in.begin(), s.in.begin() + static_cast<std::ptrdiff_t>(off));
+        }
+    }
+
+    void handle(Session& s, const char* p) {
+        ++stats_.messages;
+        out_.clear();
+        const auto owner = static_cast<uint32_t>(s.fd);
+        switch (p[0]) {
+        case NewOrderType: {
+            NewOrderMsg m;
+            std::memcpy(&m, p, sizeof(m));
+            const Order& o = m.order;
+            if (engine_.add(EngineOrder{o.order_id, owner, o.instr_id, o.price, o.qty, o.side}, out_) == EngineResult::Rejected)
+                reject(s, o.order_id);
+            else
+                report(s, ExecReport{ExecReport::Ack, o.order_id, 0, 0, o.qty});
+            break;
+        }
+        case ReplaceType: {
+            ReplaceMsg m;
+            std::memcpy(&m, p, sizeof(m));
+            const Order& o = m.order;
+            uint32_t leaves = 0;
+            if (engine_.replace(m.orig_order_id, EngineOrder{o.order_id, owner, o.instr_id, o.price, o.qty, o.side}, out_, leaves) ==
+                EngineResult::Rejected)
+                reject(s, o.order_id);              // on the new id: the tracker undoes the replace
+            else
+                report(s, ExecReport{ExecReport::Ack, o.order_id, 0, 0, leaves});
+            break;
+        }
+        case CancelType: {
+            CancelMsg m;
+            std::memcpy(&m, p, sizeof(m));
+            if (engine_.cancel(m.order_id, owner, out_)) report(s, ExecReport{ExecReport::Cancelled, m.order_id, 0, 0, 0});
+            else reject(s, m.order_id);
+            break;
+        }
+        }
+        for (const Trade& t : out_.trades) {
+            deliver(t.maker_owner, ExecReport{ExecReport::Fill, t.maker_id, t.qty, t.price, t.maker_leaves});
+            report(s, ExecReport{ExecReport::Fill, t.taker_id, t.qty, t.price, t.taker_leaves});
+        }
+        stats_.trades += out_.trades.size();
+        queue_ticks();
+    }
+
+    void reject(Session& s, uint64_t order_id) {
+        ++stats_.rejects;
+        report(s, ExecReport{ExecReport::Rejected, order_id, 0, 0, 0});
+    }
+
+    void report(Session& s, const ExecReport& r) {
+        s.out.append(reinterpret_cast<const char*>(&r), sizeof(r));
+        if (!s.dirty) {
+            s.dirty = true;
+            dirty_.push_back(s.fd);
+        }
+    }
+
+    void deliver(uint32_t owner, const ExecReport& r) {
+        const auto it = sessions_.find(static_cast<int>(owner));
+        if (it != sessions_.end()) report(it->second, r);
+    }
+
+    void flush(Session& s) {
+        s.dirty = false;
+        while (s.out_off < s.out.size()) {
+            const ssize_t w = send(s.fd, s.out.data() + s.out_off, s.out.size() - s.out_off, MSG_NOSIGNAL);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) closing_.push_back(s.fd);
+                break;
+            }
+            s.out_off += static_cast<std::size_t>(w);
+        }
+        if (s.out_off == s.out.size()) {
+            s.out.clear();
+            s.out_off = 0;
+        }
+        const bool want = !s.out.empty();
+        if (want != s.want_out) {
+            s.want_out = want;
+            epoll_event ev{};
+            ev.events = EPOLLIN | (want ? EPOLLOUT : 0u);
+            ev.data.fd = s.fd;
+            epoll_ctl(ep_, EPOLL_CTL_MOD, s.fd, &ev);
+        }
+    }
+
+    // Session gone: pull its resting orders so nobody trades against a ghost.
+    void drop(int fd) {
+        const auto it = sessions_.find(fd);
+        if (it == sessions_.end()) return;
+        epoll_ctl(ep_, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        sessions_.erase(it);
+        out_.clear();
+        engine_.cancel_all(static_cast<uint32_t>(fd), out_, [](uint64_t) {});
+        queue_ticks();
+    }
+
+    void queue_ticks() {
+        const uint64_t ts = TscClock::instance().now_wall_ns();
+        auto push = [&](uint32_t instr, Price px, uint64_t qty) {
+            if (feed_.size() == MAX_TICKS_PER_DATAGRAM) publish();
+            feed_.push_back(TickerData{ts, instr, px.to_double(), static_cast<uint32_t>(std::min<uint64_t>(qty, UINT32_MAX))});
+        };
+        for (const Trade& t : out_.trades) push(t.instr_id, t.price, t.qty);
+        for (const LevelChange& l : out_.levels) push(l.instr_id, l.price, l.qty);
+    }
+
+    void publish() {
+        if (feed_.empty()) return;
+        sendto(feed_fd_, feed_.data(), feed_.size() * sizeof(TickerData), 0, reinterpret_cast<const sockaddr*>(&feed_addr_),
+               sizeof(feed_addr_));
+        stats_.ticks += feed_.size();
+        ++stats_.datagrams;
+        feed_.clear();
+    }
+
+    ExchangeSimOptions opt_;
+    int ep_{-1};
+    int listen_fd_{-1};
+    int feed_fd_{-1};
+    uint16_t port_{0};
+    sockaddr_in feed_addr_{};
+    std::atomic<bool> running_{false};
+    std::vector<epoll_event> events_;
+    std::unordered_map<int, Session> sessions_;
+    std::vector<int> dirty_;
+    std::vector<int> closing_;
+    MatchingEngine engine_;
+    MatchOutput out_;
+    std::vector<TickerData> feed_;
+    ExchangeSimStats stats_;
+};
+
+// Two kernel TCP sessions trade against each other through the simulator; the feed goes unicast to a local socket.
+std::string EXCHANGE_SIM_Test()
+{
+    std::stringstream ss;
+    const int feed = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in fa{};
+    fa.sin_family = AF_INET;
+    fa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(feed, reinterpret_cast<sockaddr*>(&fa), sizeof(fa));
+    socklen_t flen = sizeof(fa);
+    getsockname(feed, reinterpret_cast<sockaddr*>(&fa), &flen);
+    timeval tv{1, 0};
+    setsockopt(feed, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    ExchangeSimOptions opt;
+    opt.port = 0;
+    opt.feed_ip = "127.0.0.1";
+    opt.feed_port = ntohs(fa.sin_port);
+    ExchangeSim sim(opt);
+    std::thread server([&] { sim.run(); });
+
+    auto connect_to = [&] {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in a{};
+        a.sin_family = AF_INET;
+        a.sin_port = htons(sim.port());
+        a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        connect(fd, reinterpret_cast<sockaddr*>(&a), sizeof(a));
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        return fd;
+    };
+    auto reports = [&](int fd, int n) {
+        for (int i = 0; i < n; ++i) {
+            ExecReport r{};
+            std::size_t got = 0;
+            while (got < sizeof(r)) {
+                const ssize_t k = recv(fd, reinterpret_cast<char*>(&r) + got, sizeof(r) - got, 0);
+                if (k <= 0) return;
+                got += static_cast<std::size_t>(k);
+            }
+            ss << r.type << r.order_id;
+            if (r.type == ExecReport::Fill) ss << "/" << r.last_qty << "@" << r.last_px;
+            ss << "/" << r.leaves_qty << " ";
+        }
+    };
+    auto send_msg = [](int fd, const auto& m) { send(fd, &m, sizeof(m), 0); };
+
+    const int a = connect_to(), b = connect_to();
+    send_msg(a, NewOrderMsg{NewOrderType, Order{1, 7, 100_px, 10, 'S'}});
+    reports(a, 1);
+    send_msg(b, NewOrderMsg{NewOrderType, Order{2, 7, 100_px, 15, 'B'}});          // takes all of 1, rests 5
+    reports(b, 2);
+    reports(a, 1);
+    send_msg(b, ReplaceMsg{ReplaceType, 2, Order{3, 7, 99_px, 20, 'B'}});          // 10 filled -> 10 open at 99
+    send_msg(b, CancelMsg{CancelType, 3});
+    send_msg(a, CancelMsg{CancelType, 1});                                        // already filled
+    reports(b, 2);
+    reports(a, 1);
+    send_msg(b, NewOrderMsg{NewOrderType, Order{4, 7, 98_px, 1, 'B'}});
+    reports(b, 1);
+    close(b);                                                                     // cancel-on-disconnect
+
+    ss << "| ";
+    int ticks = 0;
+    while (ticks < 9) {
+        TickerData t[ExchangeSim::MAX_TICKS_PER_DATAGRAM];
+        const ssize_t n = recv(feed, t, sizeof(t), 0);
+        if (n <= 0) break;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(n) / sizeof(TickerData); ++i, ++ticks)
+            ss << t[i].qty << "@" << t[i].price << " ";
+    }
+    sim.stop();
+    server.join();
+    close(a);
+    close(feed);
+    ss << "open=" << sim.engine().open() << " trades=" << sim.stats().trades << " rejects=" << sim.stats().rejects;
+    return ss.str();
+}
@@ -0,0 +1,387 @@
+/*
+        Design notes
+
+        FIX tag-value order encoder
+
+        Venues that speak FIX 4.2/4.4 get a NewOrderSingle (35=D) per Order. Formatting tag=value text with
+        snprintf costs a microsecond; this encoder stays under 100ns by doing almost nothing per message:
+
+        - one message buffer per session, built once at construction: BeginString, the constant BodyLength, MsgType,
+          Sender/TargetCompID and every constant field (HandlInst, OrdType, TimeInForce) are already in place. An
+          encode only overwrites the variable bytes; nothing is shifted or appended.
+        - every variable field is fixed width and zero padded (FIX int/float permit leading zeros; float permits
+          trailing zeros): MsgSeqNum, instrument and qty 10 digits, ClOrdID 20, Price 8.8, timestamps with millis.
+          So the message length, and BodyLength (9=), never change for a session. Price 8.8 is exactly the digits
+          of Price::raw, so the price is written as is, with no scaling or rounding.
+        - digits come from SSE2 (8 digits per 16-bit lane vector, two halves packed into one 16-byte register), not
+          from a divide-by-ten loop. x86-64 guarantees SSE2; other targets fall back to a scalar loop.
+        - CheckSum (10=) is the byte sum of the constant bytes, computed once, plus the byte sum of the patched fields
+          only. Digit fields are summed in-register with psadbw before they are stored.
+        - timestamps: the "YYYYMMDD-HH:MM:SS." part (and its byte sum) is reformatted only when the second changes;
+          per message only the three millisecond digits are written. SendingTime and TransactTime are the same.
+        - the encoder owns the outbound MsgSeqNum; an order that fails to encode (price out of range) does not use
+          a sequence number.
+
+        Not thread-safe: one encoder per session, on the session's thread. The returned view points into the
+        encoder's buffer and is valid until the next encode.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "order-wire.h"
+#include "tsc-clock.h"
+
+// ---------- digits ----------
+namespace fix_detail {
+
+inline constexpr char SOH = '\x01';
+
+// Fixed-width decimal digits of v, most significant first. v must be below 10^16.
+struct Digits16 {
+    alignas(16) char d[16];
+    uint32_t sum;           // byte sum of all 16 ASCII digits
+};
+
+inline void digits16_scalar(uint64_t v, Digits16& out) noexcept {
+    uint32_t sum = 0;
+    for (int i = 15; i >= 0; --i) {
+        out.d[i] = static_cast<char>('0' + v % 10);
+        sum += static_cast<unsigned char>(out.d[i]);
+        v /= 10;
+    }
+    out.sum = sum;
+}
+
+#if defined(__SSE2__)
+// Eight decimal digits of v < 10^8 as eight 16-bit lanes: v = abcd * 10^4 + efgh, then each half divided by
+// 10^3..10^0 with a multiply-high by a reciprocal, and the digit extracted as (v / 10^k) - 10 * (v / 10^(k+1)).
+inline __m128i digits8_sse2(uint32_t v) noexcept {
+    const __m128i div10000 = _mm_set1_epi32(static_cast<int>(0xd1b71759u));       // ceil(2^45 / 10^4)
+    const __m128i k10000 = _mm_set1_epi32(10000);
+    const __m128i div_powers = _mm_setr_epi16(8389, 5243, 13108, static_cast<short>(32768),
+                                              8389, 5243, 13108, static_cast<short>(32768));
+    const __m128i shift_powers = _mm_setr_epi16(1 << 7, 1 << 11, 1 << 13, static_cast<short>(1 << 15),
+                                                1 << 7, 1 << 11, 1 << 13, static_cast<short>(1 << 15));
+    const __m128i k10 = _mm_set1_epi16(10);
+
+    const __m128i x = _mm_cvtsi32_si128(static_cast<int>(v));
+    const __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(x, div10000), 45);
+    const __m128i efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, k10000));
+    const __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);                // [abcd*4, efgh*4, ...]
+    const __m128i v2 = _mm_unpacklo_epi32(_mm_unpacklo_epi16(v1, v1), _mm_unpacklo_epi16(v1, v1));
+    const __m128i v4 = _mm_mulhi_epu16(_mm_mulhi_epu16(v2, div_powers), shift_powers);  // a, ab, abc, abcd, e, ...
+    return _mm_sub_epi16(v4, _mm_slli_epi64(_mm_mullo_epi16(v4, k10), 16));             // a, b, c, d, e, ...
+}
+
+inline void digits16(uint64_t v, Digits16& out) noexcept {
+    const auto hi = static_cast<uint32_t>(v / 100000000u);
+    const auto lo = static_cast<uint32_t>(v % 100000000u);
+    const __m128i ascii = _mm_add_epi8(_mm_packus_epi16(digits8_sse2(hi), digits8_sse2(lo)), _mm_set1_epi8('0'));
+    _mm_store_si128(reinterpret_cast<__m128i*>(out.d), ascii);
+    const __m128i sad = _mm_sad_epu8(ascii, _mm_setzero_si128());
+    out.sum = static_cast<uint32_t>(_mm_cvtsi128_si32(sad) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sad, sad)));
+}
+#else
+inline void digits16(uint64_t v, Digits16& out) noexcept { digits16_scalar(v, out); }
+#endif
+
+// Last W digits of v into dst; returns their byte sum. v must be below 10^W (W <= 16).
+template <std::size_t W>
+inline uint32_t put_digits(char* dst, uint64_t v) noexcept {
+    static_assert(W > 0 && W <= 16);
+    Digits16 d;
+    digits16(v, d);
+    std::memcpy(dst, d.d + 16 - W, W);
+    return d.sum - static_cast<uint32_t>(16 - W) * '0';
+}
+
+} // namespace fix_detail
+
+// ---------- encoder ----------
+enum class FixVersion : uint8_t { Fix42, Fix44 };
+
+struct FixSessionConfig {
+    FixVersion version = FixVersion::Fix44;
+    std::string sender_comp_id;
+    std::string target_comp_id;
+    uint32_t next_seq_num = 1;
+};
+
+class FixOrderEncoder {
+public:
+    static constexpr uint64_t MAX_PRICE_SCALED = 100000000ull * 100000000ull;   // prices below 10^8, 8 decimals
+
+    explicit FixOrderEncoder(const FixSessionConfig& cfg)
+    : seq_(cfg.next_seq_num)
+    {
+        auto valid = [](const std::string& id) {
+            return !id.empty() && id.size() <= 32 && id.find_first_of(std::string_view("\x01=", 2)) == std::string::npos;
+        };
+        if (!valid(cfg.sender_comp_id) || !valid(cfg.target_comp_id)) {
+            throw std::runtime_error("FIX CompIDs must be 1-32 characters without SOH or '='");
+        }
+
+        // Body: everything after the BodyLength field up to (not including) "10=". Variable fields hold zeros.
+        std::string body;
+        auto field = [&](const char* tag, std::string_view value) -> std::size_t {
+            body += tag;
+            body += '=';
+            const std::size_t at = body.size();
+            body += value;
+            body += fix_detail::SOH;
+            return at;
+        };
+        const std::string ts(TS_LEN, '0');
+        field("35", "D");
+        field("49", cfg.sender_comp_id);
+        field("56", cfg.target_comp_id);
+        const std::size_t seq = field("34", std::string(10, '0'));
+        const std::size_t sending = field("52", ts);
+        const std::size_t clordid = field("11", std::string(20, '0'));
+        field("21", "1");                                     // automated execution, no intervention
+        const std::size_t symbol = field("55", std::string(10, '0'));
+        const std::size_t side = field("54", "1");
+        const std::size_t transact = field("60", ts);
+        const std::size_t qty = field("38", std::string(10, '0'));
+        field("40", "2");                                     // limit
+        const std::size_t price = field("44", "00000000.00000000");
+        field("59", "0");                                     // day
+
+        const std::string head = std::string("8=") + (cfg.version == FixVersion::Fix42 ? "FIX.4.2" : "FIX.4.4") +
+                                 fix_detail::SOH + "9=" + std::to_string(body.size()) + fix_detail::SOH;
+        const std::string msg = head + body + "10=000" + fix_detail::SOH;
+        if (msg.size() > buf_.size()) throw std::runtime_error("FIX CompIDs too long for the message buffer");
+        std::memcpy(buf_.data(), msg.data(), msg.size());
+        size_ = msg.size();
+        checksum_at_ = msg.size() - 4;
+
+        seq_at_ = head.size() + seq;
+        sending_at_ = head.size() + sending;
+        clordid_at_ = head.size() + clordid;
+        symbol_at_ = head.size() + symbol;
+        side_at_ = head.size() + side;
+        transact_at_ = head.size() + transact;
+        qty_at_ = head.size() + qty;
+        price_at_ = head.size() + price;
+
+        // Constant part of the checksum: every byte before "10=", less what the variable fields hold right now.
+        uint32_t all = 0;
+        for (std::size_t i = 0; i < checksum_at_ - 3; ++i) all += static_cast<unsigned char>(buf_[i]);
+        auto held = [&](std::size_t at, std::size_t n) {
+            uint32_t s = 0;
+            for (std::size_t i = 0; i < n; ++i) s += static_cast<unsigned char>(buf_[at + i]);
+            return s;
+        };
+        const_sum_ = all - held(seq_at_, 10) - held(sending_at_, TS_LEN) - held(clordid_at_, 20) -
+                     held(symbol_at_, 10) - held(side_at_, 1) - held(transact_at_, TS_LEN) - held(qty_at_, 10) -
+                     held(price_at_, 8) - held(price_at_ + 9, 8);
+    }
+
+    FixOrderEncoder(const FixOrderEncoder&) = delete;
+    FixOrderEncoder& operator=(const FixOrderEncoder&) = delete;
+
+    // Hot path. The NewOrderSingle for o, stamped with wall_ns (ns since the epoch, UTC) and the next MsgSeqNum.
+    // Empty if the price is negative or not below 10^8; the sequence number is then not used.
+    std::string_view new_order_single(const Order& o, uint64_t wall_ns) noexcept {
+        const auto px = static_cast<uint64_t>(o.price.raw);
+        if (px >= MAX_PRICE_SCALED) [[unlikely]] return {};      // negative wraps above it
+
+        char* b = buf_.data();
+        uint32_t sum = const_sum_;
+        sum += fix_detail::put_digits<10>(b + seq_at_, seq_);
+        sum += fix_detail::put_digits<4>(b + clordid_at_, o.order_id / 10000000000000000ull);
+        sum += fix_detail::put_digits<16>(b + clordid_at_ + 4, o.order_id % 10000000000000000ull);
+        sum += fix_detail::put_digits<10>(b + symbol_at_, o.instr_id);
+        b[side_at_] = static_cast<char>('1' + (o.side == 'S'));
+        sum += static_cast<unsigned char>(b[side_at_]);
+        sum += fix_detail::put_digits<10>(b + qty_at_, o.qty);
+        sum += fix_detail::put_digits<8>(b + price_at_, px / 100000000u);
+        sum += fix_detail::put_digits<8>(b + price_at_ + 9, px % 100000000u);   // '.' is constant
+        sum += 2 * stamp(wall_ns);
+
+        b[checksum_at_] = static_cast<char>('0' + (sum & 0xff) / 100);
+        b[checksum_at_ + 1] = static_cast<char>('0' + (sum & 0xff) / 10 % 10);
+        b[checksum_at_ + 2] = static_cast<char>('0' + (sum & 0xff) % 10);
+        ++seq_;
+        return {b, size_};
+    }
+
+    std::string_view new_order_single(const Order& o) noexcept {
+        return new_order_single(o, TscClock::instance().now_wall_ns());
+    }
+
+    uint32_t next_seq_num() const noexcept { return seq_; }
+    void set_next_seq_num(uint32_t seq) noexcept { seq_ = seq; }
+    std::size_t size() const noexcept { return size_; }   // every message of this session has this length
+
+private:
+    static constexpr std::size_t TS_LEN = 21;              // YYYYMMDD-HH:MM:SS.sss
+
+    // Writes SendingTime and TransactTime; returns the byte sum of one of them.
+    uint32_t stamp(uint64_t wall_ns) noexcept {
+        const uint64_t sec = wall_ns / 1000000000u;
+        if (sec != cached_sec_) [[unlikely]] {
+            const auto t = static_cast<std::time_t>(sec);
+            std::tm tm{};
+            gmtime_r(&t, &tm);
+            char tmp[32];
+            std::snprintf(tmp, sizeof(tmp), "%04d%02d%02d-%02d:%02d:%02d.", (tm.tm_year + 1900) % 10000,
+                          tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+            std::memcpy(buf_.data() + sending_at_, tmp, TS_LEN - 3);
+            std::memcpy(buf_.data() + transact_at_, tmp, TS_LEN - 3);
+            sec_sum_ = 0;
+            for (std::size_t i = 0; i < TS_LEN - 3; ++i) sec_sum_ += static_cast<unsigned char>(tmp[i]);
+            cached_sec_ = sec;
+        }
+        const auto ms = static_cast<uint32_t>(wall_ns / 1000000u % 1000u);
+        const char m[3] = {static_cast<char>('0' + ms / 100), static_cast<char>('0' + ms / 10 % 10),
+                           static_cast<char>('0' + ms % 10)};
+        std::memcpy(buf_.data() + sending_at_ + TS_LEN - 3, m, 3);
+        std::memcpy(buf_.data() + transact_at_ + TS_LEN - 3, m, 3);
+        return sec_sum_ + static_cast<unsigned char>(m[0]) + static_cast<unsigned char>(m[1]) +
+               static_cast<unsigned char>(m[2]);
+    }
+
+    alignas(CACHELINE_SIZE) std::array<char, 320> buf_{};
+    std::size_t size_ = 0;
+    std::size_t checksum_at_ = 0;
+    std::size_t seq_at_ = 0, sending_at_ = 0, clordid_at_ = 0, symbol_at_ = 0, side_at_ = 0, transact_at_ = 0,
+                qty_at_ = 0, price_at_ = 0;
+    uint32_t const_sum_ = 0;
+    uint32_t seq_;
+    uint64_t cached_sec_ = ~0ull;
+    uint32_t sec_sum_ = 0;
+};
+
+// ---------- reference ----------
+// What the encoder replaces: the same message formatted field by field, BodyLength and CheckSum computed over the
+// finished text. Used by the test as an oracle and by the benchmark as the baseline.
+inline std::string fix_new_order_single_reference(const FixSessionConfig& cfg, uint32_t seq, const Order& o,
+                                                  uint64_t wall_ns)
+{
+    const auto t = static_cast<std::time_t>(wall_ns / 1000000000u);
+    std::tm tm{};
+    gmtime_r(&t, &tm);
+    char ts[64];
+    std::snprintf(ts, sizeof(ts), "%04d%02d%02d-%02d:%02d:%02d.%03u", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<unsigned>(wall_ns / 1000000u % 1000u));
+    const auto px = static_cast<uint64_t>(o.price.raw);
+    char body[320];
+    const int n = std::snprintf(body, sizeof(body),
+        "35=D\x01" "49=%s\x01" "56=%s\x01" "34=%010u\x01" "52=%s\x01" "11=%020llu\x01" "21=1\x01" "55=%010u\x01"
+        "54=%c\x01" "60=%s\x01" "38=%010u\x01" "40=2\x01" "44=%08llu.%08llu\x01" "59=0\x01",
+        cfg.sender_comp_id.c_str(), cfg.target_comp_id.c_str(), seq, ts,
+        static_cast<unsigned long long>(o.order_id), o.instr_id, o.side == 'S' ? '2' : '1', ts, o.qty,
+        static_cast<unsigned long long>(px / 100000000u), static_cast<unsigned long long>(px % 100000000u));
+    std::string msg = std::string("8=") + (cfg.version == FixVersion::Fix42 ? "FIX.4.2" : "FIX.4.4") + '\x01' +
+                      "9=" + std::to_string(n) + '\x01' + std::string(body, static_cast<std::size_t>(n));
+    unsigned sum = 0;
+    for (unsigned char c : msg) sum += c;
+    char trailer[8];
+    std::snprintf(trailer, sizeof(trailer), "10=%03u\x01", sum & 0xff);
+    return msg + trailer;
+}
+
+// Exact bytes of one message (SOH shown as '|'), digits against the scalar path, and a sweep against the reference.
+std::string FIX_ENCODER_Test()
+{
+    std::stringstream ss;
+    std::mt19937_64 rng(42);
+
+    bool digits = true;
+    for (int i = 0; i < 100000; ++i) {
+        const uint64_t v = rng() % 10000000000000000ull >> (rng() % 54);
+        fix_detail::Digits16 a, b;
+        fix_detail::digits16(v, a);
+        fix_detail::digits16_scalar(v, b);
+        digits &= std::memcmp(a.d, b.d, 16) == 0 && a.sum == b.sum;
+    }
+    for (uint64_t v : {0ull, 9ull, 99999999ull, 100000000ull, 9999999999999999ull}) {
+        fix_detail::Digits16 a, b;
+        fix_detail::digits16(v, a);
+        fix_detail::digits16_scalar(v, b);
+        digits &= std::memcmp(a.d, b.d, 16) == 0 && a.sum == b.sum;
+    }
+
+    FixSessionConfig cfg{FixVersion::Fix42, "HFTL", "XCHG", 7};
+    FixOrderEncoder enc(cfg);
+    const uint64_t t0 = 1704164645678000000ull;    // 2024-01-02 03:04:05.678 UTC
+    std::string first(enc.new_order_single(Order{123456789, 1001, 101.25_px, 50, 'B'}, t0));
+    std::replace(first.begin(), first.end(), '\x01', '|');
+
+    bool match = true;
+    int n = 0;
+    for (; n < 2000; ++n) {
+        const Order o{rng(), static_cast<uint32_t>(rng()), Price::from_raw(static_cast<int64_t>(rng() % 10000000000ull) * 1'000'000),
+                      static_cast<uint32_t>(rng()), rng() % 2 ? 'S' : 'B'};
+        const uint64_t ns = t0 + rng() % 3000000000000ull;
+        const uint32_t seq = enc.next_seq_num();
+        match &= enc.new_order_single(o, ns) == fix_new_order_single_reference(cfg, seq, o, ns);
+    }
+    const bool refused = enc.new_order_single(Order{1, 1, -1_px, 1, 'B'}, t0).empty() &&
+                         enc.new_order_single(Order{1, 1, 100'000'000_px, 1, 'B'}, t0).empty();
+
+    ss << first << " digits=" << digits << " reference=" << match << " refused=" << refused
+       << " seq=" << enc.next_seq_num();
+    return ss.str();
+}
+
+// ns per NewOrderSingle: the patching encoder against snprintf formatting of the same message.
+void FIX_ENCODER_BENCH()
+{
+    constexpr int N = 1000000;
+    FixSessionConfig cfg{FixVersion::Fix44, "HFTLEARN01", "EXCHANGE01", 1};
+    FixOrderEncoder enc(cfg);
+    std::vector<Order> orders(1024);
+    std::mt19937_64 rng(7);
+    for (auto& o : orders) {
+        o = Order{rng() % 100000000000ull, static_cast<uint32_t>(rng() % 5000), 100_px + Price::from_raw(static_cast<int64_t>(rng() % 10000) * 1'000'000),
+                  static_cast<uint32_t>(rng() % 1000 + 1), rng() % 2 ? 'S' : 'B'};
+    }
+    uint64_t wall = TscClock::instance().now_wall_ns();
+    uint64_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) {
+        wall += 1000;
+        sink += static_cast<unsigned char>(enc.new_order_single(orders[static_cast<std::size_t>(i) & 1023], wall).back());
+    }
+    const double fast = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) {
+        sink += static_cast<unsigned char>(enc.new_order_single(orders[static_cast<std::size_t>(i) & 1023]).back());
+    }
+    const double with_clock = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    constexpr int M = N / 10;
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < M; ++i) {
+        wall += 1000;
+        sink += fix_new_order_single_reference(cfg, static_cast<uint32_t>(i), orders[static_cast<std::size_t>(i) & 1023], wall).size();
+    }
+    const double slow = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / M;
+
+    std::cout << "FIX_ENCODER_BENCH NewOrderSingle (" << enc.size() << " bytes): " << fast << " ns, with wall clock read: "
+              << with_clock << " ns, snprintf reference: " << slow << " ns (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,642 @@
+/*
+        Design notes
+
+        SIMD FIX tag-value parser
+
+        The read side of a FIX session: ExecutionReports arrive as a TCP byte stream and have to be parsed as fast as
+        FixOrderEncoder writes orders. FixParser frames messages, checks them and hands back only the tags the caller
+        asked for.
+
+        - framing reads BeginString and BodyLength only: the message length is known from its first ~20 bytes, so
+          a message is never scanned for "10=".
+        - one vector pass over the message classifies every byte: compares against SOH and '=' 32 bytes at a time
+          (AVX2) or 16 (SSE2), movemasks assembled into one 64-bit word per 64 bytes, and psadbw sums the same
+          registers for the CheckSum.
+        - the field walk clears SOH bits one at a time (tzcnt/blsr), so fields do not wait on each other. A field's
+          tag ends at the first '=' after its start, read from the '=' bitset with one unaligned load; '=' inside a
+          value (Text, 58) is never looked at.
+        - tags are matched on their raw bytes, not converted: the 1-5 tag characters as a zero-extended word, one
+          multiply into a 1024-entry table whose multiplier is chosen at construction so requested tags never
+          collide. A match records an (offset, length) span; unwanted tags go to a scratch span, so there is no
+          branch on it. Nothing is copied, converted or allocated; values are converted on demand (fix_uint,
+          fix_price) by whoever reads them.
+        - messages wholly inside one read are parsed in place. A message cut by a read boundary is staged: the
+          tail is copied into a fixed 4KB buffer and completed from the next read, like ExecReportParser.
+        - garbage or an oversized message drops input up to the next "8=FIX"; a bad CheckSum drops the message.
+          Both are counted, neither throws.
+
+        AVX2 is used when the build enables it (-mavx2 or -march); otherwise SSE2, which every x86-64 has. FixMessage
+        spans point into the read buffer or the stage and are only valid inside the callback.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "fix-encoder.h"
+#include "order-wire.h"
+
+// ---------- message ----------
+struct FixSpan {
+    uint32_t off;
+    uint32_t len;
+};
+
+// One framed message and the spans of the requested tags, by slot (the tag's position in the parser's list).
+struct FixMessage {
+    static constexpr std::size_t MAX_SLOTS = 64;
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+    uint64_t present = 0;                       // bit per slot
+    std::array<FixSpan, MAX_SLOTS + 1> spans;   // the last one takes the tags nobody asked for
+
+    bool has(std::size_t slot) const noexcept { return present >> slot & 1; }
+    std::string_view get(std::size_t slot) const noexcept {
+        return has(slot) ? std::string_view(data + spans[slot].off, spans[slot].len) : std::string_view{};
+    }
+    char chr(std::size_t slot) const noexcept { return has(slot) && spans[slot].len ? data[spans[slot].off] : '\0'; }
+};
+
+// Unsigned integer value; 0 for an empty or non-numeric value.
+inline uint64_t fix_uint(std::string_view v) noexcept {
+    uint64_t x = 0;
+    for (char c : v) {
+        if (c < '0' || c > '9') [[unlikely]] return 0;
+        x = x * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return x;
+}
+
+// Decimal value such as "101.25" or "-0.5", exact; 0 for an empty or malformed value or one finer than 1e-8.
+inline Price fix_price(std::string_view v) noexcept {
+    Price p{0};
+    parse_price(v, p);
+    return p;
+}
+
+// ---------- parser ----------
+struct FixParserStats {
+    uint64_t messages = 0;
+    uint64_t bad_checksum = 0;
+    uint64_t malformed = 0;     // not FIX framing, bad tag, or larger than MAX_MSG; input skipped to the next "8=FIX"
+    uint64_t staged = 0;        // messages completed across reads
+};
+
+class FixParser {
+public:
+    static constexpr std::size_t MAX_MSG = 4096;
+    static constexpr int MAX_TAG = 99999;
+
+    // tags: the tags to extract; slot i of every FixMessage holds tags[i].
+    FixParser(std::initializer_list<int> tags, bool verify_checksum = true)
+    : verify_(verify_checksum)
+    {
+        if (tags.size() > FixMessage::MAX_SLOTS) throw std::runtime_error("FixParser: more than 64 tags requested");
+        std::vector<uint64_t> keys;
+        for (int t : tags) {
+            if (t <= 0 || t > MAX_TAG) throw std::runtime_error("FixParser: tag out of range");
+            const std::string text = std::to_string(t);
+            keys.push_back(tag_key_of(text));
+            if (std::count(keys.begin(), keys.end(), keys.back()) > 1) throw std::runtime_error("FixParser: duplicate tag");
+        }
+        // Pick a multiplier that gives every requested tag its own bucket, so a lookup never probes.
+        for (mult_ = 0x9e3779b97f4a7c15ull;; mult_ += 0x5851f42d4c957f2eull) {
+            tags_.fill(TagEntry{EMPTY_KEY, FixMessage::MAX_SLOTS});
+            bool clash = false;
+            for (std::size_t i = 0; i < keys.size() && !clash; ++i) {
+                TagEntry& t = tags_[(keys[i] * mult_) >> (64 - TAG_BITS)];
+                clash = t.key != EMPTY_KEY;
+                t = TagEntry{keys[i], i};
+            }
+            if (!clash) break;
+        }
+    }
+
+    FixParser(const FixParser&) = delete;
+    FixParser& operator=(const FixParser&) = delete;
+
+    // Feed the next bytes of the stream; f(const FixMessage&) per complete, valid message. Returns messages delivered.
+    template <class F>
+    std::size_t feed(const char* p, std::size_t n, F&& f) noexcept {
+        std::size_t msgs = 0;
+        while (have_ && n) {
+            // Complete the staged message. Only what it still needs is consumed; the rest is parsed in place below.
+            const std::size_t take = std::min(n, MAX_MSG - have_);
+            std::memcpy(stage_.data() + have_, p, take);
+            const std::size_t total = frame(stage_.data(), have_ + take);
+            if (total == MALFORMED || (total == NEED_MORE && have_ + take == MAX_MSG)) {
+                msgs += resync_stage(f);
+                continue;
+            }
+            if (total == NEED_MORE) {
+                have_ += take;
+                return msgs;
+            }
+            if (total <= have_) [[unlikely]] {
+                // Whole message already staged: none of the new bytes belong to it.
+                msgs += resync_stage(f, 0);
+                continue;
+            }
+            const std::size_t used = total - have_;
+            p += used;
+            n -= used;
+            have_ = 0;
+            ++stats_.staged;
+            msgs += deliver(stage_.data(), total, f);
+        }
+        while (n) {
+            const std::size_t total = frame(p, n);
+            if (total == NEED_MORE) {
+                if (n >= MAX_MSG) {
+                    ++stats_.malformed;
+                    skip_to_next(p, n, 1);
+                    continue;
+                }
+                std::memcpy(stage_.data(), p, n);
+                have_ = n;
+                break;
+            }
+            if (total == MALFORMED) {
+                ++stats_.malformed;
+                skip_to_next(p, n, 1);
+                continue;
+            }
+            msgs += deliver(p, total, f);
+            p += total;
+            n -= total;
+        }
+        return msgs;
+    }
+
+    std::size_t pending() const noexcept { return have_; }
+    const FixParserStats& stats() const noexcept { return stats_; }
+
+private:
+    static constexpr int TAG_BITS = 10;
+    static constexpr uint64_t EMPTY_KEY = ~uint64_t{0};
+    static constexpr std::size_t NEED_MORE = 0;
+    static constexpr std::size_t MALFORMED = ~std::size_t{0};
+    static constexpr std::size_t WORDS = MAX_MSG / 64;
+    static constexpr std::size_t TRAILER = 7;        // "10=nnn" SOH
+
+    struct TagEntry {
+        uint64_t key;
+        std::size_t slot;
+    };
+
+    static uint64_t tag_key_of(const std::string& tag) noexcept {
+        uint64_t key = 0;
+        std::memcpy(&key, tag.data(), tag.size());
+        return key;
+    }
+
+    // Length of the message at p if it is complete in [p, p + n), NEED_MORE if not yet, MALFORMED if not FIX.
+    static std::size_t frame(const char* p, std::size_t n) noexcept {
+        static constexpr char begin[] = "8=FIX";
+        if (std::memcmp(p, begin, std::min<std::size_t>(n, 5)) != 0) return MALFORMED;
+        std::size_t i = 5;
+        for (; i < n && i < 16 && p[i] != fix_detail::SOH; ++i) {}
+        if (i + 3 > n) return n < 16 + 3 ? NEED_MORE : MALFORMED;
+        if (p[i] != fix_detail::SOH || p[i + 1] != '9' || p[i + 2] != '=') return MALFORMED;
+        std::size_t len = 0, j = i + 3;
+        for (; j < n && j < i + 3 + 6 && p[j] >= '0' && p[j] <= '9'; ++j) len = len * 10 + static_cast<std::size_t>(p[j] - '0');
+        if (j == n) return NEED_MORE;
+        if (p[j] != fix_detail::SOH || j == i + 3) return MALFORMED;
+        const std::size_t total = j + 1 + len + TRAILER;
+        if (total > MAX_MSG) return MALFORMED;
+        if (total > n) return NEED_MORE;
+        const char* t = p + total - TRAILER;
+        if (t[0] != '1' || t[1] != '0' || t[2] != '=' || t[6] != fix_detail::SOH) return MALFORMED;
+        return total;
+    }
+
+    // Classify [p, p + n) into SOH and '=' bitsets, one word per 64 bytes plus a zero spare word, and return the
+    // byte sum. Each word is built in registers and stored once; the last partial chunk goes through a zero-padded copy.
+    static uint32_t classify(const char* p, std::size_t n, uint64_t* soh, uint64_t* eq) noexcept {
+        uint32_t sum = 0;
+#if defined(__AVX2__)
+        const __m256i vsoh = _mm256_set1_epi8(fix_detail::SOH), veq = _mm256_set1_epi8('='), zero = _mm256_setzero_si256();
+        __m256i acc = zero;
+        auto word = [&](const char* q, std::size_t w) {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + 32));
+            auto mask = [](__m256i x, __m256i c) { return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, c)))); };
+            soh[w] = mask(a, vsoh) | mask(b, vsoh) << 32;
+            eq[w] = mask(a, veq) | mask(b, veq) << 32;
+            acc = _mm256_add_epi64(acc, _mm256_add_epi64(_mm256_sad_epu8(a, zero), _mm256_sad_epu8(b, zero)));
+        };
+#elif defined(__SSE2__)
+        const __m128i vsoh = _mm_set1_epi8(fix_detail::SOH), veq = _mm_set1_epi8('='), zero = _mm_setzero_si128();
+        __m128i acc = zero;
+        auto word = [&](const char* q, std::size_t w) {
+            uint64_t s = 0, e = 0;
+            for (int k = 0; k < 4; ++k) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(q + 16 * k));
+                s |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, vsoh)))) << (16 * k);
+                e |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, veq)))) << (16 * k);
+                acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+            }
+            soh[w] = s;
+            eq[w] = e;
+        };
+#else
+        auto word = [&](const char* q, std::size_t w) {
+            uint64_t s = 0, e = 0;
+            for (int k = 0; k < 64; ++k) {
+                s |= uint64_t{q[k] == fix_detail::SOH} << k;
+                e |= uint64_t{q[k] == '='} << k;
+                sum += static_cast<unsigned char>(q[k]);
+            }
+            soh[w] = s;
+            eq[w] = e;
+        };
+#endif
+        std::size_t w = 0;
+        for (; (w + 1) * 64 <= n; ++w) word(p + w * 64, w);
+        if (w * 64 < n) {
+            alignas(64) char tail[64] = {};
+            std::memcpy(tail, p + w * 64, n - w * 64);
+            word(tail, w++);
+        }
+        soh[w] = eq[w] = 0;
+#if defined(__AVX2__)
+        const __m128i s = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si64(s) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(s, s)));
+#elif defined(__SSE2__)
+        sum = static_cast<uint32_t>(_mm_cvtsi128_si64(acc) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(acc, acc)));
+#endif
+        return sum;
+    }
+
+    // Bits of the bitset from bit `from` on (at least 57 of them): one unaligned load at the byte holding `from`.
+    static uint64_t bits_from(const uint64_t* bits, std::size_t from) noexcept {
+        uint64_t x;
+        std::memcpy(&x, reinterpret_cast<const unsigned char*>(bits) + from / 8, sizeof(x));
+        return x >> (from % 8);
+    }
+
+    // Tag bytes as a key: the 1-5 tag characters at p, zero-extended. p + 8 is inside the message: every field is
+    // followed by at least the CheckSum field.
+    static uint64_t tag_key(const char* p, std::size_t len) noexcept {
+        uint64_t x;
+        std::memcpy(&x, p, sizeof(x));
+        return x & (~uint64_t{0} >> (64 - 8 * len));
+    }
+
+    // Slot of a tag key, FixMessage::MAX_SLOTS if it was not requested: one multiply, one load, one compare.
+    std::size_t slot_of(uint64_t key) const noexcept {
+        const TagEntry& t = tags_[(key * mult_) >> (64 - TAG_BITS)];
+        return t.key == key ? t.slot : FixMessage::MAX_SLOTS;
+    }
+
+    template <class F>
+    std::size_t deliver(const char* p, std::size_t total, F& f) noexcept {
+        const std::size_t end = total - TRAILER;           // fields before the CheckSum
+        alignas(64) uint64_t soh[WORDS + 1], eq[WORDS + 1];
+        const uint32_t sum = classify(p, end, soh, eq);
+        const std::size_t words = (end + 63) / 64;
+        if (verify_) {
+            const char* t = p + end + 3;
+            const unsigned want = static_cast<unsigned>(t[0] - '0') * 100 + static_cast<unsigned>(t[1] - '0') * 10 +
+                                  static_cast<unsigned>(t[2] - '0');
+            if ((sum & 0xff) != want) [[unlikely]] {
+                ++stats_.bad_checksum;
+                return 0;
+            }
+        }
+        msg_.data = p;
+        msg_.size = total;
+        msg_.present = 0;
+        // Walk SOHs with blsr, so consecutive fields do not wait on each other; each field's '=' is the first one
+        // after its start, read from the '=' bitset at that bit offset. A tag is matched on its raw bytes.
+        std::size_t start = 0;
+        for (std::size_t w = 0; w < words; ++w) {
+            for (uint64_t m = soh[w]; m; m &= m - 1) {
+                const std::size_t s = w * 64 + static_cast<std::size_t>(std::countr_zero(m));
+                const std::size_t len = static_cast<std::size_t>(std::countr_zero(bits_from(eq, start)));
+                const std::size_t e = start + len;
+                if (len - 1 > 4 || e >= s) [[unlikely]] {
+                    ++stats_.malformed;
+                    return 0;
+                }
+                const std::size_t slot = slot_of(tag_key(p + start, len));
+                // Unwanted tags land in the scratch span past the last slot; no branch on whether the tag was asked for.
+                msg_.spans[slot] = FixSpan{static_cast<uint32_t>(e + 1), static_cast<uint32_t>(s - e - 1)};
+                msg_.present |= uint64_t{slot < FixMessage::MAX_SLOTS} << (slot & 63);
+                start = s + 1;
+            }
+        }
+        if (start != end) [[unlikely]] {
+            ++stats_.malformed;
+            return 0;
+        }
+        ++stats_.messages;
+        f(static_cast<const FixMessage&>(msg_));
+        return 1;
+    }
+
+    // Drop the start of [p, p + n) up to the next "8=FIX" at or after offset `from`. A prefix of "8=FIX" at the very
+    // end is kept: the next read may complete it.
+    static void skip_to_next(const char*& p, std::size_t& n, std::size_t from) noexcept {
+        std::size_t i = from;
+        for (; i < n; ++i) {
+            if (p[i] == '8' && std::memcmp(p + i, "8=FIX", std::min<std::size_t>(n - i, 5)) == 0) break;
+        }
+        p += i;
+        n -= i;
+    }
+
+    // The staged bytes do not start a valid message: drop them up to the next "8=FIX". What follows can hold whole
+    // messages (a bad BodyLength staged the ones behind it), so those are delivered from the stage and only the
+    // partial tail stays staged. `from` 0 delivers from the start without counting a malformed message.
+    template <class F>
+    std::size_t resync_stage(F& f, std::size_t from = 1) noexcept {
+        std::size_t msgs = 0;
+        const char* p = stage_.data();
+        std::size_t n = have_;
+        if (from) {
+            ++stats_.malformed;
+            skip_to_next(p, n, from);
+        }
+        while (n) {
+            const std::size_t total = frame(p, n);
+            if (total == NEED_MORE) break;
+            if (total == MALFORMED) {
+                ++stats_.malformed;
+                skip_to_next(p, n, 1);
+                continue;
+            }
+            ++stats_.staged;
+            msgs += deliver(p, total, f);
+            p += total;
+            n -= total;
+        }
+        std::memmove(stage_.data(), p, n);
+        have_ = n;
+        return msgs;
+    }
+
+    alignas(64) std::array<TagEntry, std::size_t{1} << TAG_BITS> tags_;
+    uint64_t mult_;
+    bool verify_;
+    FixParserStats stats_;
+    FixMessage msg_;
+    std::size_t have_ = 0;
+    alignas(64) std::array<char, MAX_MSG> stage_;
+};
+
+// ---------- byte-at-a-time baseline ----------
+// Slot per tag for tags below 1024, 0xff if not requested.
+using FixTagSlots = std::array<uint8_t, 1024>;
+
+inline FixTagSlots make_fix_tag_slots(std::initializer_list<int> tags) {
+    FixTagSlots slots;
+    slots.fill(0xff);
+    uint8_t slot = 0;
+    for (int t : tags) slots.at(static_cast<std::size_t>(t)) = slot++;
+    return slots;
+}
+
+// The parser FixParser replaces: one pass, one byte at a time, over a complete message. Same framing and output.
+// Returns false for anything FixParser would count as malformed or bad-checksum.
+inline bool fix_parse_bytewise(const char* p, std::size_t n, const FixTagSlots& slot_of, FixMessage& out) noexcept
+{
+    if (n < 5 || std::memcmp(p, "8=FIX", 5) != 0) return false;
+    out.data = p;
+    out.present = 0;
+    unsigned sum = 0;
+    std::size_t tag = 0, value_at = 0, body_len = 0, end = n;
+    bool in_tag = true;
+    for (std::size_t i = 0; i < end; ++i) {
+        const char c = p[i];
+        if (in_tag) {
+            if (c == '=') {
+                in_tag = false;
+                value_at = i + 1;
+            } else if (c >= '0' && c <= '9') {
+                tag = tag * 10 + static_cast<std::size_t>(c - '0');
+            } else {
+                return false;
+            }
+        } else if (c == fix_detail::SOH) {
+            if (tag == 9) {
+                body_len = fix_uint(std::string_view(p + value_at, i - value_at));
+                end = i + 1 + body_len;
+                if (end + 7 > n) return false;
+            } else if (tag == 10) {
+                return false;
+            }
+            if (tag < slot_of.size() && slot_of[tag] != 0xff) {
+                out.spans[slot_of[tag]] = FixSpan{static_cast<uint32_t>(value_at), static_cast<uint32_t>(i - value_at)};
+                out.present |= uint64_t{1} << slot_of[tag];
+            }
+            tag = 0;
+            in_tag = true;
+        }
+        sum += static_cast<unsigned char>(c);
+    }
+    if (!in_tag || std::memcmp(p + end, "10=", 3) != 0) return false;
+    out.size = end + 7;
+    return (sum & 0xff) == fix_uint(std::string_view(p + end + 3, 3));
+}
+
+// ---------- execution reports ----------
+// Slots of FixExecReportParser's messages.
+enum FixExecSlot : std::size_t { FixMsgType, FixClOrdID, FixExecType, FixLastQty, FixLastPx, FixLeavesQty, FixText };
+
+inline FixParser make_fix_exec_report_parser() {
+    return FixParser({35, 11, 150, 32, 31, 151, 58});
+}
+
+// ExecutionReport (35=8) from a FixExecReportParser message as the tracker's ExecReport. ClOrdID is our order id;
+// ExecType New/Replaced -> Ack (an ack on the new id completes a replace), PartialFill/Fill/Trade -> Fill.
+// False for other message and exec types.
+inline bool to_exec_report(const FixMessage& m, ExecReport& out) noexcept {
+    if (m.get(FixMsgType) != "8") return false;
+    switch (m.chr(FixExecType)) {
+    case '0': case '5': out.type = ExecReport::Ack; break;
+    case '1': case '2': case 'F': out.type = ExecReport::Fill; break;
+    case '4': out.type = ExecReport::Cancelled; break;
+    case '8': out.type = ExecReport::Rejected; break;
+    default: return false;
+    }
+    out.order_id = fix_uint(m.get(FixClOrdID));
+    out.last_qty = static_cast<uint32_t>(fix_uint(m.get(FixLastQty)));
+    out.last_px = fix_price(m.get(FixLastPx));
+    out.leaves_qty = static_cast<uint32_t>(fix_uint(m.get(FixLeavesQty)));
+    return true;
+}
+
+namespace fix_detail {
+
+// An ExecutionReport as a venue would send it, with a Text field containing '=' to exercise the field walk.
+inline std::string exec_report_text(uint32_t seq, uint64_t cl_ord_id, char exec_type, uint32_t last_qty, double last_px,
+                                    uint32_t leaves, std::string_view text)
+{
+    char body[512];
+    const int n = std::snprintf(body, sizeof(body),
+        "35=8\x01" "49=XCHG\x01" "56=HFTL\x01" "34=%u\x01" "52=20240102-03:04:05.678\x01" "37=E%llu\x01"
+        "11=%llu\x01" "17=X%u\x01" "150=%c\x01" "39=%c\x01" "55=1001\x01" "54=1\x01" "32=%u\x01" "31=%.4f\x01"
+        "151=%u\x01" "14=0\x01" "6=0\x01" "58=%.*s\x01",
+        seq, static_cast<unsigned long long>(cl_ord_id), static_cast<unsigned long long>(cl_ord_id), seq, exec_type,
+        exec_type, last_qty, last_px, leaves, static_cast<int>(text.size()), text.data());
+    std::string msg = std::string("8=FIX.4.4\x01" "9=") + std::to_string(n) + '\x01' + std::string(body, static_cast<std::size_t>(n));
+    unsigned sum = 0;
+    for (unsigned char c : msg) sum += c;
+    char trailer[8];
+    std::snprintf(trailer, sizeof(trailer), "10=%03u\x01", sum & 0xff);
+    return msg + trailer;
+}
+
+} // namespace fix_detail
+
+// A stream of reports cut at every possible point and at random points, plus garbage and a bad checksum in between;
+// every report is compared with the byte-at-a-time parser.
+std::string FIX_PARSER_Test()
+{
+    std::stringstream ss;
+    std::string stream;
+    std::vector<std::string> msgs;
+    const char types[] = {'0', '1', '2', 'F', '4', '8', '5'};
+    for (uint32_t i = 0; i < 7; ++i) {
+        msgs.push_back(fix_detail::exec_report_text(i + 1, 100 + i, types[i], 10 * i, 101.25 + i, 50 - i,
+                                                    i % 2 ? "limit=ok; note=x" : ""));
+    }
+    std::string bad = msgs[0];
+    bad[bad.size() - 2] = bad[bad.size() - 2] == '0' ? '1' : '0';          // CheckSum off by one
+    stream = msgs[0] + msgs[1] + "garbage" + msgs[2] + msgs[3] + bad + msgs[4] + msgs[5] + msgs[6];
+
+    std::string seen;
+    auto log = [&](const FixMessage& m) {
+        ExecReport r{};
+        if (to_exec_report(m, r)) {
+            seen += std::string(1, r.type) + std::to_string(r.order_id) + "/" + std::to_string(r.last_qty) + "@" +
+                    std::to_string(r.last_px.raw / 1'000'000) + " ";
+        }
+    };
+    {
+        FixParser p = make_fix_exec_report_parser();
+        p.feed(stream.data(), stream.size(), log);
+        ss << seen << "| ";
+    }
+
+    // Every two-way split, then random many-way splits: same reports, same text field.
+    bool splits = true;
+    for (std::size_t cut = 0; cut <= stream.size(); ++cut) {
+        FixParser p = make_fix_exec_report_parser();
+        std::string got;
+        auto take = [&](const FixMessage& m) { got += std::string(m.get(FixClOrdID)) + ":" + std::string(m.get(FixText)) + ";"; };
+        p.feed(stream.data(), cut, take);
+        p.feed(stream.data() + cut, stream.size() - cut, take);
+        splits &= p.stats().messages == 7 && p.stats().bad_checksum == 1 && p.pending() == 0 &&
+                  got == "100:;101:limit=ok; note=x;102:;103:limit=ok; note=x;104:;105:limit=ok; note=x;106:;";
+    }
+    std::mt19937 rng(3);
+    for (int round = 0; round < 200; ++round) {
+        FixParser p = make_fix_exec_report_parser();
+        std::size_t at = 0, n = 0;
+        while (at < stream.size()) {
+            const std::size_t len = std::min<std::size_t>(stream.size() - at, rng() % 40);
+            p.feed(stream.data() + at, len, [&](const FixMessage&) { ++n; });
+            at += len;
+        }
+        splits &= n == 7;
+    }
+
+    // Field-for-field against the byte-at-a-time parser.
+    bool same = true;
+    {
+        FixParser p = make_fix_exec_report_parser();
+        const FixTagSlots slot_of = make_fix_tag_slots({35, 11, 150, 32, 31, 151, 58});
+        for (const auto& m : msgs) {
+            FixMessage ref;
+            same &= fix_parse_bytewise(m.data(), m.size(), slot_of, ref);
+            p.feed(m.data(), m.size(), [&](const FixMessage& got) {
+                same &= got.present == ref.present && got.size == ref.size;
+                for (std::size_t s = 0; s < 7; ++s) same &= got.get(s) == ref.get(s);
+            });
+        }
+        FixMessage ref;
+        same &= !fix_parse_bytewise(bad.data(), bad.size(), slot_of, ref);
+    }
+
+    // A header with a bad BodyLength stages the messages behind it; once it is found out they come out of the stage.
+    std::string resync;
+    {
+        FixParser r = make_fix_exec_report_parser();
+        const std::string first = std::string("8=FIX.4.4\x01" "9=1000\x01" "35=8\x01") + msgs[0] + msgs[1].substr(0, 10);
+        const std::string second = msgs[1].substr(10) + std::string(1200, 'x');
+        auto take = [&](const FixMessage& m) { resync += std::string(m.get(FixClOrdID)) + ","; };
+        r.feed(first.data(), first.size(), take);
+        r.feed(second.data(), second.size(), take);
+        resync += std::to_string(r.stats().malformed) + "/" + std::to_string(r.pending());
+    }
+
+    FixParser p = make_fix_exec_report_parser();
+    p.feed(stream.data(), stream.size(), [](const FixMessage&) {});
+    const auto& st = p.stats();
+    ss << "splits=" << splits << " bytewise=" << same << " messages=" << st.messages << " bad-checksum="
+       << st.bad_checksum << " malformed=" << st.malformed << " resync=" << resync;
+    return ss.str();
+}
+
+// Messages/sec over a buffer of back-to-back reports: FixParser (in place) against the byte-at-a-time parser.
+void FIX_PARSER_BENCH()
+{
+    constexpr int MSGS = 1024, ROUNDS = 1000;
+    std::string stream;
+    std::vector<std::size_t> sizes;
+    for (uint32_t i = 0; i < MSGS; ++i) {
+        const std::string m = fix_detail::exec_report_text(i + 1, 1000000 + i, i % 3 ? 'F' : '0', i % 100, 100.0 + i % 50,
+                                                           1000 - i % 100, "");
+        stream += m;
+        sizes.push_back(m.size());
+    }
+    FixParser p = make_fix_exec_report_parser();
+    uint64_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        p.feed(stream.data(), stream.size(), [&](const FixMessage& m) { sink += m.spans[FixClOrdID].off; });
+    }
+    const double simd = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const FixTagSlots slot_of = make_fix_tag_slots({35, 11, 150, 32, 31, 151, 58});
+    FixMessage m;
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        const char* q = stream.data();
+        for (std::size_t n : sizes) {
+            if (fix_parse_bytewise(q, n, slot_of, m)) sink += m.spans[FixClOrdID].off;
+            q += n;
+        }
+    }
+    const double bytewise = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const double total = static_cast<double>(MSGS) * ROUNDS;
+    std::cout << "FIX_PARSER_BENCH " << stream.size() / MSGS << "-byte reports, "
+#if defined(__AVX2__)
+              << "AVX2"
+#else
+              << "SSE2"
+#endif
+              << ": " << total / simd / 1e6 << " M msgs/s (" << simd * 1e9 / total << " ns), byte-at-a-time: "
+              << total / bytewise / 1e6 << " M msgs/s (" << bytewise * 1e9 / total << " ns) (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,312 @@
+/*
+        Design notes
+
+        Fixed-point prices
+
+        Prices used to be doubles. That meant float compares in the books, a rounding step whenever a price went
+        into an integer wire field, and nothing integer SIMD could work on. Price is an integer count of 1e-8,
+        the finest scale any wire here uses (FIX prints 8 decimals), so every tick size and every wire scale is
+        an exact multiple of it.
+
+        - Price is a packed int64 with constexpr arithmetic and comparisons (+, -, * by an integer, <=>). It is
+          packed so it can sit at any offset of a packed wire struct (Order has it at byte 12); on x86 that
+          costs nothing. 101.25_px is an exact literal.
+        - PriceSpec is per instrument: the tick size, and the wire scale (decimals of the integer the venue's
+          binary protocol carries, 4 for OUCH). Converting a price to ticks is an exact division by the tick
+          with no divide instruction: multiply by the tick's odd part's inverse mod 2^64, then rotate right by
+          its power of two. The same result says whether the price is on the tick grid (Granlund-Montgomery).
+          Wire conversion is one multiply or divide by a power of ten.
+        - PriceSpecs maps instrument ids to specs, with a default for the ones not configured. It is cold path
+          only: a book copies its instrument's spec when the book is created.
+        - ASCII: parse_price reads "[-]digits[.digits]" (up to 8 decimals, no exponent, no locale) straight
+          into the integer; format_price writes the shortest exact decimal. Both are digit loops, with no
+          strtod or printf.
+        - doubles remain only at the edges. from_double is for configuration and for TickerData, whose layout
+          is fixed as a double by the recorded feed captures, so decoders convert it once at decode. to_double
+          is for display and ratios.
+*/
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct Price {
+    static constexpr int DECIMALS = 8;
+    static constexpr int64_t SCALE = 100'000'000;
+
+    int64_t raw;            // units of 10^-DECIMALS
+
+    using log_by_value = void;      // HFT_LOG copies the 8 bytes; formatting happens on the logger thread
+
+    static constexpr Price from_raw(int64_t r) noexcept { return Price{r}; }
+    // Nearest multiple of 10^-DECIMALS. False, and p untouched, for NaN, infinities and anything outside int64 raw.
+    static constexpr bool from_double(double d, Price& p) noexcept {
+        const double x = d * static_cast<double>(SCALE);
+        const double r = x < 0 ? x - 0.5 : x + 0.5;
+        if (!(r > -0x1p63 && r < 0x1p63)) [[unlikely]] return false;
+        p = Price{static_cast<int64_t>(r)};
+        return true;
+    }
+    static constexpr Price max() noexcept { return Price{std::numeric_limits<int64_t>::max()}; }
+    constexpr double to_double() const noexcept { return static_cast<double>(raw) / SCALE; }
+
+    friend constexpr bool operator==(Price a, Price b) noexcept { return a.raw == b.raw; }
+    friend constexpr std::strong_ordering operator<=>(Price a, Price b) noexcept { return a.raw <=> b.raw; }
+    friend constexpr Price operator+(Price a, Price b) noexcept { return Price{a.raw + b.raw}; }
+    friend constexpr Price operator-(Price a, Price b) noexcept { return Price{a.raw - b.raw}; }
+    friend constexpr Price operator-(Price a) noexcept { return Price{-a.raw}; }
+    friend constexpr Price operator*(Price a, int64_t n) noexcept { return Price{a.raw * n}; }
+    friend constexpr Price operator*(int64_t n, Price a) noexcept { return Price{a.raw * n}; }
+    constexpr Price& operator+=(Price b) noexcept { raw += b.raw; return *this; }
+    constexpr Price& operator-=(Price b) noexcept { raw -= b.raw; return *this; }
+} __attribute__((__packed__));
+static_assert(sizeof(Price) == 8);
+
+// 101.25_px, 100_px: exact for up to 8 decimals.
+consteval Price operator""_px(long double d) { return Price{static_cast<int64_t>(d * Price::SCALE + 0.5L)}; }
+consteval Price operator""_px(unsigned long long n) { return Price{static_cast<int64_t>(n) * Price::SCALE}; }
+
+namespace price_detail {
+
+inline constexpr std::array<int64_t, 9> POW10 = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+} // namespace price_detail
+
+// ---------- per-instrument spec ----------
+class PriceSpec {
+public:
+    // Implicit: a tick size alone is a spec. Default: 0.01 tick, prices in 1/10000 on the wire.
+    constexpr PriceSpec(Price tick = Price{1'000'000}, uint8_t wire_decimals = 4)
+    : tick_(tick), wire_decimals_(wire_decimals)
+    {
+        if (tick.raw <= 0 || wire_decimals > Price::DECIMALS) throw std::invalid_argument("PriceSpec: bad tick/wire_decimals");
+        const auto d = static_cast<uint64_t>(tick.raw);
+        shift_ = std::countr_zero(d);
+        const uint64_t odd = d >> shift_;
+        uint64_t inv = odd;                         // right to 3 bits; each Newton step doubles that
+        for (int i = 0; i < 5; ++i) inv *= 2 - odd * inv;
+        inv_ = inv;
+        limit_ = std::numeric_limits<uint64_t>::max() / d;
+        wire_unit_ = price_detail::POW10[Price::DECIMALS - wire_decimals];
+    }
+
+    constexpr Price tick() const noexcept { return tick_; }
+    constexpr uint8_t wire_decimals() const noexcept { return wire_decimals_; }
+
+    // Exact tick count of p. False for a negative price or one off the tick grid.
+    constexpr bool to_ticks(Price p, int64_t& ticks) const noexcept {
+        const uint64_t q = std::rotr(static_cast<uint64_t>(p.raw) * inv_, shift_);
+        ticks = static_cast<int64_t>(q);
+        return q <= limit_ && p.raw >= 0;
+    }
+    constexpr Price from_ticks(int64_t ticks) const noexcept { return Price{ticks * tick_.raw}; }
+    constexpr bool on_tick(Price p) const noexcept {
+        int64_t t = 0;
+        return to_ticks(p, t);
+    }
+
+    // The integer the venue's binary protocol carries: p in units of 10^-wire_decimals, truncated below that.
+    constexpr int64_t to_wire(Price p) const noexcept { return p.raw / wire_unit_; }
+    // Exact form for encoders: false, and w untouched, if p is finer than the wire can carry.
+    constexpr bool to_wire(Price p, int64_t& w) const noexcept {
+        if (p.raw % wire_unit_) [[unlikely]] return false;
+        w = p.raw / wire_unit_;
+        return true;
+    }
+    constexpr Price from_wire(int64_t w) const noexcept { return Price{w * wire_unit_}; }
+
+private:
+    Price tick_;
+    uint8_t wire_decimals_;
+    int shift_ = 0;
+    uint64_t inv_ = 0;
+    uint64_t limit_ = 0;
+    int64_t wire_unit_ = 1;
+};
+
+// Instrument id -> PriceSpec; instruments never set() get the default.
+class PriceSpecs {
+public:
+    // Implicit: one spec is a table where every instrument gets it.
+    PriceSpecs(PriceSpec def = {}) : def_(def) {}
+
+    void set(uint32_t instr_id, PriceSpec spec) { by_instr_.insert_or_assign(instr_id, spec); }
+
+    const PriceSpec& operator[](uint32_t instr_id) const noexcept {
+        const auto it = by_instr_.find(instr_id);
+        return it == by_instr_.end() ? def_ : it->second;
+    }
+
+private:
+    PriceSpec def_;
+    std::unordered_map<uint32_t, PriceSpec> by_instr_;
+};
+
+// ---------- ASCII ----------
+// "[-]digits[.digits]" with at most 8 decimals and a whole part below 9.2e10. False, and p untouched, otherwise.
+constexpr bool parse_price(std::string_view s, Price& p) noexcept {
+    const bool neg = !s.empty() && s[0] == '-';
+    std::size_t i = neg;
+    int64_t whole = 0;
+    std::size_t digits = 0;
+    for (; i < s.size() && s[i] != '.'; ++i, ++digits) {
+        const char c = s[i];
+        if (c < '0' || c > '9' || whole > (std::numeric_limits<int64_t>::max() / Price::SCALE) / 10) [[unlikely]] return false;
+        whole = whole * 10 + (c - '0');
+    }
+    int64_t frac = 0;
+    int decimals = 0;
+    if (i < s.size()) {
+        for (++i; i < s.size(); ++i, ++decimals, ++digits) {
+            const char c = s[i];
+            if (c < '0' || c > '9' || decimals == Price::DECIMALS) [[unlikely]] return false;
+            frac = frac * 10 + (c - '0');
+        }
+    }
+    if (!digits || whole > std::numeric_limits<int64_t>::max() / Price::SCALE - 1) [[unlikely]] return false;
+    const int64_t raw = whole * Price::SCALE + frac * price_detail::POW10[Price::DECIMALS - decimals];
+    p = Price{neg ? -raw : raw};
+    return true;
+}
+
+inline constexpr std::size_t PRICE_CHARS = 21;     // "-92233720368.54775808"
+
+// Shortest exact decimal ("101.25", "-0.5", "100") into out[0, PRICE_CHARS). Returns the length.
+inline std::size_t format_price(char* out, Price p) noexcept {
+    char* o = out;
+    uint64_t u = static_cast<uint64_t>(p.raw);
+    if (p.raw < 0) {
+        *o++ = '-';
+        u = 0 - u;
+    }
+    uint64_t whole = u / Price::SCALE;
+    uint64_t frac = u % Price::SCALE;
+    char rev[20];
+    int n = 0;
+    do {
+        rev[n++] = static_cast<char>('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+    while (n) *o++ = rev[--n];
+    if (frac) {
+        *o++ = '.';
+        int decimals = Price::DECIMALS;
+        for (; frac % 10 == 0; frac /= 10) --decimals;
+        for (int k = decimals - 1; k >= 0; --k, frac /= 10) o[k] = static_cast<char>('0' + frac % 10);
+        o += decimals;
+    }
+    return static_cast<std::size_t>(o - out);
+}
+
+inline std::ostream& operator<<(std::ostream& os, Price p) {
+    char b[PRICE_CHARS];
+    return os.write(b, static_cast<std::streamsize>(format_price(b, p)));
+}
+
+template <>
+struct std::formatter<Price> : std::formatter<std::string_view> {
+    auto format(Price p, std::format_context& ctx) const {
+        char b[PRICE_CHARS];
+        return std::formatter<std::string_view>::format(std::string_view(b, format_price(b, p)), ctx);
+    }
+};
+
+// Arithmetic and compares at compile time; ticks exact on and off the grid, including ticks that are not a
+// power of ten; wire and ASCII round trips; bad input refused.
+std::string PRICE_Test()
+{
+    static_assert(101.25_px + 0.75_px == 102_px && 102_px - 0.01_px < 102_px && 0.05_px * 3 == 0.15_px);
+    static_assert(PriceSpec(0.01_px).on_tick(101.25_px) && !PriceSpec(0.01_px).on_tick(101.255_px));
+    static_assert([] { Price p{}; return Price::from_double(0.1 + 0.2, p) && p == 0.3_px; }());
+
+    std::stringstream ss;
+    const PriceSpec cents;
+    int64_t t = 0;
+    ss << "ticks=" << cents.to_ticks(101.25_px, t) << "/" << t << " off-tick=" << !cents.to_ticks(101.255_px, t)
+       << " negative=" << !cents.to_ticks(-1_px, t);
+    const PriceSpec quarter(0.25_px, 2);     // odd tick sizes: 25000000 = 2^6 * 390625
+    ss << " quarter=" << quarter.to_ticks(100.75_px, t) << "/" << t << "," << quarter.on_tick(100.5_px) << quarter.on_tick(100.3_px);
+    const PriceSpec sevens(Price::from_raw(7), 8);
+    bool exact = true;
+    for (int64_t r = 0; r < 100000; ++r) exact &= sevens.to_ticks(Price::from_raw(r), t) == (r % 7 == 0) && (r % 7 || t == r / 7);
+    ss << " exact=" << exact;
+    ss << " wire=" << cents.to_wire(101.25_px) << "/" << cents.from_wire(1012500);
+
+    PriceSpecs specs(cents);
+    specs.set(7, quarter);
+    ss << " specs=" << specs[7].tick() << "/" << specs[8].tick();
+
+    Price p{};
+    ss << " parse=" << parse_price("101.25", p) << "/" << p << "," << parse_price("-0.5", p) << "/" << p << "," << parse_price("7", p)
+       << "/" << p << "," << parse_price("0.00000001", p) << "/" << p.raw;
+    ss << " refused=" << !parse_price("", p) << !parse_price("-", p) << !parse_price("1.123456789", p) << !parse_price("1e5", p)
+       << !parse_price("99999999999", p) << !parse_price("1.2.3", p);
+    ss << " fmt=" << std::format("{}|{}|{}", 100_px, 0.1_px, -20.8_px);
+    p = 1_px;
+    ss << " double-refused=" << !Price::from_double(std::numeric_limits<double>::quiet_NaN(), p)
+       << !Price::from_double(std::numeric_limits<double>::infinity(), p) << !Price::from_double(1e11, p)
+       << !Price::from_double(-1e11, p) << "/" << p;
+
+    std::mt19937_64 rng(1);
+    bool round_trip = true;
+    for (int i = 0; i < 100000; ++i) {
+        const Price x = Price::from_raw(static_cast<int64_t>(rng() % 200'000'000'000'000ull) - 100'000'000'000'000);
+        char b[PRICE_CHARS];
+        Price y{}, z{};
+        round_trip &= parse_price(std::string_view(b, format_price(b, x)), y) && y == x &&
+                      Price::from_double(std::strtod(std::string(b, format_price(b, x)).c_str(), nullptr), z) && z == x;
+    }
+    ss << " round-trip=" << round_trip;
+    return ss.str();
+}
+
+// ns per conversion: ASCII parse/format vs strtod/snprintf, and price -> tick index vs the double path the books
+// used (scale, nearbyint, grid check).
+void PRICE_BENCH()
+{
+    constexpr int N = 1 << 22;
+    std::mt19937_64 rng(42);
+    std::vector<Price> prices(N);
+    for (auto& p : prices) p = Price::from_raw(static_cast<int64_t>(1 + rng() % 100000) * 1'000'000);
+    std::vector<std::string> text(N);
+    for (int i = 0; i < N; ++i) text[i] = std::format("{}", prices[i]);
+    std::vector<double> doubles(N);
+    for (int i = 0; i < N; ++i) doubles[i] = prices[i].to_double();
+    uint64_t sink = 0;
+    auto time = [&](auto&& body) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) body(i);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+    };
+    const double parse = time([&](int i) { Price p{}; parse_price(text[i], p); sink += static_cast<uint64_t>(p.raw); });
+    const double strtod = time([&](int i) { sink += static_cast<uint64_t>(std::strtod(text[i].c_str(), nullptr)); });
+    char b[64];
+    const double fmt = time([&](int i) { sink += format_price(b, prices[i]); });
+    const double snp = time([&](int i) { sink += static_cast<uint64_t>(std::snprintf(b, sizeof(b), "%.8g", doubles[i])); });
+    const PriceSpec cents;
+    const double tick = time([&](int i) { int64_t t; sink += cents.to_ticks(prices[i], t) + static_cast<uint64_t>(t); });
+    const double dbl = time([&](int i) {
+        const double x = doubles[i] * 100;
+        const double r = std::nearbyint(x);
+        sink += (std::fabs(x - r) <= 1e-6) + static_cast<uint64_t>(r);
+    });
+    std::cout << "PRICE_BENCH parse " << parse << " ns vs strtod " << strtod << " ns, format " << fmt << " ns vs snprintf " << snp
+              << " ns, to_ticks " << tick << " ns vs double " << dbl << " ns (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,365 @@
+/*
+        Design notes
+
+        Why
+
+        The binary links tcmalloc, which is a fine general allocator, but a stray `new` on a hot thread can still hit
+        a central-cache refill, a page-heap lock or an mmap. We want to *prove* the hot loop is allocation-free, and
+        survive the odd allocation we missed without a syscall.
+
+        How
+
+        A thread opts in with HotAlloc::register_hot_thread(node). That builds one NumaArena on the thread's node,
+        split into equal sub-ranges, one FixedPool per size class (64B .. 4KB). While the thread is registered, global
+        operator new/delete on that thread are served from those pools: a TLS pointer load, a bit_width() and a pool
+        pop - no locks, no syscalls.
+
+        Anything the pools cannot serve (bigger than 4KB, over-aligned, or the class is exhausted) falls back to the
+        system allocator and is counted per thread. With FallbackAction::Trap the fallback raises SIGTRAP instead, so a
+        test run or a canary deploy stops exactly at the offending call site.
+
+        Threads that never register pay one relaxed load and a range compare in operator delete (to spot a block that
+        a hot thread handed over) and otherwise go straight to malloc/free.
+
+        Frees from another thread are fine: FixedPool::deallocate is the CAS push, so the block goes back to its
+        owner's pool. Heaps are never torn down - a block may outlive its thread - so unregistering only stops routing.
+
+        Opt in at build time with -DHFT_HOT_ALLOC_INTERPOSE (CMake option of the same name); without it this header only
+        provides the direct HotAlloc::allocate/deallocate API. Include it from exactly one translation unit, since it
+        defines the replacement operators.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "custom-allocator.h"
+
+namespace HotAlloc
+{
+    constexpr std::size_t MIN_CLASS_SHIFT = 6;                    // 64B
+    constexpr std::size_t MAX_CLASS_SHIFT = 12;                   // 4KB
+    constexpr std::size_t NUM_CLASSES = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+    constexpr std::size_t MAX_HOT_THREADS = 64;
+    constexpr std::size_t DEFAULT_BYTES_PER_CLASS = 4ULL * 1024 * 1024;
+
+    enum class FallbackAction { Count, Trap };
+
+    template <std::size_t N>
+    struct Block { alignas(16) std::byte bytes[N]; };
+
+    // Smallest class index that fits `n` bytes; NUM_CLASSES if none does.
+    constexpr std::size_t class_of(std::size_t n) noexcept {
+        const std::size_t shift = n <= (1u << MIN_CLASS_SHIFT) ? MIN_CLASS_SHIFT : std::bit_width(n - 1);
+        return shift > MAX_CLASS_SHIFT ? NUM_CLASSES : shift - MIN_CLASS_SHIFT;
+    }
+
+    struct Stats {
+        uint64_t served{0};          // allocations satisfied from the pools
+        uint64_t fallbacks{0};       // allocations that went to the system allocator
+        uint64_t fallback_bytes{0};
+    };
+
+    // One per registered thread; lives in static storage for the life of the process.
+    class CACHE_ALIGNED ThreadHeap {
+    public:
+        ThreadHeap(int node, std::size_t bytes_per_class)
+        : region_bytes_(bytes_per_class),
+          arena_(bytes_per_class * NUM_CLASSES, node, /*prefer_thp=*/true)
+        {
+            auto* base = static_cast<std::byte*>(arena_.base());
+            build_pools(base, std::make_index_sequence<NUM_CLASSES>{});
+            lo_ = reinterpret_cast<std::uintptr_t>(base);
+            hi_ = lo_ + region_bytes_ * NUM_CLASSES;
+        }
+
+        void* allocate(std::size_t cls) noexcept { return alloc_fns_[cls](pools_[cls]); }
+        void deallocate(void* p) noexcept {
+            const std::size_t cls = (reinterpret_cast<std::uintptr_t>(p) - lo_) / region_bytes_;
+            free_fns_[cls](pools_[cls], p);
+        }
+        bool owns(const void* p) const noexcept {
+            const auto a = reinterpret_cast<std::uintptr_t>(p);
+            return a >= lo_ && a < hi_;
+        }
+        int node() const noexcept { return arena_.node(); }
+        std::uintptr_t lo() const noexcept { return lo_; }
+        std::uintptr_t hi() const noexcept { return hi_; }
+
+        // Written only by the owning thread; monitors read them relaxed.
+        std::atomic<uint64_t> served{0};
+        std::atomic<uint64_t> fallbacks{0};
+        std::atomic<uint64_t> fallback_bytes{0};
+
+    private:
+        // Type-erased so the per-class FixedPools can sit in one array and be picked by index on the hot path.
+        using AllocFn = void* (*)(void*) noexcept;
+        using FreeFn = void (*)(void*, void*) noexcept;
+
+        template <std::size_t... I>
+        void build_pools(std::byte* base, std::index_sequence<I...>) {
+            (build_pool<I>(base + I * region_bytes_), ...);
+        }
+        template <std::size_t I>
+        void build_pool(std::byte* region) {
+            using B = Block<(std::size_t{1} << (MIN_CLASS_SHIFT + I))>;
+            using Pool = FixedPool<B, PoolNoGuard>;
+            const std::size_t cap = region_bytes_ / Pool::slot_bytes();
+            static_assert(sizeof(Pool) <= sizeof(PoolStorage));
+            pools_[I] = new (&pool_storage_[I]) Pool(region, region_bytes_, cap);
+            alloc_fns_[I] = [](void* pool) noexcept -> void* { return static_cast<Pool*>(pool)->allocate(); };
+            free_fns_[I] = [](void* pool, void* p) noexcept { static_cast<Pool*>(pool)->deallocate(static_cast<B*>(p)); };
+        }
+
+        struct alignas(CACHELINE_SIZE) PoolStorage { std::byte b[4 * CACHELINE_SIZE]; };
+
+        std::size_t region_bytes_;
+        std::uintptr_t lo_{0}, hi_{0};
+        NumaArena arena_;
+        std::array<void*, NUM_CLASSES> pools_{};
+        std::array<AllocFn, NUM_CLASSES> alloc_fns_{};
+        std::array<FreeFn, NUM_CLASSES> free_fns_{};
+        std::array<PoolStorage, NUM_CLASSES> pool_storage_{};
+    };
+
+    namespace detail
+    {
+        // Heaps are placed here once and never destroyed (blocks may outlive their thread).
+        alignas(ThreadHeap) inline std::byte heap_storage[MAX_HOT_THREADS][sizeof(ThreadHeap)];
+        // Slots handed out so far (fetch_add reserves one per registering thread); a slot is only read once its
+        // heap_ready flag is set, since its heap may still be under construction.
+        inline std::atomic<std::size_t> heap_count{0};
+        inline std::atomic<bool> heap_ready[MAX_HOT_THREADS]{};
+        // Address window covering every heap: a cheap reject for frees of ordinary malloc memory.
+        inline std::atomic<std::uintptr_t> window_lo{UINTPTR_MAX};
+        inline std::atomic<std::uintptr_t> window_hi{0};
+        inline std::atomic<FallbackAction> fallback_action{FallbackAction::Count};
+
+        inline thread_local ThreadHeap* t_heap = nullptr;     // this thread's heap, kept after unregister
+        inline thread_local bool t_hot = false;                // currently routing new/delete to t_heap
+
+        inline ThreadHeap* heap_at(std::size_t i) noexcept {
+            return std::launder(reinterpret_cast<ThreadHeap*>(heap_storage[i]));
+        }
+
+        // Heap in slot i, or nullptr while it is still being built.
+        inline ThreadHeap* ready_heap(std::size_t i) noexcept {
+            return heap_ready[i].load(std::memory_order_acquire) ? heap_at(i) : nullptr;
+        }
+
+        inline std::size_t reserved_slots() noexcept {
+            return std::min(heap_count.load(std::memory_order_acquire), MAX_HOT_THREADS);
+        }
+
+        inline ThreadHeap* owner_of(const void* p) noexcept {
+            const auto a = reinterpret_cast<std::uintptr_t>(p);
+            if (a < window_lo.load(std::memory_order_relaxed) || a >= window_hi.load(std::memory_order_relaxed))
+                return nullptr;
+            if (t_heap && t_heap->owns(p)) return t_heap;
+            const std::size_t n = reserved_slots();
+            for (std::size_t i = 0; i < n; ++i) {
+                ThreadHeap* h = ready_heap(i);
+                if (h && h->owns(p)) return h;
+            }
+            return nullptr;
+        }
+
+        inline void* fallback(ThreadHeap* h, std::size_t n, std::size_t align) noexcept {
+            h->fallbacks.store(h->fallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            h->fallback_bytes.store(h->fallback_bytes.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            if (fallback_action.load(std::memory_order_relaxed) == FallbackAction::Trap) std::raise(SIGTRAP);
+            if (align > alignof(std::max_align_t)) return std::aligned_alloc(align, (n + align - 1) & ~(align - 1));
+            return std::malloc(n);
+        }
+    }
+
+    // Route this thread's new/delete to pools on `numa_node`. Not hot-path: builds and prefaults the arena.
+    // Re-registering a thread that already has a heap just turns routing back on.
+    inline void register_hot_thread(int numa_node, std::size_t bytes_per_class = DEFAULT_BYTES_PER_CLASS)
+    {
+        using namespace detail;
+        if (!t_heap) {
+            // Reserve the slot first: threads registering at once each get their own.
+            const std::size_t i = heap_count.fetch_add(1, std::memory_order_relaxed);
+            if (i >= MAX_HOT_THREADS) throw std::runtime_error("HotAlloc: too many hot threads");
+            ThreadHeap* h = new (heap_storage[i]) ThreadHeap(numa_node, bytes_per_class);
+            // widen the window before publishing the heap so owner_of() never misses it
+            std::uintptr_t lo = window_lo.load(), hi = window_hi.load();
+            while (!window_lo.compare_exchange_weak(lo, std::min(lo, h->lo()))) {}
+            while (!window_hi.compare_exchange_weak(hi, std::max(hi, h->hi()))) {}
+            heap_ready[i].store(true, std::memory_order_release);
+            t_heap = h;
+        }
+        t_hot = true;
+    }
+
+    // Stop routing; blocks already handed out stay valid and are still returned to their pool on delete.
+    inline void unregister_hot_thread() noexcept { detail::t_hot = false; }
+
+    inline bool is_hot_thread() noexcept { return detail::t_hot; }
+
+    inline void set_fallback_action(FallbackAction a) noexcept {
+        detail::fallback_action.store(a, std::memory_order_relaxed);
+    }
+
+    // Counters of the calling thread (zeros if it never registered).
+    inline Stats thread_stats() noexcept {
+        Stats s;
+        if (auto* h = detail::t_heap) {
+            s.served = h->served.load(std::memory_order_relaxed);
+            s.fallbacks = h->fallbacks.load(std::memory_order_relaxed);
+            s.fallback_bytes = h->fallback_bytes.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    // Sum over every hot thread; safe to call from a monitor thread.
+    inline Stats process_stats() noexcept {
+        Stats s;
+        const std::size_t n = detail::reserved_slots();
+        for (std::size_t i = 0; i < n; ++i) {
+            auto* h = detail::ready_heap(i);
+            if (!h) continue;
+            s.served += h->served.load(std::memory_order_relaxed);
+            s.fallbacks += h->fallbacks.load(std::memory_order_relaxed);
+            s.fallback_bytes += h->fallback_bytes.load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    // The routing decision, shared by every operator new flavour. nullptr means out of memory.
+    inline void* allocate(std::size_t n, std::size_t align = alignof(std::max_align_t)) noexcept
+    {
+        using namespace detail;
+        ThreadHeap* h = t_heap;
+        if (t_hot) [[likely]] {
+            const std::size_t cls = class_of(n ? n : 1);
+            if (cls < NUM_CLASSES && align <= CACHELINE_SIZE) [[likely]] {
+                if (void* p = h->allocate(cls)) [[likely]] {
+                    h->served.store(h->served.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return p;
+                }
+            }
+            return fallback(h, n, align);
+        }
+        if (align > alignof(std::max_align_t)) return std::aligned_alloc(align, (n + align - 1) & ~(align - 1));
+        return std::malloc(n ? n : 1);
+    }
+
+    inline void deallocate(void* p) noexcept
+    {
+        if (!p) return;
+        if (ThreadHeap* h = detail::owner_of(p)) {
+            h->deallocate(p);
+            return;
+        }
+        std::free(p);
+    }
+}
+
+#ifdef HFT_HOT_ALLOC_INTERPOSE
+// ---------- global replacement operators ----------
+// Replacement functions may not be inline; this header must be included by one TU only.
+void* operator new(std::size_t n) {
+    if (void* p = HotAlloc::allocate(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) {
+    if (void* p = HotAlloc::allocate(n)) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept { return HotAlloc::allocate(n); }
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept { return HotAlloc::allocate(n); }
+void* operator new(std::size_t n, std::align_val_t a) {
+    if (void* p = HotAlloc::allocate(n, static_cast<std::size_t>(a))) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t a) {
+    if (void* p = HotAlloc::allocate(n, static_cast<std::size_t>(a))) return p;
+    throw std::bad_alloc();
+}
+void* operator new(std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return HotAlloc::allocate(n, static_cast<std::size_t>(a));
+}
+void* operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t&) noexcept {
+    return HotAlloc::allocate(n, static_cast<std::size_t>(a));
+}
+
+void operator delete(void* p) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p) noexcept { HotAlloc::deallocate(p); }
+void operator delete(void* p, std::size_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p, std::size_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { HotAlloc::deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { HotAlloc::deallocate(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { HotAlloc::deallocate(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { HotAlloc::deallocate(p); }
+#endif
+
+// Registers the calling thread, runs a "hot loop" that news/deletes small objects, then one oversized allocation.
+// Returns "served=<n> fallbacks=<m>" as seen by this thread (one extra served with the interposer compiled in),
+// then registers 8 threads at once and checks each got a heap of its own that owns what it allocates.
+std::string HOT_ALLOC_Test()
+{
+    std::string ret;
+    std::thread t{[&ret]() {
+        HotAlloc::register_hot_thread(0, 256 * 1024);
+
+        void* small[64];
+        for (int round = 0; round < 100; ++round) {
+            for (std::size_t i = 0; i < 64; ++i) small[i] = HotAlloc::allocate(8 + i * 60);
+            for (std::size_t i = 0; i < 64; ++i) HotAlloc::deallocate(small[i]);
+        }
+        void* big = HotAlloc::allocate(64 * 1024);   // larger than the largest class -> counted fallback
+        HotAlloc::deallocate(big);
+#ifdef HFT_HOT_ALLOC_INTERPOSE
+        auto* m = new OrderMsg{};                     // plain new on a hot thread is pool-served too
+        delete m;
+#endif
+
+        const HotAlloc::Stats s = HotAlloc::thread_stats();
+        HotAlloc::unregister_hot_thread();
+        std::stringstream ss;
+        ss << "served=" << s.served << " fallbacks=" << s.fallbacks;
+        ret = ss.str();
+    }};
+    t.join();
+
+    constexpr std::size_t N = 8;
+    std::atomic<bool> go{false};
+    std::array<std::uintptr_t, N> base{};
+    std::array<bool, N> owned{};
+    std::vector<std::thread> racers;
+    for (std::size_t k = 0; k < N; ++k) {
+        racers.emplace_back([&, k] {
+            while (!go.load(std::memory_order_acquire)) {}
+            HotAlloc::register_hot_thread(0, 64 * 1024);
+            void* p = HotAlloc::allocate(64);
+            base[k] = HotAlloc::detail::t_heap->lo();
+            owned[k] = HotAlloc::detail::owner_of(p) == HotAlloc::detail::t_heap;
+            HotAlloc::deallocate(p);
+            HotAlloc::unregister_hot_thread();
+        });
+    }
+    go.store(true, std::memory_order_release);
+    for (auto& r : racers) r.join();
+    std::sort(base.begin(), base.end());
+    const auto heaps = std::unique(base.begin(), base.end()) - base.begin();
+    ret += " heaps=" + std::to_string(heaps) + " owned=" + std::to_string(std::all_of(owned.begin(), owned.end(), [](bool b) { return b; }));
+    return ret;
+}
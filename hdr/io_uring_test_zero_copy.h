@@ -10,6 +10,8 @@
 #include <string>
 #include <unistd.h>
 
+#include "async-logger.h"
+
 #define PORT         12345
 #define GROUP        "239.255.0.1"
 #define QUEUE_DEPTH  256
@@ -127,7 +129,7 @@ std::string IO_URING_Test_ZERO_COPY()
         {
             break;
         }
-        std::cout << "readCount: " << readCount << std::endl;
+        HFT_LOG("readCount: {}", readCount);
         struct io_uring_cqe *cqe;
         int ret = io_uring_wait_cqe(&ring, &cqe);
         if (ret < 0) continue;
@@ -136,8 +138,7 @@ std::string IO_URING_Test_ZERO_COPY()
         {
             // Extract buffer ID
             unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
-            printf("Got packet (%d bytes) in buf %u: %.*s\n",
-                   cqe->res, bid, cqe->res, bufs[bid]);
+            HFT_LOG("Got packet ({} bytes) in buf {}: {}", cqe->res, bid, std::string_view(bufs[bid], cqe->res));
             result << bufs[bid] << " | " ;
 
             // Recycle this buffer back to kernel
@@ -156,7 +157,7 @@ std::string IO_URING_Test_ZERO_COPY()
         }
         else
         {
-            fprintf(stderr, "recvmsg failed: %s\n", strerror(-cqe->res));
+            HFT_LOG("recvmsg failed: {}", std::string_view(strerror(-cqe->res)));
         }
 
         io_uring_cqe_seen(&ring, cqe);
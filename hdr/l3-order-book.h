@@ -0,0 +1,662 @@
+/*
+        Design notes
+
+        Order-by-order (L3) book
+
+        Builds every instrument's book from an order-by-order feed (ITCH-style add / modify / execute / delete,
+        where only the add names the instrument and everything after it is keyed by order id). The book keeps
+        each order in its queue and the aggregated level (total qty, order count) next to it, so L2 readers and
+        queue-position logic read the same structure. Every message is O(1) and allocation-free.
+
+        - one L3Order per live order, from a FixedPool. It has OrderMsg's one-cache-line shape, but carries the
+          prev/next links of its level's FIFO instead of OrderMsg's instrument and padding.
+        - the order-id index is open addressing, as in MatchingEngine (linear probing, fibonacci hash,
+          backward-shift delete, id 0 reserved), 2x max_orders. The pool and the index are carved out of one
+          NumaArena. Feed order ids are unique across the feed, so one index serves every instrument.
+        - levels are tick-indexed: each side of each instrument gets `levels` slots centred on a reference price
+          (prepare(), or the first add), at the tick size of the instrument's PriceSpec. A level is the head/tail
+          of its FIFO plus the aggregate, so a level lookup is an index and adding, removing or resizing an order
+          updates the aggregate in place. A bitmap of non-empty levels moves the best price past emptied levels a
+          64-level word at a time.
+        - a feed can be momentarily locked or crossed (auctions, out-of-order venues), so unlike the matching
+          engine bids and asks have separate level arrays and nothing is ever matched here.
+        - a feed must never be refused: an order off the tick grid or outside the band is still indexed and
+          can be modified and deleted, it just is not in any level (stats().unlevelled counts them). Centre
+          the band on the previous close with prepare() so nothing during the session falls outside it.
+        - modify follows exchange priority rules: a smaller qty at the same price keeps its place, a new price
+          or a bigger qty goes to the back of the queue. execute (fills, partial cancels) keeps its place and
+          deletes the order when it reaches 0.
+        - the only allocation after start-up is an instrument's level arrays on its prepare() or first add.
+        - MapL3Book is the std::map / std::list / std::unordered_map equivalent, kept as the reference the test
+          checks against and the baseline in the benchmark.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "custom-allocator.h"
+#include "fixed-price.h"
+
+struct CACHE_ALIGNED L3Order {
+    uint64_t ts_ns;         // feed timestamp of the add, or of the modify that reset its priority
+    uint64_t order_id;
+    L3Order* prev;          // level FIFO, head = oldest
+    L3Order* next;
+    Price price;
+    uint32_t qty;           // open qty
+    int32_t tick;           // level index on its side; -1 = not in a level (off the grid or outside the band)
+    char side;              // 'B' / 'S'
+    uint32_t instr_id;
+};
+static_assert(sizeof(L3Order) == CACHELINE_SIZE);
+
+struct L3Level {
+    Price price{0};
+    uint64_t qty = 0;
+    uint32_t orders = 0;
+};
+
+struct L3BookStats {
+    uint64_t adds = 0;
+    uint64_t modifies = 0;
+    uint64_t executes = 0;
+    uint64_t deletes = 0;
+    uint64_t rejects = 0;       // unknown or duplicate id, zero qty, bad side, full pool
+    uint64_t unlevelled = 0;    // live orders outside the tick band (a gauge, not a count)
+};
+
+struct L3BookOptions {
+    std::size_t max_orders = 1 << 20;   // live at once, all instruments
+    uint32_t levels = 1 << 16;          // price band per side per instrument, in ticks
+    PriceSpecs prices;                  // tick size per instrument; default 0.01
+    int numa_node = 0;
+};
+
+class L3Book {
+public:
+    explicit L3Book(L3BookOptions opt = {})
+    : opt_(opt),
+      mask_(std::bit_ceil(std::max<std::size_t>(opt.max_orders * 2, 16)) - 1),
+      shift_(64 - std::countr_zero(mask_ + 1)),
+      arena_(pool_bytes(opt.max_orders) + (mask_ + 1) * sizeof(Slot), opt.numa_node),
+      pool_(arena_.base(), pool_bytes(opt.max_orders), opt.max_orders)
+    {
+        if (opt_.levels < 64) throw std::runtime_error("L3Book: bad levels");
+        slots_ = reinterpret_cast<Slot*>(static_cast<std::byte*>(arena_.base()) + pool_bytes(opt.max_orders));
+        std::fill_n(slots_, mask_ + 1, Slot{});
+    }
+
+    L3Book(const L3Book&) = delete;
+    L3Book& operator=(const L3Book&) = delete;
+
+    // Allocate instr's levels centred on ref_px (e.g. the previous close) before the session. False if ref_px
+    // cannot anchor a band or the instrument already has one.
+    bool prepare(uint32_t instr, Price ref_px) {
+        if (lookup(instr)) return false;
+        return make_book(instr, ref_px) != nullptr;
+    }
+
+    // False (and counted as a reject) for a zero id or qty, an unknown side, a live id, or a full pool.
+    bool add(uint64_t id, uint32_t instr, char side, Price px, uint32_t qty, uint64_t ts_ns = 0) {
+        if (!id || !qty || (side != 'B' && side != 'S') || find(id)) [[unlikely]] return reject();
+        Book* b = lookup(instr);
+        if (!b) [[unlikely]] b = make_book(instr, px);
+        L3Order* o = pool_.allocate();
+        if (!o) [[unlikely]] return reject();
+        *o = L3Order{ts_ns, id, nullptr, nullptr, px, qty, -1, side, instr};
+        insert(id, o);
+        if (b) link(*b, o);
+        if (o->tick < 0) [[unlikely]] ++stats_.unlevelled;
+        ++stats_.adds;
+        return true;
+    }
+
+    // New price and/or qty. Keeps queue position only for a smaller qty at the same price. False if unknown.
+    bool modify(uint64_t id, Price px, uint32_t qty, uint64_t ts_ns = 0) noexcept {
+        L3Order* o = find(id);
+        if (!o || !qty) [[unlikely]] return reject();
+        ++stats_.modifies;
+        if (px == o->price && qty <= o->qty) {
+            resize(o, qty);
+            return true;
+        }
+        Book* b = lookup(o->instr_id);
+        if (b && o->tick >= 0) unlink(*b, o);
+        else if (o->tick < 0) --stats_.unlevelled;
+        o->price = px;
+        o->qty = qty;
+        o->ts_ns = ts_ns;
+        o->tick = -1;
+        if (b) link(*b, o);
+        if (o->tick < 0) [[unlikely]] ++stats_.unlevelled;
+        return true;
+    }
+
+    // Take qty off the order (fill or partial cancel), keeping its place; deletes it at 0. False if unknown.
+    bool execute(uint64_t id, uint32_t qty) noexcept {
+        L3Order* o = find(id);
+        if (!o) [[unlikely]] return reject();
+        ++stats_.executes;
+        if (qty < o->qty) resize(o, o->qty - qty);
+        else drop(o);
+        return true;
+    }
+
+    // False if unknown.
+    bool remove(uint64_t id) noexcept {
+        L3Order* o = find(id);
+        if (!o) [[unlikely]] return reject();
+        ++stats_.deletes;
+        drop(o);
+        return true;
+    }
+
+    const L3Order* order(uint64_t id) const noexcept { return find(id); }
+
+    // Best level of a side; qty 0 when the side is empty.
+    L3Level best(uint32_t instr, char side) const noexcept {
+        const Book* b = lookup(instr);
+        if (!b) return {};
+        const Side& s = side == 'B' ? b->bids : b->asks;
+        return s.best >= 0 ? level_at(*b, s, s.best) : L3Level{};
+    }
+
+    // Up to n levels of a side, best first. Returns how many were written.
+    std::size_t depth(uint32_t instr, char side, L3Level* out, std::size_t n) const noexcept {
+        const Book* b = lookup(instr);
+        if (!b) return 0;
+        const Side& s = side == 'B' ? b->bids : b->asks;
+        std::size_t k = 0;
+        for (int64_t t = s.best; t >= 0 && k < n; t = next(s, t)) out[k++] = level_at(*b, s, t);
+        return k;
+    }
+
+    // f(const L3Order&) for each order at a price level, in time priority.
+    template <class F>
+    void for_each_at(uint32_t instr, char side, Price px, F&& f) const {
+        const Book* b = lookup(instr);
+        int32_t t;
+        if (!b || !to_tick(*b, side, px, t)) return;
+        const Side& s = side == 'B' ? b->bids : b->asks;
+        for (const L3Order* o = s.levels[static_cast<std::size_t>(t)].head; o; o = o->next) f(*o);
+    }
+
+    std::size_t open() const noexcept { return size_; }
+    const L3BookStats& stats() const noexcept { return stats_; }
+
+private:
+    struct Level {
+        L3Order* head = nullptr;
+        L3Order* tail = nullptr;
+        uint64_t qty = 0;
+        uint32_t orders = 0;
+    };
+
+    // Bids are stored mirrored (index 0 = highest price) so both sides find their best as the lowest set bit.
+    struct Side {
+        int64_t best = -1;              // level index; -1 = empty
+        std::vector<Level> levels;
+        std::vector<uint64_t> occupied; // bit per non-empty level
+    };
+
+    struct Book {
+        PriceSpec spec;
+        int64_t base;                   // absolute tick of the band's lowest price
+        Side bids;
+        Side asks;
+    };
+
+    struct Slot {
+        uint64_t key = 0;
+        L3Order* rec = nullptr;
+    };
+
+    static constexpr uint32_t DIRECT_IDS = 1 << 16;
+
+    // ---------- books ----------
+    Book* lookup(uint32_t instr) const noexcept {
+        if (instr < direct_.size()) [[likely]] return direct_[instr];
+        const auto it = books_.find(instr);
+        return it == books_.end() ? nullptr : it->second.get();
+    }
+
+    Book* make_book(uint32_t instr, Price px) {
+        const PriceSpec& spec = opt_.prices[instr];
+        int64_t x;
+        if (!spec.to_ticks(px, x) || x < 1) return nullptr;
+        auto b = std::make_unique<Book>();
+        b->spec = spec;
+        b->base = std::max<int64_t>(1, x - opt_.levels / 2);
+        for (Side* s : {&b->bids, &b->asks}) {
+            s->levels.resize(opt_.levels);
+            s->occupied.resize((opt_.levels + 63) / 64);
+        }
+        Book* p = books_.emplace(instr, std::move(b)).first->second.get();
+        if (instr < DIRECT_IDS) {
+            if (instr >= direct_.size()) direct_.resize(instr + 1, nullptr);
+            direct_[instr] = p;
+        }
+        return p;
+    }
+
+    bool to_tick(const Book& b, char side, Price px, int32_t& t) const noexcept {
+        int64_t x;
+        if (!b.spec.to_ticks(px, x) || x < b.base || x >= b.base + opt_.levels) return false;
+        const auto off = static_cast<int32_t>(x - b.base);
+        t = side == 'B' ? static_cast<int32_t>(opt_.levels) - 1 - off : off;
+        return true;
+    }
+
+    L3Level level_at(const Book& b, const Side& s, int64_t t) const noexcept {
+        const Level& l = s.levels[static_cast<std::size_t>(t)];
+        const int64_t off = &s == &b.bids ? opt_.levels - 1 - t : t;
+        return L3Level{b.spec.from_ticks(b.base + off), l.qty, l.orders};
+    }
+
+    // First non-empty level after t (worse price), or -1.
+    static int64_t next(const Side& s, int64_t t) noexcept {
+        std::size_t w = static_cast<std::size_t>(t + 1) >> 6;
+        if (w >= s.occupied.size()) return -1;
+        uint64_t bits = s.occupied[w] & (~uint64_t{0} << ((t + 1) & 63));
+        while (!bits) {
+            if (++w == s.occupied.size()) return -1;
+            bits = s.occupied[w];
+        }
+        return static_cast<int64_t>(w * 64 + static_cast<std::size_t>(std::countr_zero(bits)));
+    }
+
+    // ---------- levels ----------
+    // Append o to the back of its price's FIFO; leaves o->tick = -1 if the price has no level.
+    void link(Book& b, L3Order* o) noexcept {
+        int32_t t;
+        if (!to_tick(b, o->side, o->price, t)) [[unlikely]] return;
+        Side& s = o->side == 'B' ? b.bids : b.asks;
+        Level& l = s.levels[static_cast<std::size_t>(t)];
+        o->tick = t;
+        o->prev = l.tail;
+        o->next = nullptr;
+        if (l.tail) {
+            l.tail->next = o;
+        } else {
+            l.head = o;
+            s.occupied[static_cast<std::size_t>(t) >> 6] |= uint64_t{1} << (t & 63);
+            if (s.best < 0 || t < s.best) s.best = t;
+        }
+        l.tail = o;
+        l.qty += o->qty;
+        ++l.orders;
+    }
+
+    void unlink(Book& b, L3Order* o) noexcept {
+        Side& s = o->side == 'B' ? b.bids : b.asks;
+        Level& l = s.levels[static_cast<std::size_t>(o->tick)];
+        (o->prev ? o->prev->next : l.head) = o->next;
+        (o->next ? o->next->prev : l.tail) = o->prev;
+        l.qty -= o->qty;
+        --l.orders;
+        if (l.head) return;
+        s.occupied[static_cast<std::size_t>(o->tick) >> 6] &= ~(uint64_t{1} << (o->tick & 63));
+        if (o->tick == s.best) s.best = next(s, o->tick);
+    }
+
+    void resize(L3Order* o, uint32_t qty) noexcept {
+        if (o->tick >= 0) {
+            Book& b = *lookup(o->instr_id);
+            Level& l = (o->side == 'B' ? b.bids : b.asks).levels[static_cast<std::size_t>(o->tick)];
+            l.qty = l.qty - o->qty + qty;
+        }
+        o->qty = qty;
+    }
+
+    void drop(L3Order* o) noexcept {
+        if (o->tick >= 0) unlink(*lookup(o->instr_id), o);
+        else --stats_.unlevelled;
+        erase(o->order_id);
+        pool_.deallocate(o);
+    }
+
+    bool reject() noexcept {
+        ++stats_.rejects;
+        return false;
+    }
+
+    // ---------- order-id index ----------
+    L3Order* find(uint64_t id) const noexcept {
+        for (std::size_t i = home(id); slots_[i].key; i = (i + 1) & mask_) {
+            if (slots_[i].key == id) return slots_[i].rec;
+        }
+        return nullptr;
+    }
+
+    void insert(uint64_t id, L3Order* o) noexcept {
+        std::size_t i = home(id);
+        while (slots_[i].key) i = (i + 1) & mask_;
+        slots_[i] = Slot{id, o};
+        ++size_;
+    }
+
+    void erase(uint64_t id) noexcept {
+        std::size_t i = home(id);
+        for (; slots_[i].key != id; i = (i + 1) & mask_) {
+            if (!slots_[i].key) return;
+        }
+        --size_;
+        for (std::size_t j = (i + 1) & mask_; slots_[j].key; j = (j + 1) & mask_) {
+            const std::size_t h = home(slots_[j].key);
+            if (((j - h) & mask_) >= ((j - i) & mask_)) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i] = Slot{};
+    }
+
+    static std::size_t pool_bytes(std::size_t capacity) noexcept { return capacity * FixedPool<L3Order>::slot_bytes(); }
+    std::size_t home(uint64_t id) const noexcept { return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> shift_); }
+
+    L3BookOptions opt_;
+    std::size_t mask_;
+    int shift_;
+    NumaArena arena_;
+    FixedPool<L3Order> pool_;
+    Slot* slots_{nullptr};
+    std::size_t size_{0};
+    L3BookStats stats_;
+    std::unordered_map<uint32_t, std::unique_ptr<Book>> books_;
+    std::vector<Book*> direct_;     // books of ids below DIRECT_IDS, indexed by id
+};
+
+// ---------- reference ----------
+// std::map levels, std::list FIFOs, std::unordered_map index; any price. Same levels and queues as L3Book for
+// prices inside L3Book's band.
+class MapL3Book {
+public:
+    bool add(uint64_t id, uint32_t instr, char side, Price px, uint32_t qty, uint64_t = 0) {
+        if (!id || !qty || (side != 'B' && side != 'S') || index_.count(id)) return false;
+        rest(id, instr, side, px, qty);
+        return true;
+    }
+
+    bool modify(uint64_t id, Price px, uint32_t qty, uint64_t = 0) {
+        const auto it = index_.find(id);
+        if (it == index_.end() || !qty) return false;
+        Locator& loc = it->second;
+        if (px == loc.price && qty <= loc.pos->qty) {
+            level(loc).qty -= loc.pos->qty - qty;
+            loc.pos->qty = qty;
+            return true;
+        }
+        const Locator old = loc;
+        pull(old);
+        index_.erase(it);
+        rest(id, old.instr_id, old.side, px, qty);
+        return true;
+    }
+
+    bool execute(uint64_t id, uint32_t qty) {
+        const auto it = index_.find(id);
+        if (it == index_.end()) return false;
+        if (qty < it->second.pos->qty) {
+            level(it->second).qty -= qty;
+            it->second.pos->qty -= qty;
+            return true;
+        }
+        pull(it->second);
+        index_.erase(it);
+        return true;
+    }
+
+    bool remove(uint64_t id) {
+        const auto it = index_.find(id);
+        if (it == index_.end()) return false;
+        pull(it->second);
+        index_.erase(it);
+        return true;
+    }
+
+    std::size_t depth(uint32_t instr, char side, L3Level* out, std::size_t n) const {
+        const auto it = books_.find(instr);
+        if (it == books_.end()) return 0;
+        std::size_t k = 0;
+        auto copy = [&](const auto& levels) {
+            for (auto l = levels.begin(); l != levels.end() && k < n; ++l)
+                out[k++] = L3Level{l->first, l->second.qty, static_cast<uint32_t>(l->second.fifo.size())};
+        };
+        if (side == 'B') copy(it->second.bids);
+        else copy(it->second.asks);
+        return k;
+    }
+
+    std::size_t open() const noexcept { return index_.size(); }
+
+private:
+    struct Resting {
+        uint64_t order_id;
+        uint32_t qty;
+    };
+    struct Level {
+        std::list<Resting> fifo;
+        uint64_t qty = 0;
+    };
+    struct Book {
+        std::map<Price, Level, std::greater<Price>> bids;
+        std::map<Price, Level> asks;
+    };
+    struct Locator {
+        uint32_t instr_id;
+        char side;
+        Price price;
+        std::list<Resting>::iterator pos;
+    };
+
+    Level& level(const Locator& loc) {
+        Book& b = books_[loc.instr_id];
+        return loc.side == 'B' ? b.bids[loc.price] : b.asks[loc.price];
+    }
+
+    void rest(uint64_t id, uint32_t instr, char side, Price px, uint32_t qty) {
+        Book& b = books_[instr];
+        Level& l = side == 'B' ? b.bids[px] : b.asks[px];
+        l.fifo.push_back(Resting{id, qty});
+        l.qty += qty;
+        index_[id] = Locator{instr, side, px, std::prev(l.fifo.end())};
+    }
+
+    void pull(const Locator& loc) {
+        Book& b = books_[loc.instr_id];
+        auto drop = [&](auto& levels) {
+            const auto l = levels.find(loc.price);
+            l->second.qty -= loc.pos->qty;
+            l->second.fifo.erase(loc.pos);
+            if (l->second.fifo.empty()) levels.erase(l);
+        };
+        if (loc.side == 'B') drop(b.bids);
+        else drop(b.asks);
+    }
+
+    std::unordered_map<uint32_t, Book> books_;
+    std::unordered_map<uint64_t, Locator> index_;
+};
+
+// ---------- synthetic day ----------
+namespace l3_detail {
+
+struct FeedEvent {
+    char type;              // 'A' add, 'M' modify, 'E' execute, 'D' delete
+    char side;
+    uint32_t instr_id;
+    uint64_t order_id;
+    Price price;
+    uint32_t qty;
+};
+
+// Shaped like a day on an equities L3 feed: roughly as many deletes as adds (most orders are pulled, many within
+// a few messages), a few percent executions and modifies, adds clustered near the touch with a geometric tail,
+// and a mid that random-walks. Keeps about `live` orders per instrument resting.
+inline std::vector<FeedEvent> make_day(std::size_t n, uint64_t seed, uint32_t instruments = 4, std::size_t live = 20000) {
+    struct Live {
+        uint64_t id;
+        uint32_t instr;
+        char side;
+        int64_t tick;
+        uint32_t qty;
+    };
+    std::mt19937_64 rng(seed);
+    std::geometric_distribution<int> away(0.3);
+    std::vector<FeedEvent> ev;
+    ev.reserve(n);
+    std::vector<Live> book;
+    std::vector<int> mid(instruments, 10000);
+    uint64_t next_id = 1;
+    while (ev.size() < n) {
+        const uint32_t roll = static_cast<uint32_t>(rng() % 100);
+        const uint32_t instr = static_cast<uint32_t>(rng() % instruments);
+        if (rng() % 64 == 0) mid[instr] += rng() & 1 ? 1 : -1;
+        const bool grow = book.size() < live * instruments;
+        if (book.empty() || roll < (grow ? 60u : 45u)) {
+            const char side = rng() & 1 ? 'B' : 'S';
+            const int off = 1 + std::min(away(rng), 200);
+            const int64_t tick = side == 'B' ? mid[instr] - off : mid[instr] + off;
+            const uint32_t qty = 100 * (1 + static_cast<uint32_t>(rng() % 10));
+            book.push_back(Live{next_id, 1 + instr, side, tick, qty});
+            ev.push_back(FeedEvent{'A', side, 1 + instr, next_id++, 0.01_px * tick, qty});
+            continue;
+        }
+        // Victims skew young: half the time one of the last 64 orders.
+        const std::size_t i = rng() & 1 ? book.size() - 1 - rng() % std::min<std::size_t>(64, book.size())
+                                        : rng() % book.size();
+        Live& v = book[i];
+        if (roll < 92) {
+            ev.push_back(FeedEvent{'D', v.side, v.instr, v.id, 0.01_px * v.tick, 0});
+        } else if (roll < 96) {
+            const uint32_t q = 100 * (1 + static_cast<uint32_t>(rng() % 5));
+            ev.push_back(FeedEvent{'E', v.side, v.instr, v.id, 0.01_px * v.tick, q});
+            if (q < v.qty) {
+                v.qty -= q;
+                continue;
+            }
+        } else {
+            if (rng() & 1) v.qty = std::max<uint32_t>(100, v.qty - 100);
+            else v.tick += (v.side == 'B' ? -1 : 1) * static_cast<int64_t>(1 + rng() % 3);
+            ev.push_back(FeedEvent{'M', v.side, v.instr, v.id, 0.01_px * v.tick, v.qty});
+            continue;
+        }
+        v = book.back();
+        book.pop_back();
+    }
+    return ev;
+}
+
+template <class Book>
+bool apply(Book& b, const FeedEvent& e) {
+    switch (e.type) {
+    case 'A': return b.add(e.order_id, e.instr_id, e.side, e.price, e.qty);
+    case 'M': return b.modify(e.order_id, e.price, e.qty);
+    case 'E': return b.execute(e.order_id, e.qty);
+    default: return b.remove(e.order_id);
+    }
+}
+
+// Top n levels of both sides of every instrument agree.
+template <class A, class B>
+bool same_depth(const A& a, const B& b, uint32_t instruments, std::size_t n) {
+    std::vector<L3Level> x(n), y(n);
+    for (uint32_t i = 1; i <= instruments; ++i) {
+        for (char side : {'B', 'S'}) {
+            const std::size_t k = a.depth(i, side, x.data(), n);
+            if (k != b.depth(i, side, y.data(), n)) return false;
+            for (std::size_t j = 0; j < k; ++j)
+                if (x[j].price != y[j].price || x[j].qty != y[j].qty || x[j].orders != y[j].orders) return false;
+        }
+    }
+    return true;
+}
+
+} // namespace l3_detail
+
+// Levels aggregate their queues; a smaller qty keeps priority, a new price or bigger qty loses it; executions
+// shrink in place and delete at 0; out-of-band orders are kept but not levelled; a synthetic day gives the same
+// depth as the reference book.
+std::string L3_BOOK_Test()
+{
+    std::stringstream ss;
+    L3Book b(L3BookOptions{1024, 1024, {}, 0});
+    auto top = [&](char side) {
+        const L3Level l = b.best(7, side);
+        return std::to_string(l.price.raw / 1'000'000) + "x" + std::to_string(l.qty) + "/" + std::to_string(l.orders);
+    };
+    auto queue = [&](Price px) {
+        std::string q;
+        b.for_each_at(7, 'B', px, [&](const L3Order& o) { q += (q.empty() ? "" : ",") + std::to_string(o.order_id) + ":" + std::to_string(o.qty); });
+        return q;
+    };
+    b.prepare(7, 100_px);
+    b.add(1, 7, 'B', 100_px, 10);
+    b.add(2, 7, 'B', 100_px, 5);
+    b.add(3, 7, 'B', 99.99_px, 7);
+    b.add(4, 7, 'S', 100.02_px, 3);
+    ss << "bid=" << top('B') << " ask=" << top('S');
+    b.execute(1, 4);
+    ss << " q=" << queue(100_px);
+    b.modify(2, 100_px, 3);
+    ss << " q=" << queue(100_px);
+    b.modify(1, 100_px, 9);
+    ss << " q=" << queue(100_px);
+    b.modify(2, 100.01_px, 3);
+    ss << " bid=" << top('B');
+    b.remove(2);
+    ss << " bid=" << top('B');
+    b.execute(1, 9);
+    ss << " bid=" << top('B');
+    ss << " dup=" << !b.add(3, 7, 'B', 99_px, 1) << " unknown=" << !b.remove(99);
+    b.add(5, 7, 'B', 500_px, 1);
+    ss << " unlevelled=" << b.stats().unlevelled << " open=" << b.open();
+    b.remove(5);
+
+    L3Book fast(L3BookOptions{1 << 17, 4096, {}, 0});
+    MapL3Book ref;
+    bool agree = true;
+    std::size_t i = 0;
+    for (const auto& e : l3_detail::make_day(200000, 5, 4, 2000)) {
+        agree &= l3_detail::apply(fast, e) == l3_detail::apply(ref, e);
+        if (++i % 1000 == 0) agree &= l3_detail::same_depth(fast, ref, 4, 10);
+    }
+    ss << " reference=" << (agree && l3_detail::same_depth(fast, ref, 4, 1000) && fast.open() == ref.open() &&
+                            fast.stats().unlevelled == 0);
+    return ss.str();
+}
+
+// Feed messages per second on one core replaying a synthetic day, this book vs the std::map one.
+void L3_BOOK_BENCH()
+{
+    constexpr std::size_t N = 4'000'000;
+    const auto day = l3_detail::make_day(N, 42);
+    uint64_t sink = 0;
+    auto run = [&](auto& book) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (const auto& e : day) sink += l3_detail::apply(book, e);
+        return static_cast<double>(N) / std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / 1e6;
+    };
+    L3Book fast(L3BookOptions{1 << 17, 1 << 16, {}, 0});
+    MapL3Book ref;
+    const double f = run(fast);
+    const double m = run(ref);
+    // A busy session on one venue's L3 feed is a few hundred million messages.
+    std::cout << "L3_BOOK_BENCH pooled L3 book: " << f << " M msgs/s (" << 300.0 / f << " s per 300M-message day), std::map book: "
+              << m << " M msgs/s, resting " << fast.open() << " (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,117 @@
+/*
+        Design notes
+
+        Log-linear latency histogram
+
+        Hot paths record a latency sample per order/message; percentiles are only read by monitors and reports.
+
+        - buckets are log-linear (HdrHistogram style): every power of two is split into 32 linear sub-buckets, so
+          any recorded value is reported within ~3% of its true value, from 1ns up to the full uint64_t range, in a
+          fixed 1920-bucket array (15KB). No allocation after construction, no resizing.
+        - record() is a bit scan, a shift and one increment: no branches on the value beyond the small/large split.
+        - min/max/sum are kept exactly; percentile() walks the buckets and returns the bucket's upper edge.
+        - not thread-safe: one writer (the thread that owns the path being measured). merge() combines per-thread
+          histograms on the reporting side.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr uint64_t SUB = 1ull << SUB_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BITS) * SUB + SUB;   // last exponent's sub-buckets end here
+
+    void record(uint64_t v) noexcept {
+        ++counts_[index(v)];
+        ++count_;
+        sum_ += v;
+        min_ = std::min(min_, v);
+        max_ = std::max(max_, v);
+    }
+
+    void merge(const LatencyHistogram& o) noexcept {
+        for (std::size_t i = 0; i < BUCKETS; ++i) counts_[i] += o.counts_[i];
+        count_ += o.count_;
+        sum_ += o.sum_;
+        min_ = std::min(min_, o.min_);
+        max_ = std::max(max_, o.max_);
+    }
+
+    void reset() noexcept { *this = LatencyHistogram{}; }
+
+    // Smallest recorded-bucket upper edge with at least p% of the samples at or below it (clamped to max).
+    uint64_t percentile(double p) const noexcept {
+        if (!count_) return 0;
+        const auto want = static_cast<uint64_t>(std::max(1.0, p / 100.0 * static_cast<double>(count_) + 0.5));
+        uint64_t seen = 0;
+        for (std::size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= std::min(want, count_)) return std::min(upper(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t count() const noexcept { return count_; }
+    uint64_t min() const noexcept { return count_ ? min_ : 0; }
+    uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return count_ ? static_cast<double>(sum_) / static_cast<double>(count_) : 0.0; }
+
+    // "n=... min=... p50=... p99=... p99.9=... max=..." in the unit the samples were recorded in.
+    std::string summary() const {
+        std::stringstream ss;
+        ss << "n=" << count_ << " min=" << min() << " p50=" << percentile(50) << " p99=" << percentile(99)
+           << " p99.9=" << percentile(99.9) << " max=" << max_;
+        return ss.str();
+    }
+
+    // Bucket of v: values below 2*SUB map to themselves, larger ones keep their top SUB_BITS+1 bits.
+    static constexpr std::size_t index(uint64_t v) noexcept {
+        const int msb = 63 - std::countl_zero(v | 1);
+        const int e = std::max(0, msb - SUB_BITS);
+        return static_cast<std::size_t>(e) * SUB + static_cast<std::size_t>(v >> e);
+    }
+
+    // Largest value that lands in bucket i.
+    static constexpr uint64_t upper(std::size_t i) noexcept {
+        if (i < 2 * SUB) return i;
+        const std::size_t e = i / SUB - 1;
+        const uint64_t lo = static_cast<uint64_t>(i - e * SUB) << e;
+        return lo + ((1ull << e) - 1);
+    }
+
+private:
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t min_ = std::numeric_limits<uint64_t>::max();
+    uint64_t max_ = 0;
+};
+
+// Bucket edges round-trip, percentiles of a known distribution land within bucket precision, merge adds up.
+std::string LATENCY_HIST_Test()
+{
+    std::stringstream ss;
+    bool edges = true;
+    for (uint64_t v : {0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456789ull, ~0ull})
+        edges &= LatencyHistogram::upper(LatencyHistogram::index(v)) >= v &&
+                 LatencyHistogram::index(LatencyHistogram::upper(LatencyHistogram::index(v))) == LatencyHistogram::index(v);
+
+    LatencyHistogram a, b;
+    for (uint64_t v = 1; v <= 10000; ++v) (v % 2 ? a : b).record(v);
+    a.merge(b);
+    auto near = [](uint64_t got, uint64_t want) { return got >= want && got <= want + want / 16; };
+    ss << "edges=" << edges << " n=" << a.count() << " min=" << a.min() << " max=" << a.max()
+       << " p50=" << near(a.percentile(50), 5000) << " p99=" << near(a.percentile(99), 9900)
+       << " mean=" << a.mean();
+    return ss.str();
+}
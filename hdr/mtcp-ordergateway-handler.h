@@ -3,17 +3,38 @@
 #include <mtcp_api.h>
 #include <mtcp_epoll.h>
 #include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <chrono>
+#include <utility>
+#include <vector>
+
+#include "async-logger.h"
+#include "custom-allocator.h"
+#include "order-throttle.h"
+#include "order-tracker.h"
+#include "order-wire.h"
+#include "risk-engine.h"
 
 class OrderGateway {
     int core_id;
     mctx_t mctx;
     int sock;
+    OrderTracker tracker_;
+    RiskEngine* risk_ = nullptr;
+    OrderThrottle* throttle_ = nullptr;
+    ThrottleMode throttle_mode_ = ThrottleMode::Reject;
+    ThrottleQueue<Order, 1024> throttled_;
+    char rx_[4096];
 
 public:
-    OrderGateway(int cid = 0) : core_id(cid), mctx(nullptr), sock(-1) {
+    OrderGateway(int cid = 0, std::size_t max_open = 64 * 1024)
+    : core_id(cid), mctx(nullptr), sock(-1), tracker_(max_open, numa_node_of_cpu(cid)) {
         // Init mTCP per core
         mtcp_core_affinitize(core_id);
         mctx = mtcp_create_context(core_id);
@@ -39,26 +60,511 @@ public:
         if (mtcp_connect(mctx, sock, (sockaddr*)&addr, sizeof(addr)) < 0) {
             throw std::runtime_error("connect failed");
         }
+        // Reports are polled from the send loop, so reads must never block it.
+        if (mtcp_setsock_nonblock(mctx, sock) < 0) {
+            throw std::runtime_error("mtcp_setsock_nonblock failed");
+        }
         std::cout << "Connected to " << ip << ":" << port << "\n";
     }
 
-    void send_order(const Order& o) {
-        char buf[sizeof(Order)];
-        o.serialize(buf);
-        int ret = mtcp_write(mctx, sock, buf, sizeof(Order));
-        if (ret < 0) {
-            std::cerr << "Failed to send order\n";
-        } else {
-            std::cout << "Sent order_id=" << o.order_id
-                      << " instr=" << o.instr_id
-                      << " px=" << o.price
-                      << " qty=" << o.qty
-                      << " side=" << o.side << "\n";
+    // Every order goes through `risk` before it is written, and its reports update risk's exposure.
+    void set_risk(RiskEngine* risk) noexcept { risk_ = risk; }
+
+    // Orders beyond the session's / instrument's rate limits are rejected, or held and released by
+    // pump_throttled() once the limits allow (Queue).
+    void set_throttle(OrderThrottle* throttle, ThrottleMode mode = ThrottleMode::Reject) noexcept {
+        throttle_ = throttle;
+        throttle_mode_ = mode;
+    }
+
+    // True if the order was sent, or queued behind the throttle. False if it was not: risk rejected it, the
+    // throttle did (or its queue is full), its id is still live, the open-order table is full, or the write failed.
+    // send_tsc is where send->ack latency is measured from; a load generator passes the time the order was due.
+    bool send_order(const Order& o, uint64_t send_tsc = TscClock::now_tsc()) {
+        if (risk_) {
+            if (const RiskResult r = risk_->check_and_accept(o.instr_id, o.side, o.price, o.qty); r != RiskResult::Ok) [[unlikely]] {
+                HFT_LOG("Risk rejected order_id={}: {}", o.order_id, to_string(r));
+                return false;
+            }
+        }
+        if (throttle_) {
+            const uint64_t now = TscClock::now_tsc();
+            // Nothing overtakes an order already waiting in the queue.
+            const bool behind = throttle_mode_ == ThrottleMode::Queue && !throttled_.empty();
+            if (behind || !throttle_->admit(o.instr_id, now)) [[unlikely]] {
+                // Queued under send_tsc, so send->ack still counts the time spent waiting for the throttle.
+                if (throttle_mode_ == ThrottleMode::Queue && throttled_.push(o, o.instr_id, std::min(send_tsc, now))) return true;
+                if (risk_) risk_->on_done(o.instr_id, o.side, o.qty);
+                HFT_LOG("Throttled order_id={} instr={}", o.order_id, o.instr_id);
+                return false;
+            }
+        }
+        return write_order(o, send_tsc);
+    }
+
+    // Cancel/replace fast path: the order's ReplaceMsg was encoded when it was sent; only id/price/qty are patched
+    // in place before the write. Amends are never queued behind the throttle (a late amend is a stale one). False
+    // if not sent: the order is not live and acked, risk, the tracker or the throttle refused, or the write failed.
+    // A short write is on the wire and cannot be taken back, so risk takes the amend as it does a full one.
+    bool amend(uint64_t order_id, uint64_t new_order_id, Price px, uint32_t qty, uint64_t send_tsc = TscClock::now_tsc()) {
+        const OpenOrder* cur = tracker_.find(order_id);
+        if (!cur) [[unlikely]] return false;
+        const int64_t delta = static_cast<int64_t>(qty) - static_cast<int64_t>(cur->qty);
+        const uint64_t now = TscClock::now_tsc();
+        if (risk_) {
+            if (const RiskResult r = risk_->check_amend(cur->instr_id, cur->side, px, qty, delta, now); r != RiskResult::Ok) [[unlikely]] {
+                HFT_LOG("Risk rejected amend of order_id={}: {}", order_id, to_string(r));
+                return false;
+            }
+        }
+        // The tracker decides before the throttle spends a token on an amend that would not go out.
+        OpenOrder* o = tracker_.on_replace(order_id, new_order_id, px, qty, send_tsc);
+        if (!o) [[unlikely]] return false;
+        if (throttle_ && !throttle_->admit(o->instr_id, now)) [[unlikely]] {
+            tracker_.forget_replace(o);
+            HFT_LOG("Throttled amend of order_id={}", order_id);
+            return false;
+        }
+        const int ret = mtcp_write(mctx, sock, reinterpret_cast<const char*>(&o->replace), sizeof(ReplaceMsg));
+        if (ret <= 0) [[unlikely]] {
+            tracker_.forget_replace(o);
+            HFT_LOG("Failed to send amend of order_id={} ret={}", order_id, ret);
+            return false;
+        }
+        if (risk_) risk_->accept_amend(o->instr_id, o->side, delta, now);
+        if (ret != static_cast<int>(sizeof(ReplaceMsg))) [[unlikely]] {
+            HFT_LOG("Short write of amend of order_id={} ret={}", order_id, ret);
+            return false;
+        }
+        return true;
+    }
+
+    // Cancels always go out: they reduce risk, so neither risk nor the throttle holds them back (the throttle
+    // still counts them). False if the order is not live, already being amended/cancelled, or the write failed.
+    bool cancel(uint64_t order_id) {
+        OpenOrder* o = tracker_.on_cancel(order_id);
+        if (!o) [[unlikely]] return false;
+        if (throttle_) throttle_->consume(o->instr_id, TscClock::now_tsc());
+        const int ret = mtcp_write(mctx, sock, reinterpret_cast<const char*>(&o->cancel), sizeof(CancelMsg));
+        if (ret != static_cast<int>(sizeof(CancelMsg))) [[unlikely]] {
+            if (ret <= 0) tracker_.forget_cancel(o);
+            HFT_LOG("Failed to send cancel of order_id={} ret={}", order_id, ret);
+            return false;
+        }
+        return true;
+    }
+
+    // Send queued orders whose rate limits now allow them. poll_reports() calls it; returns orders released.
+    std::size_t pump_throttled() {
+        if (!throttle_ || throttled_.empty()) return 0;
+        return throttled_.pump(*throttle_, [this](const Order& o, uint64_t enq_tsc) { write_order(o, enq_tsc); });
+    }
+
+    // Drain whatever the exchange sent and apply it to the open orders. Never blocks. Returns the number of
+    // reports applied, or -1 if the session is gone.
+    int poll_reports() {
+        pump_throttled();
+        int reports = 0;
+        for (;;) {
+            const int r = mtcp_read(mctx, sock, rx_, sizeof(rx_));
+            if (r > 0) {
+                reports += static_cast<int>(tracker_.on_bytes(rx_, static_cast<std::size_t>(r), [this](const OpenOrder& o, const ExecReport& rep) {
+                    if (!risk_) return;
+                    if (rep.type == ExecReport::Fill) risk_->on_fill(o.instr_id, o.side, rep.last_qty);
+                    if (rep.type == ExecReport::Rejected && o.state != OrderState::Rejected && o.pending_qty_delta)
+                        risk_->on_amend_rejected(o.instr_id, o.side, o.pending_qty_delta);
+                    if (is_terminal(o.state)) risk_->on_done(o.instr_id, o.side, o.qty - std::min(o.filled, o.qty));
+                }));
+                if (static_cast<std::size_t>(r) < sizeof(rx_)) return reports;
+                continue;
+            }
+            if (r < 0 && errno == EAGAIN) return reports;
+            HFT_LOG("Order session closed while reading reports r={} errno={}", r, errno);
+            return -1;
+        }
+    }
+
+    const OrderTracker& tracker() const noexcept { return tracker_; }
+    const ThrottleQueue<Order, 1024>& throttle_queue() const noexcept { return throttled_; }
+
+private:
+    bool write_order(const Order& o, uint64_t send_tsc = TscClock::now_tsc()) {
+        if (!tracker_.on_send(o, send_tsc)) {
+            if (risk_) risk_->on_done(o.instr_id, o.side, o.qty);
+            HFT_LOG("Refused order_id={}: id live or open-order table full", o.order_id);
+            return false;
+        }
+        const NewOrderMsg msg{NewOrderType, o};
+        int ret = mtcp_write(mctx, sock, reinterpret_cast<const char*>(&msg), sizeof(msg));
+        if (ret != static_cast<int>(sizeof(msg))) {
+            // A short write cannot be taken back; only a write that took nothing is safe to forget.
+            if (ret <= 0) {
+                tracker_.forget(o.order_id);
+                if (risk_) risk_->on_done(o.instr_id, o.side, o.qty);
+            }
+            HFT_LOG("Failed to send order_id={} ret={}", o.order_id, ret);
+            return false;
+        }
+        HFT_LOG("Sent order_id={} instr={} px={} qty={} side={}", o.order_id, o.instr_id, o.price, o.qty, o.side);
+        return true;
+    }
+};
+
+/*
+        Multi-session gateway
+
+        One mTCP context, one core, N exchange sessions, all non-blocking and multiplexed with mtcp_epoll_wait.
+
+        - connect never blocks: EINPROGRESS puts the session in Connecting with EPOLLOUT interest; writability then
+          means "handshake finished", confirmed with SO_ERROR before the session becomes Connected.
+        - send() writes straight to the socket when nothing is queued (the common case: one mtcp_write, no copy).
+          Whatever the socket does not take - or everything, while still connecting - is appended to the session's
+          send queue, and EPOLLOUT interest is switched on until the queue drains. Interest in EPOLLOUT is only held
+          while there is something to write, so a healthy session never wakes up for it.
+        - the queue is a FIFO of 1KB chunks from a FixedPool shared by all sessions; small orders are coalesced
+          into the tail chunk, so a burst goes out in few writes. max_queued_bytes bounds each session: beyond it
+          send() refuses (back-pressure to the strategy) instead of buffering without limit.
+        - a send is all or nothing, so a dry pool never leaves half an order on the wire: a direct write keeps one
+          spare chunk per session for its remainder, every other send reserves all its chunks before copying.
+        - read readiness drains the socket into the session's receive buffer and hands each read to the caller's
+          callback, which parses in place.
+*/
+enum class SessionState : uint8_t { Closed, Connecting, Connected, Failed };
+
+inline const char* to_string(SessionState s) {
+    switch (s) {
+    case SessionState::Closed: return "closed";
+    case SessionState::Connecting: return "connecting";
+    case SessionState::Connected: return "connected";
+    case SessionState::Failed: return "failed";
+    }
+    return "?";
+}
+
+struct GatewayOptions {
+    int core_id = 0;
+    std::size_t send_chunks = 4096;               // pooled 1KB send buffers, shared by all sessions
+    std::size_t max_queued_bytes = 256 * 1024;    // per session; send() refuses beyond this
+    int max_events = 1024;
+};
+
+class MultiSessionGateway {
+public:
+    using SessionId = uint32_t;
+    static constexpr std::size_t RX_BYTES = 8192;
+
+    struct CACHE_ALIGNED SendChunk {
+        SendChunk* next;
+        uint32_t len;     // bytes filled
+        uint32_t off;     // bytes already written
+        char data[1024 - sizeof(SendChunk*) - 2 * sizeof(uint32_t)];
+    };
+
+    explicit MultiSessionGateway(GatewayOptions opt = {})
+    : opt_(opt),
+      arena_(opt.send_chunks * FixedPool<SendChunk>::slot_bytes(), numa_node_of_cpu(opt.core_id)),
+      chunks_(arena_, opt.send_chunks),
+      events_(static_cast<std::size_t>(opt.max_events))
+    {
+        mtcp_core_affinitize(opt_.core_id);
+        mctx_ = mtcp_create_context(opt_.core_id);
+        if (!mctx_) throw std::runtime_error("Failed to create mTCP context");
+        ep_ = mtcp_epoll_create(mctx_, opt_.max_events);
+        if (ep_ < 0) {
+            mtcp_destroy_context(mctx_);
+            throw std::runtime_error("mtcp_epoll_create failed");
+        }
+    }
+
+    MultiSessionGateway(const MultiSessionGateway&) = delete;
+    MultiSessionGateway& operator=(const MultiSessionGateway&) = delete;
+
+    ~MultiSessionGateway() {
+        for (auto& s : sessions_) close_session(s, SessionState::Closed);
+        mtcp_close(mctx_, ep_);
+        mtcp_destroy_context(mctx_);
+    }
+
+    // Register a session and start connecting it. Cold path.
+    SessionId add_session(const std::string& ip, uint16_t port) {
+        Session s;
+        s.addr.sin_family = AF_INET;
+        s.addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, ip.c_str(), &s.addr.sin_addr) != 1) throw std::runtime_error("bad address " + ip);
+        sessions_.push_back(std::move(s));
+        const auto id = static_cast<SessionId>(sessions_.size() - 1);
+        connect(id);
+        return id;
+    }
+
+    // (Re)start a non-blocking connect. False if it failed outright.
+    bool connect(SessionId id) {
+        Session& s = sessions_[id];
+        if (s.state == SessionState::Connecting || s.state == SessionState::Connected) return true;
+        s.sock = mtcp_socket(mctx_, AF_INET, SOCK_STREAM, 0);
+        if (s.sock < 0 || mtcp_setsock_nonblock(mctx_, s.sock) < 0) {
+            close_session(s, SessionState::Failed);
+            return false;
+        }
+        if (mtcp_connect(mctx_, s.sock, reinterpret_cast<sockaddr*>(&s.addr), sizeof(s.addr)) == 0) {
+            s.state = SessionState::Connected;
+            return watch(id, MTCP_EPOLLIN | (s.head ? MTCP_EPOLLOUT : 0u), MTCP_EPOLL_CTL_ADD);
+        }
+        if (errno != EINPROGRESS) {
+            HFT_LOG("session {} connect failed errno={}", id, errno);
+            close_session(s, SessionState::Failed);
+            return false;
+        }
+        s.state = SessionState::Connecting;
+        return watch(id, MTCP_EPOLLOUT, MTCP_EPOLL_CTL_ADD);
+    }
+
+    // Hot path. All or nothing: false (and nothing sent) if the session is down, over its queue limit, or the
+    // buffer pool is dry.
+    bool send(SessionId id, const void* data, std::size_t len) noexcept {
+        Session& s = sessions_[id];
+        if ((s.state != SessionState::Connected && s.state != SessionState::Connecting) ||
+            s.queued + len > opt_.max_queued_bytes) [[unlikely]] {
+            ++s.refused;
+            return false;
+        }
+        auto* p = static_cast<const char*>(data);
+
+        // Nothing queued: straight to the socket. The session's spare chunk guarantees a short write can always
+        // be queued, so the common case touches the pool only after a spare was used up.
+        if (s.state == SessionState::Connected && !s.head && len <= CHUNK_BYTES) {
+            if (!s.spare) [[unlikely]] {
+                if (!(s.spare = chunks_.allocate())) {
+                    ++s.refused;
+                    return false;
+                }
+                s.spare->next = nullptr;
+            }
+            const int w = mtcp_write(mctx_, s.sock, p, len);
+            if (w == static_cast<int>(len)) {
+                s.sent += len;
+                return true;
+            }
+            if (w < 0 && errno != EAGAIN) [[unlikely]] {
+                close_session(s, SessionState::Failed);
+                return false;
+            }
+            if (w > 0) {
+                s.sent += static_cast<uint64_t>(w);
+                p += w;
+                len -= static_cast<std::size_t>(w);
+            }
+            append(s, p, len, std::exchange(s.spare, nullptr));
+            watch(id, MTCP_EPOLLIN | MTCP_EPOLLOUT, MTCP_EPOLL_CTL_MOD);
+            return true;
+        }
+
+        // Behind a queue, still connecting, or large: reserve every chunk first so a dry pool has no side effects.
+        SendChunk* reserved = reserve(s, len);
+        if (!reserved && needs_chunks(s, len)) [[unlikely]] {
+            ++s.refused;
+            return false;
+        }
+        const bool was_empty = !s.head;
+        append(s, p, len, reserved);
+        if (s.state == SessionState::Connected && was_empty) flush(id);
+        return true;
+    }
+
+    // Wait up to timeout_ms for events and handle them. on_read(SessionId, const char*, std::size_t) is called
+    // for every chunk of bytes received. Returns the number of events handled, or -1 on epoll failure.
+    template <class OnRead>
+    int poll(int timeout_ms, OnRead&& on_read) {
+        const int n = mtcp_epoll_wait(mctx_, ep_, events_.data(), opt_.max_events, timeout_ms);
+        for (int i = 0; i < n; ++i) {
+            const auto id = static_cast<SessionId>(events_[static_cast<std::size_t>(i)].data.u64);
+            const uint32_t ev = events_[static_cast<std::size_t>(i)].events;
+            Session& s = sessions_[id];
+
+            if (s.state == SessionState::Connecting) {
+                if (!(ev & (MTCP_EPOLLOUT | MTCP_EPOLLERR | MTCP_EPOLLHUP))) continue;
+                int err = 0;
+                socklen_t elen = sizeof(err);
+                if (mtcp_getsockopt(mctx_, s.sock, SOL_SOCKET, SO_ERROR, &err, &elen) < 0) err = errno;
+                if (err || (ev & MTCP_EPOLLERR)) {
+                    HFT_LOG("session {} connect failed err={}", id, err);
+                    close_session(s, SessionState::Failed);
+                    continue;
+                }
+                s.state = SessionState::Connected;
+                HFT_LOG("session {} connected, {} bytes queued", id, s.queued);
+                flush(id);
+                continue;
+            }
+            if (s.state != SessionState::Connected) continue;
+
+            if (ev & MTCP_EPOLLIN) {
+                for (;;) {
+                    const int r = mtcp_read(mctx_, s.sock, s.rx.get(), RX_BYTES);
+                    if (r > 0) {
+                        on_read(id, static_cast<const char*>(s.rx.get()), static_cast<std::size_t>(r));
+                        if (static_cast<std::size_t>(r) < RX_BYTES) break;
+                        continue;
+                    }
+                    if (r == 0) close_session(s, SessionState::Closed);              // peer closed
+                    else if (errno != EAGAIN) close_session(s, SessionState::Failed);
+                    break;
+                }
+                if (s.state != SessionState::Connected) continue;
+            }
+            if (ev & (MTCP_EPOLLERR | MTCP_EPOLLHUP)) {
+                close_session(s, SessionState::Failed);
+                continue;
+            }
+            if (ev & MTCP_EPOLLOUT) flush(id);
+        }
+        return n;
+    }
+
+    void close(SessionId id) { close_session(sessions_[id], SessionState::Closed); }
+
+    SessionState state(SessionId id) const noexcept { return sessions_[id].state; }
+    std::size_t queued_bytes(SessionId id) const noexcept { return sessions_[id].queued; }
+    uint64_t sent_bytes(SessionId id) const noexcept { return sessions_[id].sent; }
+    uint64_t refused(SessionId id) const noexcept { return sessions_[id].refused; }
+    std::size_t size() const noexcept { return sessions_.size(); }
+    mctx_t context() const noexcept { return mctx_; }
+
+private:
+    static constexpr std::size_t CHUNK_BYTES = sizeof(SendChunk::data);
+
+    struct Session {
+        int sock = -1;
+        SessionState state = SessionState::Closed;
+        uint32_t interest = 0;
+        SendChunk* head = nullptr;
+        SendChunk* tail = nullptr;
+        SendChunk* spare = nullptr;      // keeps a short direct write queueable
+        std::size_t queued = 0;
+        uint64_t sent = 0;
+        uint64_t refused = 0;
+        sockaddr_in addr{};
+        std::unique_ptr<char[]> rx = std::make_unique<char[]>(RX_BYTES);
+    };
+
+    bool watch(SessionId id, uint32_t events, int op) noexcept {
+        Session& s = sessions_[id];
+        if (op == MTCP_EPOLL_CTL_MOD && s.interest == events) return true;
+        mtcp_epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = id;
+        if (mtcp_epoll_ctl(mctx_, ep_, op, s.sock, &ev) < 0) {
+            close_session(s, SessionState::Failed);
+            return false;
+        }
+        s.interest = events;
+        return true;
+    }
+
+    // Write queued chunks until the socket stops taking bytes; drop EPOLLOUT interest once empty.
+    void flush(SessionId id) noexcept {
+        Session& s = sessions_[id];
+        while (SendChunk* c = s.head) {
+            const int w = mtcp_write(mctx_, s.sock, c->data + c->off, c->len - c->off);
+            if (w <= 0) {
+                if (w < 0 && errno != EAGAIN) {
+                    close_session(s, SessionState::Failed);
+                    return;
+                }
+                break;
+            }
+            c->off += static_cast<uint32_t>(w);
+            s.queued -= static_cast<std::size_t>(w);
+            s.sent += static_cast<uint64_t>(w);
+            if (c->off < c->len) break;        // short write: socket buffer is full
+            s.head = c->next;
+            if (!s.head) s.tail = nullptr;
+            chunks_.deallocate(c);
+        }
+        watch(id, MTCP_EPOLLIN | (s.head ? MTCP_EPOLLOUT : 0u), MTCP_EPOLL_CTL_MOD);
+    }
+
+    std::size_t tail_room(const Session& s) const noexcept { return s.tail ? CHUNK_BYTES - s.tail->len : 0; }
+    bool needs_chunks(const Session& s, std::size_t len) const noexcept { return len > tail_room(s); }
+
+    // New chunks len bytes would need beyond the tail's free space, linked through next. nullptr if none are
+    // needed, or if the pool cannot supply all of them (then nothing is kept).
+    SendChunk* reserve(const Session& s, std::size_t len) noexcept {
+        const std::size_t room = tail_room(s);
+        if (len <= room) return nullptr;
+        SendChunk* list = nullptr;
+        for (std::size_t need = (len - room + CHUNK_BYTES - 1) / CHUNK_BYTES; need; --need) {
+            SendChunk* c = chunks_.allocate();
+            if (!c) {
+                release(list);
+                return nullptr;
+            }
+            c->next = list;
+            list = c;
+        }
+        return list;
+    }
+
+    void release(SendChunk* list) noexcept {
+        while (list) {
+            SendChunk* next = list->next;
+            chunks_.deallocate(list);
+            list = next;
+        }
+    }
+
+    // Copy into the tail's free space, then into the reserved chunks; any reserved chunk left over is returned.
+    void append(Session& s, const char* p, std::size_t len, SendChunk* reserved) noexcept {
+        s.queued += len;
+        if (const std::size_t room = tail_room(s); room) {
+            const std::size_t n = std::min(room, len);
+            std::memcpy(s.tail->data + s.tail->len, p, n);
+            s.tail->len += static_cast<uint32_t>(n);
+            p += n;
+            len -= n;
+        }
+        while (len) {
+            SendChunk* c = reserved;
+            reserved = c->next;
+            c->next = nullptr;
+            const std::size_t n = std::min(CHUNK_BYTES, len);
+            std::memcpy(c->data, p, n);
+            c->len = static_cast<uint32_t>(n);
+            c->off = 0;
+            p += n;
+            len -= n;
+            if (s.tail) s.tail->next = c;
+            else s.head = c;
+            s.tail = c;
+        }
+        release(reserved);
+    }
+
+    void close_session(Session& s, SessionState why) noexcept {
+        if (s.sock >= 0) {
+            mtcp_epoll_event ev{};
+            mtcp_epoll_ctl(mctx_, ep_, MTCP_EPOLL_CTL_DEL, s.sock, &ev);
+            mtcp_close(mctx_, s.sock);
+            s.sock = -1;
         }
+        release(s.head);
+        release(std::exchange(s.spare, nullptr));
+        s.head = s.tail = nullptr;
+        s.queued = 0;
+        s.interest = 0;
+        s.state = why;
     }
+
+    GatewayOptions opt_;
+    NumaArena arena_;
+    FixedPool<SendChunk> chunks_;
+    mctx_t mctx_{nullptr};
+    int ep_{-1};
+    std::vector<mtcp_epoll_event> events_;
+    std::vector<Session> sessions_;
 };
 
-MTCP_OG_TEST()
+int MTCP_OG_TEST()
 {
     // Initialize mTCP globally
     if (mtcp_init("mtcp.conf"))
@@ -71,8 +577,8 @@ MTCP_OG_TEST()
         OrderGateway gw(0); // core 0
         gw.connect_to("127.0.0.1", 9000);
 
-        Order o1{1, 1001, 101.25, 50, 'B'};
-        Order o2{2, 1002, 99.75, 75, 'S'};
+        Order o1{1, 1001, 101.25_px, 50, 'B'};
+        Order o2{2, 1002, 99.75_px, 75, 'S'};
 
         gw.send_order(o1);
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -80,4 +586,40 @@ MTCP_OG_TEST()
     }
 
     mtcp_destroy();
+    return 0;
+}
+
+// `sessions` sessions to an echo server at ip:port; each sends a burst of orders (queued while connecting),
+// and the test waits until every byte has come back. Returns "sent=N echoed=N".
+std::string MTCP_MUX_Test(const std::string& ip, uint16_t port, int sessions)
+{
+    if (mtcp_init("mtcp.conf"))
+    {
+        return "mtcp_init failed";
+    }
+    std::stringstream ss;
+    {
+        constexpr int ORDERS = 100;
+        MultiSessionGateway gw;
+        std::vector<std::size_t> echoed(static_cast<std::size_t>(sessions), 0);
+        for (int i = 0; i < sessions; ++i) {
+            const auto id = gw.add_session(ip, port);
+            for (int k = 0; k < ORDERS; ++k) {
+                Order o{static_cast<uint64_t>(i * ORDERS + k), 1001, 101.25_px, 50, 'B'};
+                gw.send(id, &o, sizeof(o));
+            }
+        }
+        const std::size_t want = ORDERS * sizeof(Order);
+        int sent = 0, done = 0;
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (done < sessions && std::chrono::steady_clock::now() < until) {
+            gw.poll(10, [&](MultiSessionGateway::SessionId id, const char*, std::size_t n) {
+                if ((echoed[id] += n) == want) ++done;
+            });
+        }
+        for (int i = 0; i < sessions; ++i) sent += gw.sent_bytes(static_cast<uint32_t>(i)) == want;
+        ss << "sent=" << sent << " echoed=" << done;
+    }
+    mtcp_destroy();
+    return ss.str();
 }
@@ -0,0 +1,375 @@
+/*
+        Design notes
+
+        Per-core sharded gateway
+
+        One MultiSessionGateway tops out at what one core can push through one mTCP context. mTCP is built to scale
+        the other way: one context per core, each with its own NIC queue and TCP stack, nothing shared between them.
+        ShardedGateway does exactly that and keeps the strategies unaware of it:
+
+        - one shard per configured core. Each shard is a HotThread pinned to its core; the thread itself affinitizes
+          and creates the mTCP context (through MultiSessionGateway), adds its sessions and then busy-polls. mtcp.conf
+          num_cores must cover every core used.
+        - sessions are assigned to shards once, at construction: round robin, or pinned to a shard explicitly. The
+          assignment never changes, and only the owning shard's thread ever calls into a session - connect, send,
+          read and close all happen there. No session state is shared between cores, so nothing needs a lock.
+        - strategies submit(session, bytes) from any thread. The message is copied into a slot of the owning shard's
+          multi-producer DisruptorRing (one CAS to claim, one release store to publish) and the shard's loop hands it
+          to MultiSessionGateway::send(). A full queue makes submit() return false; it never blocks a strategy.
+        - reads are delivered on the owning shard's thread, to a callback shared by all shards: it must tolerate
+          being called from several shards at once (for different sessions).
+        - per-shard counters are atomics on their own cache lines, so monitors read them without touching a session.
+        - stop() drains what was already submitted, lingers until the sockets took the queued bytes (bounded by
+          drain_timeout), then joins the shards.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <optional>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "custom-allocator.h"
+#include "disruptor-ring.h"
+#include "hot-thread.h"
+#include "mtcp-ordergateway-handler.h"
+
+struct ShardedSession {
+    std::string ip;
+    uint16_t port = 0;
+    int shard = -1;                     // -1: round robin over the shards
+};
+
+struct ShardedGatewayOptions {
+    std::vector<int> cores{0};          // one shard (thread + mTCP context) per entry
+    GatewayOptions gateway;             // per shard; core_id is taken from cores
+    HotThreadConfig thread;             // per shard; name and cpu are taken from cores
+    std::chrono::milliseconds drain_timeout{100};
+};
+
+// One submitted message, as it sits in a shard's queue.
+struct CACHE_ALIGNED OutboundMsg {
+    uint32_t session;                   // shard-local id
+    uint32_t len;
+    char data[256 - 2 * sizeof(uint32_t)];
+};
+
+struct ShardStats {
+    int core = -1;
+    std::size_t sessions = 0;
+    uint64_t connected = 0;             // sessions Connected as of the shard's last event
+    uint64_t sent = 0;                  // messages handed to the socket (or its send queue)
+    uint64_t refused = 0;               // messages MultiSessionGateway::send() refused
+    uint64_t queue_full = 0;            // submit() calls rejected because the shard's queue was full
+};
+
+template <class OnRead>
+class ShardedGateway {
+public:
+    using SessionId = uint32_t;         // index into the sessions given at construction
+    static constexpr std::size_t QUEUE_DEPTH = 4096;
+    static constexpr std::size_t MAX_MSG = sizeof(OutboundMsg::data);
+    using Queue = DisruptorRing<OutboundMsg, QUEUE_DEPTH, ProducerMode::Multi>;
+
+    // mtcp_init() must have been called. Starts every shard and waits until each has its context and sessions;
+    // throws if any shard cannot start (the others are stopped first).
+    ShardedGateway(ShardedGatewayOptions opt, std::vector<ShardedSession> sessions, OnRead on_read)
+    : opt_(std::move(opt)), sessions_(std::move(sessions)), on_read_(std::move(on_read))
+    {
+        if (opt_.cores.empty()) throw std::runtime_error("ShardedGateway: no cores");
+        mtcp_conf conf{};
+        if (mtcp_getconf(&conf) == 0) {
+            for (int c : opt_.cores) {
+                if (c < 0 || c >= conf.num_cores)
+                    throw std::runtime_error("ShardedGateway: core " + std::to_string(c) + " is beyond mtcp.conf num_cores");
+            }
+        }
+
+        for (int core : opt_.cores) shards_.push_back(std::make_unique<Shard>(core));
+        for (std::size_t i = 0; i < sessions_.size(); ++i) {
+            const int want = sessions_[i].shard;
+            if (want >= static_cast<int>(shards_.size())) throw std::runtime_error("ShardedGateway: no shard " + std::to_string(want));
+            const auto s = static_cast<uint32_t>(want >= 0 ? static_cast<std::size_t>(want) : i % shards_.size());
+            routes_.push_back(Route{s, static_cast<uint32_t>(shards_[s]->global.size())});
+            shards_[s]->global.push_back(static_cast<SessionId>(i));
+        }
+
+        try {
+            for (std::size_t s = 0; s < shards_.size(); ++s) start(s);
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ShardedGateway(const ShardedGateway&) = delete;
+    ShardedGateway& operator=(const ShardedGateway&) = delete;
+
+    ~ShardedGateway() { stop(); }
+
+    // Hot path, any thread. Copies the message into the owning shard's queue. False if it is too large, the
+    // gateway is stopping, or the queue is full; the session itself is never touched here.
+    bool submit(SessionId id, const void* data, std::size_t len) noexcept {
+        if (len > MAX_MSG || stopping_.load(std::memory_order_relaxed)) [[unlikely]] return false;
+        const Route r = routes_[id];
+        Shard& sh = *shards_[r.shard];
+        const int64_t seq = sh.queue.try_claim();
+        if (seq < 0) [[unlikely]] {
+            sh.queue_full.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        OutboundMsg& m = sh.queue[seq];
+        m.session = r.local;
+        m.len = static_cast<uint32_t>(len);
+        std::memcpy(m.data, data, len);
+        sh.queue.publish(seq);
+        return true;
+    }
+
+    // Drain the queues, let the sockets take what is queued (up to drain_timeout), close and join. Idempotent.
+    void stop() {
+        stopping_.store(true, std::memory_order_relaxed);
+        for (auto& sh : shards_) sh->stop.store(true, std::memory_order_release);
+        for (auto& sh : shards_) sh->thread.reset();
+    }
+
+    std::size_t shards() const noexcept { return shards_.size(); }
+    std::size_t shard_of(SessionId id) const noexcept { return routes_[id].shard; }
+    int core_of(SessionId id) const noexcept { return shards_[routes_[id].shard]->core; }
+
+    // Monitor view; safe from any thread.
+    ShardStats stats(std::size_t shard) const noexcept {
+        const Shard& sh = *shards_[shard];
+        return ShardStats{sh.core, sh.global.size(), sh.connected.load(std::memory_order_relaxed),
+                          sh.sent.load(std::memory_order_relaxed), sh.refused.load(std::memory_order_relaxed),
+                          sh.queue_full.load(std::memory_order_relaxed)};
+    }
+
+private:
+    struct Route {
+        uint32_t shard;
+        uint32_t local;
+    };
+
+    struct Shard {
+        explicit Shard(int c)
+        : core(c),
+          arena(Queue::bytes_needed(), numa_available() >= 0 ? numa_node_of_cpu(c) : 0),
+          queue(arena)
+        {
+            queue.add_gating(consumed);
+        }
+
+        int core;
+        std::vector<SessionId> global;                  // local id -> SessionId
+        NumaArena arena;
+        Queue queue;
+        Sequence consumed;                              // last slot handed to the gateway
+        CACHE_ALIGNED std::atomic<uint64_t> sent{0};    // shard thread only writes these three
+        std::atomic<uint64_t> refused{0};
+        std::atomic<uint64_t> connected{0};
+        CACHE_ALIGNED std::atomic<uint64_t> queue_full{0};   // producers
+        std::atomic<bool> stop{false};
+        std::promise<std::string> ready;                // start-up result, set by the shard's thread
+        std::unique_ptr<HotThread> thread;
+    };
+
+    void start(std::size_t s) {
+        Shard& sh = *shards_[s];
+        HotThreadConfig cfg = opt_.thread;
+        cfg.cpu = sh.core;
+        cfg.name = "gw-shard-" + std::to_string(s);
+        auto up = sh.ready.get_future();
+        sh.thread = std::make_unique<HotThread>(cfg, [this, &sh] { run(sh); });
+        if (const std::string err = up.get(); !err.empty())
+            throw std::runtime_error("ShardedGateway shard " + std::to_string(s) + ": " + err);
+    }
+
+    // The shard's thread: everything that touches its sessions happens here.
+    void run(Shard& sh) {
+        std::optional<MultiSessionGateway> gw;
+        try {
+            GatewayOptions g = opt_.gateway;
+            g.core_id = sh.core;
+            gw.emplace(g);
+            for (SessionId id : sh.global) gw->add_session(sessions_[id].ip, sessions_[id].port);
+        } catch (const std::exception& e) {
+            sh.ready.set_value(e.what());
+            return;
+        }
+        sh.ready.set_value({});
+
+        auto barrier = sh.queue.barrier();
+        auto drain = [&] {
+            barrier.poll(sh.consumed, [&](OutboundMsg& m, int64_t) {
+                if (gw->send(m.session, m.data, m.len)) sh.sent.store(sh.sent.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                else sh.refused.store(sh.refused.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            });
+        };
+        auto deliver = [&](MultiSessionGateway::SessionId local, const char* p, std::size_t n) {
+            on_read_(sh.global[local], p, n);
+        };
+        auto pump = [&] {
+            drain();
+            if (gw->poll(0, deliver) > 0) {
+                uint64_t up = 0;
+                for (MultiSessionGateway::SessionId i = 0; i < gw->size(); ++i) up += gw->state(i) == SessionState::Connected;
+                sh.connected.store(up, std::memory_order_relaxed);
+            }
+        };
+
+        while (!sh.stop.load(std::memory_order_acquire)) pump();
+
+        // Producers are fenced off by stopping_; hand over what they already published and let it reach the wire.
+        const auto until = std::chrono::steady_clock::now() + opt_.drain_timeout;
+        for (;;) {
+            pump();
+            std::size_t queued = 0;
+            for (MultiSessionGateway::SessionId i = 0; i < gw->size(); ++i) queued += gw->queued_bytes(i);
+            if (!queued || std::chrono::steady_clock::now() >= until) break;
+        }
+    }
+
+    ShardedGatewayOptions opt_;
+    std::vector<ShardedSession> sessions_;
+    OnRead on_read_;
+    std::vector<Route> routes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> stopping_{false};
+};
+
+// Up to two shards on the allowed cpus mtcp.conf has contexts for, `sessions` sessions to an echo server at ip:port spread over them, and
+// two strategy threads submitting orders for every session at once. Every echoed byte must be read on the core
+// its session is assigned to. Returns "sessions=N echoed=N owner-only=1".
+std::string MTCP_SHARD_Test(const std::string& ip, uint16_t port, int sessions)
+{
+    if (mtcp_init("mtcp.conf"))
+    {
+        return "mtcp_init failed";
+    }
+    std::stringstream ss;
+    {
+        constexpr int ORDERS = 100;
+        constexpr int STRATEGIES = 2;
+        const std::size_t want = ORDERS * sizeof(Order);
+
+        ShardedGatewayOptions opt;
+        opt.cores.clear();
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        mtcp_conf conf{};
+        conf.num_cores = 1;
+        mtcp_getconf(&conf);
+        for (int c = 0; c < std::min(conf.num_cores, CPU_SETSIZE) && opt.cores.size() < 2; ++c) {
+            if (CPU_ISSET(c, &allowed)) opt.cores.push_back(c);
+        }
+        opt.thread.require_isolated = false;
+        opt.thread.require_realtime = false;
+        opt.thread.rt_priority = 0;
+
+        std::vector<ShardedSession> list;
+        for (int i = 0; i < sessions; ++i) list.push_back({ip, port});
+
+        struct Seen {
+            std::atomic<std::size_t> bytes{0};
+            std::atomic<int> wrong_core{0};
+        };
+        std::unique_ptr<Seen[]> seen(new Seen[static_cast<std::size_t>(sessions)]);
+        std::vector<int> home(static_cast<std::size_t>(sessions));
+
+        ShardedGateway gw(opt, list, [&](uint32_t id, const char*, std::size_t n) {
+            if (sched_getcpu() != home[id]) seen[id].wrong_core.fetch_add(1, std::memory_order_relaxed);
+            seen[id].bytes.fetch_add(n, std::memory_order_relaxed);
+        });
+        for (int i = 0; i < sessions; ++i) home[static_cast<std::size_t>(i)] = gw.core_of(static_cast<uint32_t>(i));
+
+        // Each strategy sends every other order of every session; they interleave on the shard queues.
+        std::vector<std::thread> strategies;
+        for (int t = 0; t < STRATEGIES; ++t) {
+            strategies.emplace_back([&, t] {
+                for (int k = t; k < ORDERS; k += STRATEGIES) {
+                    for (int i = 0; i < sessions; ++i) {
+                        Order o{static_cast<uint64_t>(i * ORDERS + k), 1001, 101.25_px, 50, 'B'};
+                        while (!gw.submit(static_cast<uint32_t>(i), &o, sizeof(o))) std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : strategies) t.join();
+
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        auto echoed = [&] {
+            int done = 0;
+            for (int i = 0; i < sessions; ++i) done += seen[i].bytes.load() == want;
+            return done;
+        };
+        while (echoed() < sessions && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        gw.stop();
+
+        int wrong = 0;
+        for (int i = 0; i < sessions; ++i) wrong += seen[i].wrong_core.load();
+        ss << "sessions=" << sessions << " echoed=" << echoed() << " owner-only=" << (wrong == 0);
+    }
+    mtcp_destroy();
+    return ss.str();
+}
+
+// Orders/sec through 1..cores shards, two sessions per shard to an echo server at ip:port, one submitting thread
+// per shard. Each round is timed from the first submit until every order has been echoed.
+void MTCP_SHARD_BENCH(const std::string& ip, uint16_t port, const std::vector<int>& cores)
+{
+    if (mtcp_init("mtcp.conf"))
+    {
+        std::cout << "MTCP_SHARD_BENCH: mtcp_init failed\n";
+        return;
+    }
+    constexpr int ORDERS = 200'000;     // per session
+    for (std::size_t n = 1; n <= cores.size(); ++n) {
+        ShardedGatewayOptions opt;
+        opt.cores.assign(cores.begin(), cores.begin() + static_cast<std::ptrdiff_t>(n));
+        opt.thread.require_isolated = false;
+        opt.thread.require_realtime = false;
+        const int sessions = static_cast<int>(2 * n);
+        std::vector<ShardedSession> list;
+        for (int i = 0; i < sessions; ++i) list.push_back({ip, port, i % static_cast<int>(n)});
+
+        std::atomic<uint64_t> echoed{0};
+        ShardedGateway gw(opt, list, [&](uint32_t, const char*, std::size_t b) {
+            echoed.fetch_add(b, std::memory_order_relaxed);
+        });
+        const uint64_t want = static_cast<uint64_t>(sessions) * ORDERS * sizeof(Order);
+
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> producers;
+        for (std::size_t s = 0; s < n; ++s) {
+            producers.emplace_back([&, s] {
+                for (int k = 0; k < ORDERS; ++k) {
+                    for (int i = static_cast<int>(s); i < sessions; i += static_cast<int>(n)) {
+                        Order o{static_cast<uint64_t>(k), 1001, 101.25_px, 50, 'B'};
+                        while (!gw.submit(static_cast<uint32_t>(i), &o, sizeof(o))) _mm_pause();
+                    }
+                }
+            });
+        }
+        for (auto& t : producers) t.join();
+        const auto until = t0 + std::chrono::seconds(30);
+        while (echoed.load(std::memory_order_relaxed) < want && std::chrono::steady_clock::now() < until)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "MTCP_SHARD_BENCH shards=" << n << ": " << static_cast<uint64_t>(echoed.load() / sizeof(Order) / secs)
+                  << " orders/s\n";
+    }
+    mtcp_destroy();
+}
@@ -0,0 +1,397 @@
+/*
+        Design notes
+
+        Open-loop order load generator
+
+        Drives new/amend/cancel traffic at a fixed offered rate through a gateway and reads back how long the
+        exchange took to acknowledge each message, to see where the order path saturates.
+
+        - open loop: message k is due at start + k / rate, whatever happened to message k-1. If the generator
+          falls behind (the gateway, the socket or the exchange pushed back) it sends the overdue messages back
+          to back instead of quietly offering less load.
+        - coordinated omission: latency is measured from when a message was due, not from when it was finally
+          written. The due time is handed to the gateway as send_tsc, so the OrderTracker's send->ack and
+          amend->ack histograms are corrected with no extra bookkeeping. How far behind each send was goes into
+          its own lag histogram; a lag that keeps growing means the offered rate is past what the path sustains.
+        - the mix is drawn per message: amend or cancel one of our live acked orders (any live order for a
+          cancel), otherwise a new order. Prices stay a few ticks away from mid on each side so nothing trades
+          and every message gets exactly one answer. Above max_open live orders every message is a cancel.
+        - throughput is answers (acks, amend acks, cancels, rejects) over the time from the first send to the
+          last answer, so a backlog drained after the send window counts against it.
+        - sweep() runs one step per offered rate, each on a fresh session, and knee() names the first step that
+          did not keep up: answers below 95% of offered, or median latency above 10x the first step's (the
+          median, not a tail percentile: on a shared core the tail is scheduler noise even at low rates).
+        - the gateway is a template parameter: anything with send_order(o, send_tsc), amend(id, new_id, px, qty,
+          send_tsc), cancel(id), poll_reports() and tracker(). OrderGateway (mTCP) is one; KernelOrderSession is
+          the same over kernel TCP, for boxes without mTCP and for the test.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "exchange-sim.h"
+#include "latency-histogram.h"
+#include "order-tracker.h"
+#include "order-wire.h"
+#include "tsc-clock.h"
+
+// ---------- kernel TCP session ----------
+// One order entry session over a kernel socket with the same order API as OrderGateway (no risk, no throttle).
+// Writes that the socket does not take are kept and flushed, in order, by later writes and poll_reports().
+class KernelOrderSession {
+public:
+    explicit KernelOrderSession(std::size_t max_open = 64 * 1024, int numa_node = 0) : tracker_(max_open, numa_node) {}
+
+    KernelOrderSession(const KernelOrderSession&) = delete;
+    KernelOrderSession& operator=(const KernelOrderSession&) = delete;
+
+    ~KernelOrderSession() {
+        if (sock_ >= 0) close(sock_);
+    }
+
+    void connect_to(const std::string& ip, uint16_t port) {
+        sock_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock_ < 0) throw std::runtime_error("socket creation failed");
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+        if (connect(sock_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw std::runtime_error("connect to " + ip + ":" + std::to_string(port) + " failed");
+        int one = 1;
+        setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        set_nonblocking();
+    }
+
+    bool send_order(const Order& o, uint64_t send_tsc = TscClock::now_tsc()) {
+        if (!tracker_.on_send(o, send_tsc)) [[unlikely]] return false;
+        const NewOrderMsg msg{NewOrderType, o};
+        if (!write(&msg, sizeof(msg))) [[unlikely]] {
+            tracker_.forget(o.order_id);
+            return false;
+        }
+        return true;
+    }
+
+    bool amend(uint64_t order_id, uint64_t new_order_id, Price px, uint32_t qty, uint64_t send_tsc = TscClock::now_tsc()) {
+        OpenOrder* o = tracker_.on_replace(order_id, new_order_id, px, qty, send_tsc);
+        if (!o) [[unlikely]] return false;
+        if (!write(&o->replace, sizeof(ReplaceMsg))) [[unlikely]] {
+            tracker_.forget_replace(o);
+            return false;
+        }
+        return true;
+    }
+
+    bool cancel(uint64_t order_id) {
+        OpenOrder* o = tracker_.on_cancel(order_id);
+        if (!o) [[unlikely]] return false;
+        if (!write(&o->cancel, sizeof(CancelMsg))) [[unlikely]] {
+            tracker_.forget_cancel(o);
+            return false;
+        }
+        return true;
+    }
+
+    // Flush what is pending and apply whatever the exchange sent. Never blocks. Reports applied, -1 if the session
+    // is gone.
+    int poll_reports() {
+        if (!flush()) return -1;
+        int reports = 0;
+        for (;;) {
+            const ssize_t r = recv(sock_, rx_, sizeof(rx_), 0);
+            if (r > 0) {
+                reports += static_cast<int>(tracker_.on_bytes(rx_, static_cast<std::size_t>(r)));
+                if (static_cast<std::size_t>(r) < sizeof(rx_)) return reports;
+                continue;
+            }
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return reports;
+            if (r < 0 && errno == EINTR) continue;
+            return -1;
+        }
+    }
+
+    const OrderTracker& tracker() const noexcept { return tracker_; }
+    std::size_t pending_bytes() const noexcept { return out_.size() - out_off_; }
+
+private:
+    void set_nonblocking() {
+        const int fl = fcntl(sock_, F_GETFL, 0);
+        fcntl(sock_, F_SETFL, fl | O_NONBLOCK);
+    }
+
+    // False only if the session is broken; bytes the socket does not take now are queued.
+    bool write(const void* p, std::size_t n) {
+        if (out_off_ == out_.size()) {
+            out_.clear();
+            out_off_ = 0;
+            const ssize_t w = ::send(sock_, p, n, MSG_NOSIGNAL);
+            if (w == static_cast<ssize_t>(n)) [[likely]] return true;
+            if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+            const std::size_t took = w > 0 ? static_cast<std::size_t>(w) : 0;
+            out_.append(static_cast<const char*>(p) + took, n - took);
+            return true;
+        }
+        out_.append(static_cast<const char*>(p), n);
+        return flush();
+    }
+
+    bool flush() {
+        while (out_off_ < out_.size()) {
+            const ssize_t w = ::send(sock_, out_.data() + out_off_, out_.size() - out_off_, MSG_NOSIGNAL);
+            if (w < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            out_off_ += static_cast<std::size_t>(w);
+        }
+        return true;
+    }
+
+    int sock_{-1};
+    OrderTracker tracker_;
+    std::string out_;
+    std::size_t out_off_{0};
+    char rx_[4096];
+};
+
+// ---------- load generator ----------
+struct LoadGenOptions {
+    double rate = 100000;               // messages per second offered
+    double seconds = 1.0;               // send window
+    double drain_seconds = 1.0;         // max wait for outstanding answers after the window
+    uint32_t amend_pct = 20;
+    uint32_t cancel_pct = 30;
+    std::size_t max_open = 4096;        // above this every message is a cancel
+    uint32_t instr_id = 1001;
+    Price mid = 100_px;
+    Price tick = 0.01_px;
+    uint64_t seed = 1;
+};
+
+struct LoadGenResult {
+    double offered = 0;                 // messages/s
+    double sent_rate = 0;               // messages/s actually written over the send window
+    double answer_rate = 0;             // answers/s, first send -> last answer
+    uint64_t new_orders = 0;
+    uint64_t amends = 0;
+    uint64_t cancels = 0;
+    uint64_t refused = 0;               // the gateway would not send it
+    uint64_t answered = 0;
+    uint64_t unanswered = 0;            // still outstanding when the drain gave up
+    LatencyHistogram ack_ns;            // due -> ack, new orders
+    LatencyHistogram amend_ns;          // due -> ack, amends
+    LatencyHistogram lag_ns;            // due -> written
+
+    std::string summary() const {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(0) << "offered=" << offered << "/s sent=" << sent_rate << "/s answered="
+           << answer_rate << "/s p50=" << ack_ns.percentile(50) << "ns p99=" << ack_ns.percentile(99) << "ns p99.9="
+           << ack_ns.percentile(99.9) << "ns max=" << ack_ns.max() << "ns lag-p99=" << lag_ns.percentile(99)
+           << "ns unanswered=" << unanswered;
+        return ss.str();
+    }
+};
+
+namespace load_detail {
+
+inline uint64_t answers(const OrderTrackerStats& s) noexcept {
+    return s.acked + s.replaced + s.replace_rejected + s.cancelled + s.cancel_rejected + s.rejected;
+}
+
+} // namespace load_detail
+
+// One step at opt.rate on a connected gateway. next_id is the first order id to use and is advanced past the
+// ones used, so steps on the same exchange never reuse ids.
+template <class Gateway>
+LoadGenResult run_load(Gateway& gw, const LoadGenOptions& opt, uint64_t& next_id)
+{
+    const TscClock& clock = TscClock::instance();
+    const double ticks_per_ns = clock.ticks_per_ns();
+    const auto total = static_cast<uint64_t>(opt.rate * opt.seconds);
+    const double period = ticks_per_ns * 1e9 / opt.rate;
+    std::mt19937_64 rng(opt.seed);
+    std::vector<uint64_t> live;         // our orders as the exchange knows them (amends swap the id in place)
+    live.reserve(opt.max_open * 2);
+
+    LoadGenResult res;
+    res.offered = opt.rate;
+    const uint64_t answered0 = load_detail::answers(gw.tracker().stats());
+    auto price = [&](char side) {
+        const Price away = opt.tick * (1 + static_cast<int64_t>(rng() % 10));
+        return side == 'B' ? opt.mid - away : opt.mid + away;
+    };
+    auto send_one = [&](uint64_t due) {
+        const uint32_t roll = static_cast<uint32_t>(rng() % 100);
+        const bool must_cancel = live.size() >= opt.max_open;
+        if (!live.empty() && (must_cancel || roll < opt.amend_pct + opt.cancel_pct)) {
+            const std::size_t i = rng() % live.size();
+            const OpenOrder* o = gw.tracker().find(live[i]);
+            if (!o || is_terminal(o->state)) {                      // gone (e.g. rejected): forget it, send a new one
+                live[i] = live.back();
+                live.pop_back();
+            } else if (!must_cancel && roll < opt.amend_pct) {
+                if (o->state == OrderState::Acked || o->state == OrderState::PartiallyFilled) {
+                    if (gw.amend(live[i], next_id, price(o->side), o->qty + 1, due)) {
+                        live[i] = next_id++;
+                        ++res.amends;
+                    } else {
+                        ++res.refused;
+                    }
+                    return;
+                }
+            } else if (o->state != OrderState::Replacing && o->state != OrderState::Cancelling) {
+                if (gw.cancel(live[i])) {
+                    live[i] = live.back();
+                    live.pop_back();
+                    ++res.cancels;
+                } else {
+                    ++res.refused;
+                }
+                return;
+            }
+        }
+        const char side = rng() & 1 ? 'B' : 'S';
+        const Order o{next_id, opt.instr_id, price(side), 1 + static_cast<uint32_t>(rng() % 100), side};
+        if (gw.send_order(o, due)) {
+            live.push_back(next_id);
+            ++res.new_orders;
+        } else {
+            ++res.refused;
+        }
+        ++next_id;
+    };
+
+    const uint64_t start = TscClock::now_tsc();
+    uint64_t last_answer = start;
+    uint64_t sent = 0;
+    while (sent < total) {
+        const uint64_t now = TscClock::now_tsc();
+        for (; sent < total; ++sent) {
+            const uint64_t due = start + static_cast<uint64_t>(static_cast<double>(sent) * period);
+            if (due > now) break;
+            send_one(due);
+            res.lag_ns.record(clock.ticks_to_ns(TscClock::now_tsc() - due));
+        }
+        if (gw.poll_reports() > 0) last_answer = TscClock::now_tsc();
+    }
+    const uint64_t window_end = TscClock::now_tsc();
+
+    const uint64_t want = res.new_orders + res.amends + res.cancels;
+    const uint64_t drain_until = window_end + static_cast<uint64_t>(opt.drain_seconds * 1e9 * ticks_per_ns);
+    while (load_detail::answers(gw.tracker().stats()) - answered0 < want && TscClock::now_tsc() < drain_until) {
+        if (gw.poll_reports() > 0) last_answer = TscClock::now_tsc();
+    }
+
+    res.answered = load_detail::answers(gw.tracker().stats()) - answered0;
+    res.unanswered = want > res.answered ? want - res.answered : 0;
+    res.sent_rate = static_cast<double>(want) * 1e9 / static_cast<double>(clock.ticks_to_ns(window_end - start));
+    res.answer_rate = static_cast<double>(res.answered) * 1e9 / static_cast<double>(clock.ticks_to_ns(std::max(last_answer - start, uint64_t{1})));
+    res.ack_ns = gw.tracker().ack_latency();
+    res.amend_ns = gw.tracker().amend_latency();
+    return res;
+}
+
+// One run_load step per rate, each on a fresh gateway from make_gateway() (a connected, heap-held Gateway).
+template <class MakeGateway>
+std::vector<LoadGenResult> sweep(MakeGateway&& make_gateway, const std::vector<double>& rates, LoadGenOptions opt)
+{
+    std::vector<LoadGenResult> steps;
+    uint64_t next_id = 1;
+    for (double rate : rates) {
+        auto gw = make_gateway();
+        opt.rate = rate;
+        steps.push_back(run_load(*gw, opt, next_id));
+        ++opt.seed;
+    }
+    return steps;
+}
+
+// First step that did not keep up (answers below 95% of offered, anything unanswered, or p50 above 10x the first
+// step's); steps.size() if all did.
+inline std::size_t knee(const std::vector<LoadGenResult>& steps)
+{
+    if (steps.empty()) return 0;
+    const uint64_t base_p50 = std::max<uint64_t>(steps.front().ack_ns.percentile(50), 1);
+    for (std::size_t i = 0; i < steps.size(); ++i) {
+        const LoadGenResult& s = steps[i];
+        if (s.answer_rate < 0.95 * s.offered || s.unanswered || s.ack_ns.percentile(50) > 10 * base_p50) return i;
+    }
+    return steps.size();
+}
+
+// Two short steps against an in-process ExchangeSim over kernel TCP: every message is sent on schedule and answered,
+// the mix is honoured, and each ack is measured from its due time.
+std::string ORDER_LOAD_GEN_Test()
+{
+    std::stringstream ss;
+    ExchangeSimOptions so;
+    so.port = 0;
+    so.feed_ip = "127.0.0.1";
+    so.feed_port = 9;                   // discard: nobody reads the feed here
+    ExchangeSim sim(so);
+    std::thread server([&] { sim.run(); });
+
+    LoadGenOptions opt;
+    opt.seconds = 0.2;
+    opt.drain_seconds = 2.0;
+    const auto steps = sweep([&] {
+        auto gw = std::make_unique<KernelOrderSession>(1 << 14);
+        gw->connect_to("127.0.0.1", sim.port());
+        return gw;
+    }, {2000, 10000}, opt);
+    sim.stop();
+    server.join();
+
+    bool scheduled = true, answered = true, mix = true, measured = true;
+    for (const LoadGenResult& s : steps) {
+        const uint64_t msgs = s.new_orders + s.amends + s.cancels;
+        scheduled &= msgs + s.refused == static_cast<uint64_t>(s.offered * opt.seconds);
+        answered &= !s.unanswered && s.answered == msgs;
+        mix &= s.amends > 0 && s.cancels > 0 && s.new_orders > s.cancels;
+        measured &= s.ack_ns.count() == s.new_orders && s.amend_ns.count() == s.amends && s.lag_ns.count() == msgs + s.refused;
+    }
+    ss << "steps=" << steps.size() << " scheduled=" << scheduled << " answered=" << answered << " mix=" << mix
+       << " measured=" << measured;
+    return ss.str();
+}
+
+// Offered rate sweep against an in-process ExchangeSim; prints one line per step and the knee.
+void ORDER_LOAD_GEN_BENCH()
+{
+    ExchangeSimOptions so;
+    so.port = 0;
+    so.feed_ip = "127.0.0.1";
+    so.feed_port = 9;
+    ExchangeSim sim(so);
+    std::thread server([&] { sim.run(); });
+    LoadGenOptions opt;
+    opt.seconds = 1.0;
+    const auto steps = sweep([&] {
+        auto gw = std::make_unique<KernelOrderSession>(1 << 16);
+        gw->connect_to("127.0.0.1", sim.port());
+        return gw;
+    }, {10000, 25000, 50000, 100000, 200000, 400000}, opt);
+    sim.stop();
+    server.join();
+    for (const LoadGenResult& s : steps) std::cout << "ORDER_LOAD_GEN_BENCH " << s.summary() << "\n";
+    const std::size_t k = knee(steps);
+    std::cout << "ORDER_LOAD_GEN_BENCH knee: "
+              << (k < steps.size() ? std::to_string(static_cast<uint64_t>(steps[k].offered)) + " msgs/s" : "not reached") << "\n";
+}
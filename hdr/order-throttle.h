@@ -0,0 +1,379 @@
+/*
+        Design notes
+
+        Exchange message-rate throttles
+
+        Exchanges cap messages per session (and often per instrument) and disconnect a session that breaches the
+        cap. We enforce the same limits on our side, before the wire, with two complementary rules per scope:
+
+        - TokenBucket: sustained rate plus burst, as GCRA (virtual scheduling). The whole state is one theoretical
+          arrival time in TSC ticks; a message is allowed when now >= tat - burst tolerance. One compare to check,
+          one max+add to consume, no division on the hot path.
+        - SlidingWindow: the exact "at most N messages in any window W" rule most exchanges actually state. A ring
+          of the last N send timestamps; a send is allowed when the oldest of them has left the window.
+        - RateLimiter applies both; OrderThrottle holds one for the session and one per instrument (unconfigured
+          instruments are unlimited), and admits an order only if both scopes allow it.
+        - the sending core is the only writer. State words are std::atomic but written with plain relaxed stores
+          (no lock prefix, no RMW), so monitors on other cores can read rates, tokens and counters without tearing
+          and without slowing the sender.
+        - ThrottleQueue turns "reject" into "delay": an order the throttle refuses waits in a bounded FIFO and
+          pump() releases it as soon as its limits allow, recording how long it waited. The FIFO keeps order across
+          instruments, so a blocked head holds back the orders behind it.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "latency-histogram.h"
+#include "tsc-clock.h"
+
+namespace throttle_detail {
+// Single-writer update: plain load + store, never a locked instruction.
+inline void bump(std::atomic<uint64_t>& a, uint64_t by = 1) noexcept {
+    a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+inline uint64_t to_ticks(std::chrono::nanoseconds d) noexcept {
+    return static_cast<uint64_t>(static_cast<double>(d.count()) * TscClock::instance().ticks_per_ns());
+}
+}
+
+// ---------- token bucket (GCRA) ----------
+class TokenBucket {
+public:
+    TokenBucket() = default;    // unlimited
+
+    TokenBucket(double rate_per_sec, uint32_t burst) { reset(rate_per_sec, burst); }
+
+    // Cold; rate 0 means unlimited.
+    void reset(double rate_per_sec, uint32_t burst) noexcept {
+        interval_ = rate_per_sec > 0
+            ? std::max<uint64_t>(1, throttle_detail::to_ticks(std::chrono::nanoseconds(static_cast<int64_t>(1e9 / rate_per_sec))))
+            : 0;
+        tolerance_ = interval_ * (std::max<uint32_t>(burst, 1) - 1);
+        tat_.store(0, std::memory_order_relaxed);
+    }
+
+    bool allowed(uint64_t now_tsc) const noexcept {
+        return now_tsc + tolerance_ >= tat_.load(std::memory_order_relaxed);
+    }
+
+    void consume(uint64_t now_tsc) noexcept {
+        tat_.store(std::max(tat_.load(std::memory_order_relaxed), now_tsc) + interval_, std::memory_order_relaxed);
+    }
+
+    // Earliest tsc at which allowed() holds again.
+    uint64_t next_allowed() const noexcept {
+        const uint64_t tat = tat_.load(std::memory_order_relaxed);
+        return tat > tolerance_ ? tat - tolerance_ : 0;
+    }
+
+    // Monitor view: whole tokens available at now_tsc. 0 while overdrawn: consume() without allowed() (cancels)
+    // can push tat past now + burst.
+    uint32_t tokens(uint64_t now_tsc) const noexcept {
+        if (!interval_) return std::numeric_limits<uint32_t>::max();
+        const uint64_t tat = std::max(tat_.load(std::memory_order_relaxed), now_tsc);
+        const uint64_t limit = now_tsc + tolerance_ + interval_;
+        return tat >= limit ? 0 : static_cast<uint32_t>((limit - tat) / interval_);
+    }
+
+    bool enabled() const noexcept { return interval_ != 0; }
+
+private:
+    uint64_t interval_ = 0;     // ticks per message
+    uint64_t tolerance_ = 0;    // (burst - 1) * interval
+    std::atomic<uint64_t> tat_{0};
+};
+
+// ---------- exact sliding window ----------
+class SlidingWindow {
+public:
+    SlidingWindow() = default;  // unlimited
+
+    SlidingWindow(uint32_t max_msgs, std::chrono::nanoseconds window) { reset(max_msgs, window); }
+
+    // Cold; max_msgs 0 means unlimited.
+    void reset(uint32_t max_msgs, std::chrono::nanoseconds window) {
+        n_ = max_msgs;
+        head_ = 0;
+        window_ = throttle_detail::to_ticks(window);
+        ring_ = max_msgs ? std::make_unique<std::atomic<uint64_t>[]>(max_msgs) : nullptr;
+        sent_.store(0, std::memory_order_relaxed);
+    }
+
+    bool allowed(uint64_t now_tsc) const noexcept {
+        return !n_ || sent_.load(std::memory_order_relaxed) < n_ ||
+               now_tsc - ring_[head_].load(std::memory_order_relaxed) >= window_;
+    }
+
+    void consume(uint64_t now_tsc) noexcept {
+        if (!n_) return;
+        ring_[head_].store(now_tsc, std::memory_order_relaxed);
+        head_ = head_ + 1 == n_ ? 0 : head_ + 1;
+        throttle_detail::bump(sent_);
+    }
+
+    // Earliest tsc at which allowed() holds again.
+    uint64_t next_allowed() const noexcept {
+        if (!n_ || sent_.load(std::memory_order_relaxed) < n_) return 0;
+        return ring_[head_].load(std::memory_order_relaxed) + window_;
+    }
+
+    // Monitor view: messages sent within the window ending at now_tsc. O(max_msgs).
+    uint32_t in_window(uint64_t now_tsc) const noexcept {
+        uint32_t c = 0;
+        const uint64_t sent = sent_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < std::min<uint64_t>(n_, sent); ++i)
+            c += now_tsc - ring_[i].load(std::memory_order_relaxed) < window_;
+        return c;
+    }
+
+    bool enabled() const noexcept { return n_ != 0; }
+
+private:
+    uint32_t n_ = 0;
+    uint32_t head_ = 0;         // oldest of the last n_ sends; sender only
+    uint64_t window_ = 0;
+    std::unique_ptr<std::atomic<uint64_t>[]> ring_;
+    std::atomic<uint64_t> sent_{0};
+};
+
+// ---------- one scope: bucket + window ----------
+struct ThrottleLimits {
+    double rate_per_sec = 0;                // 0: no token bucket
+    uint32_t burst = 1;
+    uint32_t window_msgs = 0;               // 0: no sliding window
+    std::chrono::nanoseconds window{std::chrono::seconds(1)};
+};
+
+class RateLimiter {
+public:
+    RateLimiter() = default;
+
+    // Cold: before the sender starts.
+    void configure(const ThrottleLimits& l) {
+        bucket_.reset(l.rate_per_sec, l.burst);
+        window_.reset(l.window_msgs, l.window);
+    }
+
+    bool allowed(uint64_t now_tsc) const noexcept { return bucket_.allowed(now_tsc) && window_.allowed(now_tsc); }
+    void consume(uint64_t now_tsc) noexcept {
+        bucket_.consume(now_tsc);
+        window_.consume(now_tsc);
+    }
+    uint64_t next_allowed() const noexcept { return std::max(bucket_.next_allowed(), window_.next_allowed()); }
+
+    const TokenBucket& bucket() const noexcept { return bucket_; }
+    const SlidingWindow& window() const noexcept { return window_; }
+
+private:
+    TokenBucket bucket_;
+    SlidingWindow window_;
+};
+
+// ---------- session + per-instrument throttle ----------
+struct ThrottleStats {
+    uint64_t admitted = 0;
+    uint64_t blocked = 0;           // admit() said no
+};
+
+class OrderThrottle {
+public:
+    explicit OrderThrottle(const ThrottleLimits& session, std::size_t max_instruments = 4096)
+    : max_instruments_(max_instruments), instruments_(std::make_unique<RateLimiter[]>(max_instruments)) {
+        session_.configure(session);
+    }
+
+    void configure_instrument(uint32_t instr_id, const ThrottleLimits& l) {
+        if (instr_id >= max_instruments_) throw std::runtime_error("OrderThrottle: instr_id out of range");
+        instruments_[instr_id].configure(l);
+    }
+
+    bool allowed(uint32_t instr_id, uint64_t now_tsc) const noexcept {
+        return session_.allowed(now_tsc) && (instr_id >= max_instruments_ || instruments_[instr_id].allowed(now_tsc));
+    }
+
+    void consume(uint32_t instr_id, uint64_t now_tsc) noexcept {
+        session_.consume(now_tsc);
+        if (instr_id < max_instruments_) instruments_[instr_id].consume(now_tsc);
+        throttle_detail::bump(admitted_);
+    }
+
+    // allowed() then consume(); counts a block otherwise.
+    bool admit(uint32_t instr_id, uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        if (allowed(instr_id, now_tsc)) [[likely]] {
+            consume(instr_id, now_tsc);
+            return true;
+        }
+        throttle_detail::bump(blocked_);
+        return false;
+    }
+
+    uint64_t next_allowed(uint32_t instr_id) const noexcept {
+        const uint64_t s = session_.next_allowed();
+        return instr_id < max_instruments_ ? std::max(s, instruments_[instr_id].next_allowed()) : s;
+    }
+
+    // Monitor views; any thread.
+    ThrottleStats stats() const noexcept {
+        return ThrottleStats{admitted_.load(std::memory_order_relaxed), blocked_.load(std::memory_order_relaxed)};
+    }
+    const RateLimiter& session() const noexcept { return session_; }
+    // Instruments beyond max_instruments are unlimited, as in allowed().
+    const RateLimiter& instrument(uint32_t instr_id) const noexcept {
+        return instr_id < max_instruments_ ? instruments_[instr_id] : unlimited_;
+    }
+
+private:
+    RateLimiter session_;
+    const RateLimiter unlimited_;
+    std::size_t max_instruments_;
+    std::unique_ptr<RateLimiter[]> instruments_;
+    std::atomic<uint64_t> admitted_{0};
+    std::atomic<uint64_t> blocked_{0};
+};
+
+// ---------- queue instead of reject ----------
+enum class ThrottleMode : uint8_t { Reject, Queue };
+
+template <class T, std::size_t N>
+class ThrottleQueue {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>);
+
+public:
+    // Sender only. False if the queue is full (the caller rejects after all).
+    bool push(const T& msg, uint32_t instr_id, uint64_t now_tsc) noexcept {
+        if (tail_ - head_ == N) [[unlikely]] {
+            throttle_detail::bump(full_);
+            return false;
+        }
+        slots_[tail_ & (N - 1)] = Entry{msg, instr_id, now_tsc};
+        ++tail_;
+        depth_.store(tail_ - head_, std::memory_order_relaxed);
+        max_depth_.store(std::max(max_depth_.load(std::memory_order_relaxed), tail_ - head_), std::memory_order_relaxed);
+        throttle_detail::bump(queued_);
+        return true;
+    }
+
+    // Release queued messages, oldest first, while the throttle admits them; send(const T&, uint64_t enq_tsc) each,
+    // with the tsc it was pushed at. Stops at the first one still throttled. Returns the number released.
+    template <class F>
+    std::size_t pump(OrderThrottle& t, F&& send, uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        std::size_t n = 0;
+        for (; head_ != tail_; ++head_, ++n) {
+            const Entry& e = slots_[head_ & (N - 1)];
+            if (!t.allowed(e.instr_id, now_tsc)) break;
+            t.consume(e.instr_id, now_tsc);
+            send(e.msg, e.enq_tsc);
+            delay_ns_.record(clock_.ticks_to_ns(now_tsc - e.enq_tsc));
+        }
+        if (n) depth_.store(tail_ - head_, std::memory_order_relaxed);
+        return n;
+    }
+
+    bool empty() const noexcept { return head_ == tail_; }
+
+    // Earliest tsc at which pump() can release the head; 0 if empty.
+    uint64_t next_release(const OrderThrottle& t) const noexcept {
+        return empty() ? 0 : t.next_allowed(slots_[head_ & (N - 1)].instr_id);
+    }
+
+    // Monitor views (any thread) ...
+    uint64_t depth() const noexcept { return depth_.load(std::memory_order_relaxed); }
+    uint64_t max_depth() const noexcept { return max_depth_.load(std::memory_order_relaxed); }
+    uint64_t queued() const noexcept { return queued_.load(std::memory_order_relaxed); }
+    uint64_t full() const noexcept { return full_.load(std::memory_order_relaxed); }
+    // ... and the sender's: time spent queued, in ns.
+    const LatencyHistogram& delay() const noexcept { return delay_ns_; }
+
+private:
+    struct Entry {
+        T msg;
+        uint32_t instr_id;
+        uint64_t enq_tsc;
+    };
+
+    Entry slots_[N];
+    uint64_t head_ = 0;
+    uint64_t tail_ = 0;
+    const TscClock& clock_ = TscClock::instance();
+    std::atomic<uint64_t> depth_{0};
+    std::atomic<uint64_t> max_depth_{0};
+    std::atomic<uint64_t> queued_{0};
+    std::atomic<uint64_t> full_{0};
+    LatencyHistogram delay_ns_;
+};
+
+// Drives the throttles with synthetic TSC timestamps, so the results do not depend on the machine's speed.
+std::string ORDER_THROTTLE_Test()
+{
+    using namespace std::chrono;
+    const auto tick = [](nanoseconds d) { return throttle_detail::to_ticks(d); };
+    const uint64_t t0 = tick(seconds(1000));
+    std::stringstream ss;
+
+    // Bucket: 1000/s with burst 5 -> 5 back to back, then one per ms.
+    TokenBucket b(1000, 5);
+    int burst = 0;
+    while (b.allowed(t0)) { b.consume(t0); ++burst; }
+    const bool refill = !b.allowed(t0 + tick(microseconds(900))) && b.allowed(t0 + tick(microseconds(1001)));
+    ss << "burst=" << burst << " refill=" << refill;
+
+    // Window: 3 per 10ms, exactly: the 4th waits until the 1st has left the window.
+    SlidingWindow w(3, milliseconds(10));
+    for (int i = 0; i < 3; ++i) w.consume(t0 + tick(milliseconds(i)));
+    const bool exact = !w.allowed(t0 + tick(microseconds(9999))) && w.allowed(t0 + tick(microseconds(10001)));
+    ss << " window=" << w.in_window(t0 + tick(milliseconds(5))) << " exact=" << exact;
+
+    // Session 100/s burst 2, instrument 7 at most 1 per 50ms; the rest unlimited.
+    OrderThrottle t(ThrottleLimits{100, 2, 0, {}}, 16);
+    t.configure_instrument(7, ThrottleLimits{0, 1, 1, milliseconds(50)});
+    std::string admits;
+    for (uint32_t instr : {7u, 7u, 3u, 3u}) admits += t.admit(instr, t0) ? '1' : '0';
+    ss << " admits=" << admits << " blocked=" << t.stats().blocked;
+
+    // Cancels consume without asking: 20 at once overdraw a burst of 5, and the bucket reads empty until it refills.
+    OrderThrottle c(ThrottleLimits{1000, 5, 0, {}}, 16);
+    for (int i = 0; i < 20; ++i) c.consume(3, t0);
+    const TokenBucket& cb = c.session().bucket();
+    ss << " overdrawn=" << cb.tokens(t0) << "/" << cb.tokens(t0 + tick(milliseconds(10))) << "/" << cb.tokens(t0 + tick(milliseconds(25)));
+
+    // Queue mode: five orders at once for instrument 3 drain at the session rate, 10ms apart.
+    OrderThrottle q(ThrottleLimits{100, 1, 0, {}}, 16);
+    ThrottleQueue<uint64_t, 8> fifo;
+    std::string out;
+    for (uint64_t id = 1; id <= 5; ++id) {
+        if (!q.admit(3, t0)) fifo.push(id, 3, t0);
+        else out += std::to_string(id);
+    }
+    const uint64_t depth = fifo.depth();
+    for (int ms = 1; ms <= 50 && !fifo.empty(); ++ms)
+        fifo.pump(q, [&](uint64_t id, uint64_t) { out += std::to_string(id); }, t0 + tick(milliseconds(ms)));
+    ss << " queued=" << depth << " order=" << out << " p100-delay-ms=" << (fifo.delay().max() + 500'000) / 1'000'000;
+    return ss.str();
+}
+
+// Cost of admit() with both rules on, per scope, at a rate that never blocks.
+void ORDER_THROTTLE_BENCH()
+{
+    constexpr int N = 10'000'000;
+    OrderThrottle t(ThrottleLimits{1e12, 1000, 1000, std::chrono::nanoseconds(1)}, 64);
+    for (uint32_t i = 0; i < 64; ++i) t.configure_instrument(i, ThrottleLimits{1e12, 1000, 1000, std::chrono::nanoseconds(1)});
+    uint64_t now = TscClock::now_tsc(), ok = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) ok += t.admit(static_cast<uint32_t>(i) & 63, now += 1000);
+    const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "ORDER_THROTTLE_BENCH admit (session + instrument, bucket + window): " << ns / N << " ns (ok=" << ok << ")\n";
+}
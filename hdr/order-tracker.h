@@ -0,0 +1,603 @@
+/*
+        Design notes
+
+        Execution-report receive path
+
+        Every order the gateway writes is tracked until the exchange says it is done with it:
+
+        - ExecReportParser turns the byte stream of a session into ExecReports. Reads land anywhere relative to
+          message boundaries; whole messages are decoded straight out of the read buffer, and only a message split
+          across two reads is staged (at most sizeof(ExecReport) - 1 bytes carried over).
+        - OpenOrderTable holds the live orders: records from a FixedPool, indexed by order id in an open-addressing
+          table (linear probing, fibonacci hash, 4x slots per order - an order being amended holds two - and
+          backward-shift deletion, so there are no tombstones and probe chains stay short forever). Pool and index
+          are carved out of one NumaArena at start-up; nothing is allocated per order. Order id 0 is reserved as
+          the empty key.
+        - OrderTracker drives the per-order state machine
+              New -> Acked -> PartiallyFilled -> Filled
+                  \-> Rejected   \-> Cancelled (from any live state)
+          A fill may arrive before its ack (exchanges that ack by filling); a report that does not fit the current
+          state is counted and ignored. Terminal orders leave the table at once.
+        - amend and cancel reuse the record: each OpenOrder carries its ReplaceMsg and CancelMsg, encoded once in
+          on_send(). on_replace() patches the new id/price/qty into the ReplaceMsg in place and links the new id to
+          the same record (no allocation, no re-encode); while Replacing the order is found under both ids, since
+          fills can still arrive on the old one. The ack of the new id drops the old key; a reject restores the
+          previous terms. Cancelling is undone the same way by a reject.
+        - send->ack and send->first fill latencies go into LatencyHistograms in ns. One rdtsc per read batch is the
+          receive timestamp for every report in it.
+        - single threaded: the gateway's core sends, reads and owns the tracker.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "custom-allocator.h"
+#include "latency-histogram.h"
+#include "order-wire.h"
+#include "tsc-clock.h"
+
+enum class OrderState : uint8_t { New, Acked, PartiallyFilled, Replacing, Cancelling, Filled, Cancelled, Rejected };
+
+inline const char* to_string(OrderState s) {
+    switch (s) {
+    case OrderState::New: return "new";
+    case OrderState::Acked: return "acked";
+    case OrderState::PartiallyFilled: return "partially-filled";
+    case OrderState::Replacing: return "replacing";
+    case OrderState::Cancelling: return "cancelling";
+    case OrderState::Filled: return "filled";
+    case OrderState::Cancelled: return "cancelled";
+    case OrderState::Rejected: return "rejected";
+    }
+    return "?";
+}
+
+inline bool is_terminal(OrderState s) noexcept {
+    return s == OrderState::Filled || s == OrderState::Cancelled || s == OrderState::Rejected;
+}
+
+// One live order: tracking state on the first cache line, its pre-encoded amend/cancel messages on the second.
+struct CACHE_ALIGNED OpenOrder {
+    uint64_t order_id;
+    uint64_t prev_id;       // Replacing: the id being replaced (still linked in the table); 0 otherwise
+    uint64_t send_tsc;      // of the last new order / amend
+    Price price;
+    Price prev_price;
+    uint32_t instr_id;
+    uint32_t qty;
+    uint32_t prev_qty;
+    uint32_t filled;
+    int32_t pending_qty_delta;  // Replacing: qty - prev_qty, until the amend is acked or rejected
+    char side;
+    OrderState state;
+    OrderState prev_state;  // Replacing/Cancelling: where a reject returns to
+
+    alignas(CACHELINE_SIZE) ReplaceMsg replace;
+    CancelMsg cancel;
+};
+static_assert(offsetof(OpenOrder, replace) == CACHELINE_SIZE);
+
+// ---------- open-order table ----------
+class OpenOrderTable {
+public:
+    explicit OpenOrderTable(std::size_t capacity, int numa_node = 0)
+    : mask_(std::bit_ceil(std::max<std::size_t>(capacity * 4, 16)) - 1),
+      shift_(64 - std::countr_zero(mask_ + 1)),
+      arena_(pool_bytes(capacity) + (mask_ + 1) * sizeof(Slot), numa_node),
+      pool_(arena_.base(), pool_bytes(capacity), capacity)
+    {
+        slots_ = reinterpret_cast<Slot*>(static_cast<std::byte*>(arena_.base()) + pool_bytes(capacity));
+        std::fill_n(slots_, mask_ + 1, Slot{});
+    }
+
+    OpenOrderTable(const OpenOrderTable&) = delete;
+    OpenOrderTable& operator=(const OpenOrderTable&) = delete;
+
+    // New zeroed record for `id`. nullptr if the id is 0, already live, or the pool is exhausted.
+    OpenOrder* insert(uint64_t id) noexcept {
+        if (!id) [[unlikely]] return nullptr;
+        std::size_t i = home(id);
+        for (; slots_[i].key; i = (i + 1) & mask_) {
+            if (slots_[i].key == id) [[unlikely]] return nullptr;
+        }
+        OpenOrder* rec = pool_.allocate();
+        if (!rec) [[unlikely]] return nullptr;
+        *rec = OpenOrder{};
+        rec->order_id = id;
+        slots_[i] = Slot{id, rec};
+        ++size_;
+        return rec;
+    }
+
+    // Make `rec` reachable under a second id as well. False if id is 0 or already live.
+    bool link(uint64_t id, OpenOrder* rec) noexcept {
+        if (!id) [[unlikely]] return false;
+        std::size_t i = home(id);
+        for (; slots_[i].key; i = (i + 1) & mask_) {
+            if (slots_[i].key == id) [[unlikely]] return false;
+        }
+        slots_[i] = Slot{id, rec};
+        return true;
+    }
+
+    // Drop `id` from the index only; the record stays allocated.
+    bool unlink(uint64_t id) noexcept { return remove(id, false); }
+
+    OpenOrder* find(uint64_t id) const noexcept {
+        for (std::size_t i = home(id); slots_[i].key; i = (i + 1) & mask_) {
+            if (slots_[i].key == id) return slots_[i].rec;
+        }
+        return nullptr;
+    }
+
+    // Remove `id` and return its record to the pool. False if it was not live.
+    bool erase(uint64_t id) noexcept { return remove(id, true); }
+
+    // Live records (an order linked under two ids counts once).
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return pool_.capacity(); }
+
+private:
+    struct Slot {
+        uint64_t key = 0;
+        OpenOrder* rec = nullptr;
+    };
+
+    bool remove(uint64_t id, bool release) noexcept {
+        std::size_t i = home(id);
+        for (; slots_[i].key != id; i = (i + 1) & mask_) {
+            if (!slots_[i].key) return false;
+        }
+        if (release) {
+            pool_.deallocate(slots_[i].rec);
+            --size_;
+        }
+        // Backward shift: pull later members of the probe run into the hole unless that would move them in front
+        // of their home slot.
+        for (std::size_t j = (i + 1) & mask_; slots_[j].key; j = (j + 1) & mask_) {
+            const std::size_t h = home(slots_[j].key);
+            if (((j - h) & mask_) >= ((j - i) & mask_)) {
+                slots_[i] = slots_[j];
+                i = j;
+            }
+        }
+        slots_[i] = Slot{};
+        return true;
+    }
+
+    static std::size_t pool_bytes(std::size_t capacity) noexcept { return capacity * FixedPool<OpenOrder>::slot_bytes(); }
+    std::size_t home(uint64_t id) const noexcept { return static_cast<std::size_t>((id * 0x9E3779B97F4A7C15ull) >> shift_); }
+
+    std::size_t mask_;
+    int shift_;
+    NumaArena arena_;
+    FixedPool<OpenOrder> pool_;
+    Slot* slots_{nullptr};
+    std::size_t size_{0};
+};
+
+// ---------- incremental parser ----------
+class ExecReportParser {
+public:
+    static constexpr std::size_t SIZE = sizeof(ExecReport);
+
+    // Feed the next bytes of the stream; f(const ExecReport&) per complete report. Returns reports delivered.
+    template <class F>
+    std::size_t feed(const char* p, std::size_t n, F&& f) noexcept {
+        std::size_t msgs = 0;
+        if (have_) {
+            const std::size_t take = std::min(n, SIZE - have_);
+            std::memcpy(stage_ + have_, p, take);
+            have_ += take;
+            p += take;
+            n -= take;
+            if (have_ < SIZE) return 0;
+            deliver(stage_, f);
+            have_ = 0;
+            ++msgs;
+        }
+        for (; n >= SIZE; p += SIZE, n -= SIZE, ++msgs) deliver(p, f);
+        if (n) {
+            std::memcpy(stage_, p, n);
+            have_ = n;
+        }
+        return msgs;
+    }
+
+    std::size_t pending() const noexcept { return have_; }
+
+private:
+    template <class F>
+    static void deliver(const char* p, F& f) noexcept {
+        ExecReport r;
+        std::memcpy(&r, p, SIZE);
+        f(r);
+    }
+
+    char stage_[SIZE];
+    std::size_t have_ = 0;
+};
+
+// ---------- tracker ----------
+struct OrderTrackerStats {
+    uint64_t sent = 0;
+    uint64_t acked = 0;
+    uint64_t partial_fills = 0;
+    uint64_t filled = 0;
+    uint64_t cancelled = 0;
+    uint64_t rejected = 0;
+    uint64_t replaced = 0;          // amends acked
+    uint64_t replace_rejected = 0;
+    uint64_t cancel_rejected = 0;
+    uint64_t unknown = 0;           // report for an order that is not live
+    uint64_t bad_transition = 0;    // report that does not fit the order's state (or an unknown type)
+    uint64_t table_full = 0;        // on_send refused
+};
+
+class OrderTracker {
+public:
+    struct NoUpdate {
+        void operator()(const OpenOrder&, const ExecReport&) const noexcept {}
+    };
+
+    explicit OrderTracker(std::size_t max_open, int numa_node = 0)
+    : table_(max_open, numa_node), clock_(TscClock::instance()) {}
+
+    // Call right before writing the order. nullptr (do not send) if its id is live or the table is full.
+    OpenOrder* on_send(const Order& o, uint64_t send_tsc = TscClock::now_tsc()) noexcept {
+        OpenOrder* rec = table_.insert(o.order_id);
+        if (!rec) [[unlikely]] {
+            ++stats_.table_full;
+            return nullptr;
+        }
+        rec->send_tsc = send_tsc;
+        rec->price = o.price;
+        rec->instr_id = o.instr_id;
+        rec->qty = o.qty;
+        rec->side = o.side;
+        rec->state = OrderState::New;
+        rec->replace = ReplaceMsg{ReplaceType, o.order_id, o};
+        rec->cancel = CancelMsg{CancelType, o.order_id};
+        ++stats_.sent;
+        return rec;
+    }
+
+    // The write after on_send() failed: the exchange never saw the order.
+    void forget(uint64_t order_id) noexcept {
+        if (table_.erase(order_id)) --stats_.sent;
+    }
+
+    // Amend: the acked order `order_id` is to become `new_order_id` at px/qty. Patches the order's ReplaceMsg in
+    // place and returns the record; write rec->replace as is. nullptr if the order is not live and acked (or is
+    // already being amended/cancelled), qty does not exceed what is filled, or new_order_id is live.
+    OpenOrder* on_replace(uint64_t order_id, uint64_t new_order_id, Price px, uint32_t qty,
+                          uint64_t send_tsc = TscClock::now_tsc()) noexcept {
+        OpenOrder* o = table_.find(order_id);
+        if (!o || (o->state != OrderState::Acked && o->state != OrderState::PartiallyFilled) || qty <= o->filled)
+            [[unlikely]] return nullptr;
+        if (!table_.link(new_order_id, o)) [[unlikely]] return nullptr;
+        o->prev_id = order_id;
+        o->prev_price = o->price;
+        o->prev_qty = o->qty;
+        o->prev_state = o->state;
+        o->pending_qty_delta = static_cast<int32_t>(qty) - static_cast<int32_t>(o->qty);
+        o->order_id = new_order_id;
+        o->price = px;
+        o->qty = qty;
+        o->send_tsc = send_tsc;
+        o->state = OrderState::Replacing;
+        o->replace.orig_order_id = order_id;
+        o->replace.order.order_id = new_order_id;
+        o->replace.order.price = px;
+        o->replace.order.qty = qty;
+        return o;
+    }
+
+    // Cancel: patches the order's CancelMsg and returns the record; write rec->cancel as is. nullptr if the order
+    // is not live or already being amended/cancelled.
+    OpenOrder* on_cancel(uint64_t order_id) noexcept {
+        OpenOrder* o = table_.find(order_id);
+        if (!o || is_terminal(o->state) || o->state == OrderState::Replacing || o->state == OrderState::Cancelling)
+            [[unlikely]] return nullptr;
+        o->prev_state = o->state;
+        o->state = OrderState::Cancelling;
+        o->cancel.order_id = o->order_id;
+        return o;
+    }
+
+    // The write after on_replace()/on_cancel() failed: back to the order as it was.
+    void forget_replace(OpenOrder* o) noexcept {
+        undo_replace(o);
+        o->pending_qty_delta = 0;
+    }
+    void forget_cancel(OpenOrder* o) noexcept { o->state = o->prev_state; }
+
+    // Bytes read from the session. on_update(const OpenOrder&, const ExecReport&) runs after each report that
+    // changed an order (before a terminal one leaves the table). Returns reports parsed.
+    template <class F = NoUpdate>
+    std::size_t on_bytes(const char* p, std::size_t n, F&& on_update = {}) noexcept {
+        const uint64_t now = TscClock::now_tsc();
+        return parser_.feed(p, n, [&](const ExecReport& r) { apply(r, now, on_update); });
+    }
+
+    template <class F = NoUpdate>
+    void apply(const ExecReport& r, uint64_t now_tsc, F&& on_update = {}) noexcept {
+        OpenOrder* o = table_.find(r.order_id);
+        if (!o) [[unlikely]] {
+            ++stats_.unknown;
+            return;
+        }
+        switch (r.type) {
+        case ExecReport::Ack:
+            if (o->state == OrderState::Replacing && r.order_id == o->order_id) {
+                table_.unlink(o->prev_id);
+                o->prev_id = 0;
+                o->state = o->prev_state;
+                amend_ns_.record(clock_.ticks_to_ns(now_tsc - o->send_tsc));
+                ++stats_.replaced;
+                break;
+            }
+            // Cancelled before the ack came back: the ack still lands, the cancel stays pending.
+            if (o->state == OrderState::Cancelling && o->prev_state == OrderState::New) o->prev_state = OrderState::Acked;
+            else if (o->state != OrderState::New) [[unlikely]] return bad();
+            else o->state = OrderState::Acked;
+            ack_ns_.record(clock_.ticks_to_ns(now_tsc - o->send_tsc));
+            ++stats_.acked;
+            break;
+        case ExecReport::Fill:
+            if (is_terminal(o->state)) [[unlikely]] return bad();
+            if (!o->filled) fill_ns_.record(clock_.ticks_to_ns(now_tsc - o->send_tsc));
+            o->filled += r.last_qty;
+            if (o->filled >= o->qty || !r.leaves_qty) {
+                o->state = OrderState::Filled;
+                ++stats_.filled;
+            } else {
+                // A pending amend/cancel keeps its state; a reject of it now returns to PartiallyFilled.
+                (o->state == OrderState::Replacing || o->state == OrderState::Cancelling ? o->prev_state : o->state) =
+                    OrderState::PartiallyFilled;
+                ++stats_.partial_fills;
+            }
+            break;
+        case ExecReport::Cancelled:
+            if (is_terminal(o->state)) [[unlikely]] return bad();
+            o->state = OrderState::Cancelled;
+            ++stats_.cancelled;
+            break;
+        case ExecReport::Rejected:
+            if (o->state == OrderState::Replacing && r.order_id == o->order_id) {
+                undo_replace(o);
+                ++stats_.replace_rejected;
+                break;
+            }
+            if (o->state == OrderState::Cancelling) {
+                o->state = o->prev_state;
+                ++stats_.cancel_rejected;
+                break;
+            }
+            if (o->state != OrderState::New) [[unlikely]] return bad();
+            o->state = OrderState::Rejected;
+            ++stats_.rejected;
+            break;
+        default:
+            return bad();
+        }
+        on_update(static_cast<const OpenOrder&>(*o), r);
+        if (o->state != OrderState::Replacing) o->pending_qty_delta = 0;
+        if (is_terminal(o->state)) {
+            if (o->prev_id) table_.unlink(o->prev_id);
+            table_.erase(o->order_id);
+        }
+    }
+
+    const OpenOrder* find(uint64_t order_id) const noexcept { return table_.find(order_id); }
+    std::size_t open() const noexcept { return table_.size(); }
+    const OrderTrackerStats& stats() const noexcept { return stats_; }
+    const LatencyHistogram& ack_latency() const noexcept { return ack_ns_; }     // ns, send -> ack
+    const LatencyHistogram& fill_latency() const noexcept { return fill_ns_; }   // ns, send -> first fill
+    const LatencyHistogram& amend_latency() const noexcept { return amend_ns_; } // ns, amend -> its ack
+
+private:
+    void bad() noexcept { ++stats_.bad_transition; }
+
+    // Back to the terms before the amend; the new id leaves the table. pending_qty_delta is left for the caller.
+    void undo_replace(OpenOrder* o) noexcept {
+        table_.unlink(o->order_id);
+        o->order_id = o->prev_id;
+        o->price = o->prev_price;
+        o->qty = o->prev_qty;
+        o->state = o->prev_state;
+        o->prev_id = 0;
+    }
+
+    OpenOrderTable table_;
+    ExecReportParser parser_;
+    const TscClock& clock_;
+    OrderTrackerStats stats_;
+    LatencyHistogram ack_ns_;
+    LatencyHistogram fill_ns_;
+    LatencyHistogram amend_ns_;
+};
+
+// Four orders through every transition, with the report stream fed 7 bytes at a time so most reports straddle
+// two reads; then a table churn check against a reference set. Returns the transitions seen and the counters.
+std::string ORDER_TRACKER_Test()
+{
+    std::stringstream ss;
+    OrderTracker t(64);
+    for (uint64_t id = 1; id <= 4; ++id) t.on_send(Order{id, 1001, 101.25_px, 100, 'B'});
+    const bool dup_refused = t.on_send(Order{1, 1001, 101.25_px, 100, 'B'}) == nullptr;
+
+    const ExecReport reports[] = {
+        {ExecReport::Ack, 1, 0, 0, 100},
+        {ExecReport::Ack, 2, 0, 0, 100},
+        {ExecReport::Fill, 1, 40, 101.25_px, 60},
+        {ExecReport::Fill, 1, 60, 101.25_px, 0},
+        {ExecReport::Ack, 3, 0, 0, 100},
+        {ExecReport::Cancelled, 2, 0, 0, 0},
+        {ExecReport::Rejected, 4, 0, 0, 0},
+        {ExecReport::Ack, 99, 0, 0, 0},     // never sent
+        {ExecReport::Ack, 1, 0, 0, 0},      // already filled and gone
+        {ExecReport::Ack, 3, 0, 0, 100},    // duplicate ack
+    };
+    std::string stream(sizeof(reports), '\0');
+    for (std::size_t i = 0; i < std::size(reports); ++i) reports[i].serialize(stream.data() + i * sizeof(ExecReport));
+
+    std::string seen;
+    for (std::size_t off = 0; off < stream.size(); off += 7) {
+        t.on_bytes(stream.data() + off, std::min<std::size_t>(7, stream.size() - off), [&](const OpenOrder& o, const ExecReport&) {
+            seen += std::to_string(o.order_id) + ":" + to_string(o.state) + " ";
+        });
+    }
+    const auto& st = t.stats();
+    ss << seen << "unknown=" << st.unknown << " bad=" << st.bad_transition << " open=" << t.open()
+       << " acks=" << t.ack_latency().count() << " fills=" << t.fill_latency().count() << " dup=" << dup_refused;
+
+    // Churn: random ids in and out; the table must agree with a reference set after every step.
+    OpenOrderTable table(512);
+    std::vector<uint64_t> live;
+    std::mt19937_64 rng(7);
+    bool agree = true;
+    for (int step = 0; step < 20000 && agree; ++step) {
+        if (live.size() < 512 && (live.empty() || rng() % 3)) {
+            const uint64_t id = rng() % 4096 + 1;
+            const bool fresh = std::find(live.begin(), live.end(), id) == live.end();
+            agree &= (table.insert(id) != nullptr) == fresh;
+            if (fresh) live.push_back(id);
+        } else {
+            const std::size_t k = rng() % live.size();
+            agree &= table.erase(live[k]);
+            live[k] = live.back();
+            live.pop_back();
+        }
+        if (step % 1000 == 0) {
+            for (uint64_t id : live) agree &= table.find(id) && table.find(id)->order_id == id;
+        }
+    }
+    agree &= table.size() == live.size() && !table.find(4097);
+    ss << " table=" << agree;
+    return ss.str();
+}
+
+// One order amended twice (the first amend rejected, the second acked, with a fill on the old id in between),
+// then cancelled with the cancel rejected once; another cancelled before its ack. Returns the transitions and where the order ended up.
+std::string ORDER_AMEND_Test()
+{
+    std::stringstream ss;
+    OrderTracker t(16);
+    t.on_send(Order{1, 1001, 101.25_px, 100, 'B'});
+    const uint64_t now = TscClock::now_tsc();
+    t.apply(ExecReport{ExecReport::Ack, 1, 0, 0, 100}, now);
+
+    std::string seen;
+    auto log = [&](const OpenOrder& o, const ExecReport&) { seen += std::to_string(o.order_id) + ":" + to_string(o.state) + " "; };
+    const bool not_acked = !t.on_replace(7, 8, 101.0_px, 10);          // unknown id
+
+    OpenOrder* o = t.on_replace(1, 2, 101.50_px, 80);
+    const bool in_place = o && o->replace.type == 'U' && o->replace.orig_order_id == 1 && o->replace.order.order_id == 2 &&
+                          o->replace.order.price == 101.50_px && o->replace.order.qty == 80 && o->replace.order.instr_id == 1001;
+    const bool both_ids = t.find(1) == o && t.find(2) == o;
+    t.apply(ExecReport{ExecReport::Rejected, 2, 0, 0, 100}, now, log);      // amend refused: back to id 1 @ 101.25 x 100
+    ss << "reverted=" << (t.find(1) && !t.find(2) && t.find(1)->qty == 100 && t.find(1)->price == 101.25_px) << " ";
+
+    o = t.on_replace(1, 3, 101.75_px, 60);
+    t.apply(ExecReport{ExecReport::Fill, 1, 20, 101.25_px, 80}, now, log);     // fill on the old id while replacing
+    t.apply(ExecReport{ExecReport::Ack, 3, 0, 0, 40}, now, log);
+    const bool new_terms = !t.find(1) && t.find(3) && t.find(3)->price == 101.75_px && t.find(3)->qty == 60 && t.find(3)->filled == 20;
+
+    o = t.on_cancel(3);
+    const bool cancel_encoded = o && o->cancel.type == 'X' && o->cancel.order_id == 3;
+    t.apply(ExecReport{ExecReport::Rejected, 3, 0, 0, 40}, now, log);
+    t.on_cancel(3);
+    t.apply(ExecReport{ExecReport::Cancelled, 3, 0, 0, 0}, now, log);
+
+    // Cancelled before its ack came back: the ack is not a bad transition.
+    t.on_send(Order{9, 1001, 101.25_px, 100, 'B'});
+    t.on_cancel(9);
+    t.apply(ExecReport{ExecReport::Ack, 9, 0, 0, 100}, now);
+    t.apply(ExecReport{ExecReport::Cancelled, 9, 0, 0, 0}, now);
+
+    const auto& st = t.stats();
+    ss << seen << "in-place=" << in_place << " both-ids=" << both_ids << " new-terms=" << new_terms
+       << " cancel=" << cancel_encoded << " unknown-refused=" << not_acked << " replaced=" << st.replaced
+       << " replace-rejected=" << st.replace_rejected << " cancel-rejected=" << st.cancel_rejected << " open=" << t.open()
+       << " cancel-before-ack=" << (st.acked == 2 && !st.bad_transition);
+    return ss.str();
+}
+
+// Wire-ready amend (patch the stored ReplaceMsg) against a wire-ready new order (track + encode a NewOrderMsg).
+void ORDER_AMEND_BENCH()
+{
+    constexpr std::size_t OPEN = 1024;
+    constexpr int ROUNDS = 2000;
+    OrderTracker t(OPEN * 2);
+    std::vector<NewOrderMsg> out(OPEN);
+    const uint64_t now = TscClock::now_tsc();
+    uint64_t sink = 0;
+    double new_ns = 0, amend_ns = 0;
+
+    uint64_t next_id = 1;
+    std::vector<uint64_t> ids(OPEN);
+    for (int round = 0; round < ROUNDS; ++round) {
+        // New orders: track and encode.
+        auto t0 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < OPEN; ++i) {
+            const Order o{next_id, 1001, 101.25_px, 100, 'B'};
+            t.on_send(o, now);
+            out[i] = NewOrderMsg{NewOrderType, o};
+            ids[i] = next_id++;
+        }
+        new_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        for (std::size_t i = 0; i < OPEN; ++i) t.apply(ExecReport{ExecReport::Ack, ids[i], 0, 0, 100}, now);
+
+        // Amends: patch in place; the message is ready at &rec->replace.
+        t0 = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < OPEN; ++i) {
+            const OpenOrder* rec = t.on_replace(ids[i], next_id, 101.50_px, 90, now);
+            sink += rec->replace.order.qty;
+            ids[i] = next_id++;
+        }
+        amend_ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        for (std::size_t i = 0; i < OPEN; ++i) t.apply(ExecReport{ExecReport::Cancelled, ids[i], 0, 0, 0}, now);
+    }
+    const double n = static_cast<double>(OPEN) * ROUNDS;
+    std::cout << "ORDER_AMEND_BENCH new order (track + encode): " << new_ns / n << " ns, amend (patch in place): "
+              << amend_ns / n << " ns (sink " << (sink & 1) << ")\n";
+}
+
+// Cost of tracking one order end to end: on_send, then an ack and a fill parsed from a read buffer.
+void ORDER_TRACKER_BENCH()
+{
+    constexpr std::size_t OPEN = 1024;
+    constexpr uint64_t ORDERS = 2'000'000;
+    OrderTracker t(OPEN * 2);
+    std::vector<char> rx(OPEN * 2 * sizeof(ExecReport));
+
+    uint64_t id = 1;
+    const auto t0 = std::chrono::steady_clock::now();
+    while (id <= ORDERS) {
+        char* w = rx.data();
+        const uint64_t first = id;
+        for (std::size_t i = 0; i < OPEN; ++i, ++id) t.on_send(Order{id, 1001, 101.25_px, 100, 'B'});
+        for (uint64_t k = first; k < id; ++k) {
+            ExecReport{ExecReport::Ack, k, 0, 0, 100}.serialize(w);
+            ExecReport{ExecReport::Fill, k, 100, 101.25_px, 0}.serialize(w + sizeof(ExecReport));
+            w += 2 * sizeof(ExecReport);
+        }
+        t.on_bytes(rx.data(), static_cast<std::size_t>(w - rx.data()));
+    }
+    const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "ORDER_TRACKER_BENCH: " << ns / static_cast<double>(id - 1) << " ns/order (send+ack+fill), open="
+              << t.open() << " filled=" << t.stats().filled << "\n";
+}
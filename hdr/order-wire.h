@@ -0,0 +1,66 @@
+/*
+        Design notes
+
+        Order entry wire format
+
+        The binary messages exchanged with the exchange's order entry port: Order goes out, ExecReport comes back.
+        Both are packed little-endian structs sent as-is, so encoding is one memcpy and decoding a field is one
+        unaligned load. They live here, apart from any transport, so gateways, the tracker and tests share them.
+
+        On an order entry session every outbound message starts with its type byte: NewOrderMsg ('O' + Order),
+        ReplaceMsg ('U', the id being replaced, then the full Order as it should now stand) and CancelMsg ('X').
+        ReplaceMsg embeds a whole Order on purpose: the tracker keeps one per live order, encoded when the order
+        is sent, and an amend only patches id/price/qty in it before writing it out.
+
+        Prices are fixed-point (Price, an int64 of 1e-8) in the same 8 bytes the double used to take.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "fixed-price.h"
+
+// Wire order as sent by OrderGateway.
+struct Order {
+    uint64_t order_id;
+    uint32_t instr_id;
+    Price price;
+    uint32_t qty;
+    char side;
+
+    void serialize(char* out) const noexcept { std::memcpy(out, this, sizeof(Order)); }
+} __attribute__((__packed__));
+
+// Outbound message types on an order entry session.
+enum WireMsgType : char { NewOrderType = 'O', ReplaceType = 'U', CancelType = 'X' };
+
+struct NewOrderMsg {
+    char type = NewOrderType;
+    Order order;
+} __attribute__((__packed__));
+
+struct ReplaceMsg {
+    char type = ReplaceType;
+    uint64_t orig_order_id;     // the id the exchange knows the order by
+    Order order;                // order_id is the new id; price/qty the new terms
+} __attribute__((__packed__));
+
+struct CancelMsg {
+    char type = CancelType;
+    uint64_t order_id;
+} __attribute__((__packed__));
+
+// Exchange response to an Order, one per event on it.
+struct ExecReport {
+    enum Type : char { Ack = 'A', Fill = 'F', Cancelled = 'C', Rejected = 'R' };
+
+    char type;
+    uint64_t order_id;
+    uint32_t last_qty;      // Fill: quantity of this execution
+    Price last_px;          // Fill: price of this execution
+    uint32_t leaves_qty;    // quantity still open after this event
+
+    void serialize(char* out) const noexcept { std::memcpy(out, this, sizeof(ExecReport)); }
+} __attribute__((__packed__));
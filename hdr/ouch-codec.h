@@ -0,0 +1,422 @@
+/*
+        Design notes
+
+        OUCH-style binary order entry codec
+
+        Binary venues (OUCH and its relatives) define every message as a fixed sequence of fixed-width big-endian
+        fields behind a one-byte message type. Each message is declared here exactly once, as a packed struct of
+        BigEndian<T> fields, which is the wire layout itself:
+
+        - the struct is the layout: offsets and the total size come from the compiler, and static_asserts pin them to
+          the documented sizes, so a field added in the wrong place fails the build rather than the session.
+        - BigEndian<T> stores the bytes in network order; reading or assigning a field is one load/store plus a bswap
+          (std::byteswap), with no branches. Single-byte fields (type, side, alpha codes) are plain chars.
+        - encode() and decode() are generated for every message type from the struct: one fixed-size memcpy to or
+          from the caller's buffer, so OrderGateway can build straight into its send buffer.
+        - prices are integers in 1/10000 units on the wire (OUCH convention), converted by WIRE_PRICE, a PriceSpec
+          with 4 wire decimals. Nothing is ever rounded: an order priced finer than 1/10000 is refused by the
+          encoder rather than sent at a price the strategy did not ask for.
+        - inbound: message_size(type) comes from a table built from the same structs, and OuchReader frames a byte
+          stream with it, staging a message cut by a read boundary like ExecReportParser does.
+
+        Outbound: EnterOrder 'O', ReplaceOrder 'U', CancelOrder 'X'. Inbound: Accepted 'A', Executed 'E'.
+        The session layer (SoupBinTCP login, sequencing, heartbeats) is not part of the codec.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "order-wire.h"
+
+// ---------- big-endian fields ----------
+template <class T>
+struct BigEndian {
+    static_assert(std::is_integral_v<T>);
+
+    unsigned char bytes[sizeof(T)];
+
+    static constexpr T swap(T v) noexcept {
+        if constexpr (std::endian::native == std::endian::little && sizeof(T) > 1) return std::byteswap(v);
+        else return v;
+    }
+
+    operator T() const noexcept {
+        T v;
+        std::memcpy(&v, bytes, sizeof(T));
+        return swap(v);
+    }
+
+    BigEndian& operator=(T v) noexcept {
+        v = swap(v);
+        std::memcpy(bytes, &v, sizeof(T));
+        return *this;
+    }
+} __attribute__((__packed__));
+
+using be16 = BigEndian<uint16_t>;
+using be32 = BigEndian<uint32_t>;
+using be64 = BigEndian<uint64_t>;
+using bei64 = BigEndian<int64_t>;
+
+namespace ouch {
+
+// ---------- messages ----------
+inline constexpr PriceSpec WIRE_PRICE{Price{10'000}, 4};   // wire prices are in 1/10000
+
+struct EnterOrder {
+    static constexpr char TYPE = 'O';
+    char type;
+    be64 token;             // our order id
+    be32 instrument;
+    char side;              // 'B' / 'S'
+    be32 quantity;
+    bei64 price;
+    char time_in_force;     // '0' day, '3' IOC
+} __attribute__((__packed__));
+static_assert(sizeof(EnterOrder) == 27);
+
+struct ReplaceOrder {
+    static constexpr char TYPE = 'U';
+    char type;
+    be64 existing_token;
+    be64 replacement_token;
+    be32 quantity;
+    bei64 price;
+} __attribute__((__packed__));
+static_assert(sizeof(ReplaceOrder) == 29);
+
+struct CancelOrder {
+    static constexpr char TYPE = 'X';
+    char type;
+    be64 token;
+    be32 quantity;          // quantity to leave open; 0 cancels the order
+} __attribute__((__packed__));
+static_assert(sizeof(CancelOrder) == 13);
+
+struct Accepted {
+    static constexpr char TYPE = 'A';
+    char type;
+    be64 timestamp;         // venue ns since midnight
+    be64 token;
+    be32 instrument;
+    char side;
+    be32 quantity;
+    bei64 price;
+    char state;             // 'L' live, 'D' dead
+} __attribute__((__packed__));
+static_assert(sizeof(Accepted) == 35);
+
+struct Executed {
+    static constexpr char TYPE = 'E';
+    char type;
+    be64 timestamp;
+    be64 token;
+    be32 executed_quantity;
+    bei64 execution_price;
+    be64 match_number;
+} __attribute__((__packed__));
+static_assert(sizeof(Executed) == 37);
+
+template <class M>
+concept Message = std::is_trivially_copyable_v<M> && std::is_same_v<std::remove_cv_t<decltype(M::TYPE)>, char> &&
+                  offsetof(M, type) == 0;
+
+// ---------- generated codec ----------
+// Write m to out (sizeof(M) bytes, type byte included); returns the bytes written.
+template <Message M>
+inline std::size_t encode(M m, char* out) noexcept {
+    m.type = M::TYPE;
+    std::memcpy(out, &m, sizeof(M));
+    return sizeof(M);
+}
+
+// Read a message of type M from in; the caller has matched in[0] against M::TYPE.
+template <Message M>
+inline M decode(const char* in) noexcept {
+    M m;
+    std::memcpy(&m, in, sizeof(M));
+    return m;
+}
+
+// False if px is finer than the wire's 1/10000.
+inline constexpr bool to_price(Price px, int64_t& wire) noexcept { return WIRE_PRICE.to_wire(px, wire); }
+inline constexpr Price from_price(int64_t px) noexcept { return WIRE_PRICE.from_wire(px); }
+
+// Order -> EnterOrder straight into a send buffer. 0, and nothing written, if the price is off the wire's grid.
+inline std::size_t encode_enter(const Order& o, char* out, char time_in_force = '0') noexcept {
+    int64_t px;
+    if (!to_price(o.price, px)) [[unlikely]] return 0;
+    EnterOrder m;
+    m.token = o.order_id;
+    m.instrument = o.instr_id;
+    m.side = o.side;
+    m.quantity = o.qty;
+    m.price = px;
+    m.time_in_force = time_in_force;
+    return encode(m, out);
+}
+
+// Amend existing_token to the terms (and new id) of `replacement`. 0 if its price is off the wire's grid.
+inline std::size_t encode_replace(uint64_t existing_token, const Order& replacement, char* out) noexcept {
+    int64_t px;
+    if (!to_price(replacement.price, px)) [[unlikely]] return 0;
+    ReplaceOrder m;
+    m.existing_token = existing_token;
+    m.replacement_token = replacement.order_id;
+    m.quantity = replacement.qty;
+    m.price = px;
+    return encode(m, out);
+}
+
+inline std::size_t encode_cancel(uint64_t token, char* out, uint32_t leave_quantity = 0) noexcept {
+    CancelOrder m;
+    m.token = token;
+    m.quantity = leave_quantity;
+    return encode(m, out);
+}
+
+// ---------- inbound framing ----------
+template <Message... Ms>
+constexpr std::array<uint8_t, 256> size_table() {
+    std::array<uint8_t, 256> t{};
+    ((t[static_cast<unsigned char>(Ms::TYPE)] = static_cast<uint8_t>(sizeof(Ms))), ...);
+    return t;
+}
+
+inline constexpr std::array<uint8_t, 256> SIZES = size_table<EnterOrder, ReplaceOrder, CancelOrder, Accepted, Executed>();
+inline constexpr std::size_t MAX_SIZE = std::max({sizeof(EnterOrder), sizeof(ReplaceOrder), sizeof(CancelOrder),
+                                                  sizeof(Accepted), sizeof(Executed)});
+
+// Wire size of a message of this type, 0 for an unknown type.
+constexpr std::size_t message_size(char type) noexcept { return SIZES[static_cast<unsigned char>(type)]; }
+
+// Call f with the decoded message at p (message_size(p[0]) bytes available).
+template <class F>
+inline void dispatch(const char* p, F& f) noexcept {
+    switch (p[0]) {
+    case EnterOrder::TYPE: f(decode<EnterOrder>(p)); break;
+    case ReplaceOrder::TYPE: f(decode<ReplaceOrder>(p)); break;
+    case CancelOrder::TYPE: f(decode<CancelOrder>(p)); break;
+    case Accepted::TYPE: f(decode<Accepted>(p)); break;
+    case Executed::TYPE: f(decode<Executed>(p)); break;
+    }
+}
+
+} // namespace ouch
+
+struct OuchReaderStats {
+    uint64_t messages = 0;
+    uint64_t unknown_type = 0;      // a byte that starts no known message; skipped
+};
+
+// Frames a stream of OUCH messages. f is called with the decoded message struct; overload it per type.
+class OuchReader {
+public:
+    template <class F>
+    std::size_t feed(const char* p, std::size_t n, F&& f) noexcept {
+        std::size_t msgs = 0;
+        if (have_) {
+            const std::size_t size = ouch::message_size(stage_[0]);
+            const std::size_t take = std::min(n, size - have_);
+            std::memcpy(stage_ + have_, p, take);
+            have_ += take;
+            p += take;
+            n -= take;
+            if (have_ < size) return 0;
+            ouch::dispatch(stage_, f);
+            have_ = 0;
+            ++msgs;
+        }
+        while (n) {
+            const std::size_t size = ouch::message_size(p[0]);
+            if (!size) [[unlikely]] {
+                ++stats_.unknown_type;
+                ++p;
+                --n;
+                continue;
+            }
+            if (n < size) {
+                std::memcpy(stage_, p, n);
+                have_ = n;
+                break;
+            }
+            ouch::dispatch(p, f);
+            p += size;
+            n -= size;
+            ++msgs;
+        }
+        stats_.messages += msgs;
+        return msgs;
+    }
+
+    std::size_t pending() const noexcept { return have_; }
+    const OuchReaderStats& stats() const noexcept { return stats_; }
+
+private:
+    char stage_[ouch::MAX_SIZE];
+    std::size_t have_ = 0;
+    OuchReaderStats stats_;
+};
+
+// Exact bytes of one EnterOrder, every type round-tripped with random field values, and a split stream read back.
+std::string OUCH_CODEC_Test()
+{
+    std::stringstream ss;
+    char buf[64];
+    const std::size_t n = ouch::encode_enter(Order{0x0102030405060708ull, 1001, 101.25_px, 500, 'B'}, buf);
+    static constexpr unsigned char want[] = {'O', 1, 2, 3, 4, 5, 6, 7, 8,     // token
+                                             0, 0, 0x03, 0xe9,                  // instrument 1001
+                                             'B', 0, 0, 0x01, 0xf4,             // side, quantity 500
+                                             0, 0, 0, 0, 0, 0x0f, 0x73, 0x14,   // price 101.25 * 10^4
+                                             '0'};
+    ss << "enter-bytes=" << (n == sizeof(want) && std::memcmp(buf, want, sizeof(want)) == 0);
+
+    std::mt19937_64 rng(9);
+    bool round = true;
+    for (int i = 0; i < 1000; ++i) {
+        const uint64_t a = rng(), b = rng();
+        const auto q = static_cast<uint32_t>(rng());
+        const auto px = static_cast<int64_t>(rng());
+        ouch::Accepted acc{};
+        acc.timestamp = a;
+        acc.token = b;
+        acc.instrument = q ^ 1;
+        acc.side = 'S';
+        acc.quantity = q;
+        acc.price = px;
+        acc.state = 'L';
+        ouch::encode(acc, buf);
+        const auto acc2 = ouch::decode<ouch::Accepted>(buf);
+        round &= buf[0] == 'A' && acc2.timestamp == a && acc2.token == b && acc2.instrument == (q ^ 1) &&
+                 acc2.side == 'S' && acc2.quantity == q && acc2.price == px && acc2.state == 'L';
+
+        ouch::Executed ex{};
+        ex.timestamp = a;
+        ex.token = b;
+        ex.executed_quantity = q;
+        ex.execution_price = -px;
+        ex.match_number = a ^ b;
+        ouch::encode(ex, buf);
+        const auto ex2 = ouch::decode<ouch::Executed>(buf);
+        round &= buf[0] == 'E' && ex2.timestamp == a && ex2.token == b && ex2.executed_quantity == q &&
+                 ex2.execution_price == -px && ex2.match_number == (a ^ b);
+
+        const Order o{b, q, Price::from_raw(static_cast<int64_t>(q % 1000000) * 1'000'000), q, 'S'};
+        ouch::encode_replace(a, o, buf);
+        const auto rp = ouch::decode<ouch::ReplaceOrder>(buf);
+        round &= buf[0] == 'U' && rp.existing_token == a && rp.replacement_token == b && rp.quantity == q &&
+                 ouch::from_price(rp.price) == o.price;
+
+        ouch::encode_cancel(a, buf, q);
+        const auto cx = ouch::decode<ouch::CancelOrder>(buf);
+        round &= buf[0] == 'X' && cx.token == a && cx.quantity == q;
+
+        ouch::encode_enter(o, buf, '3');
+        const auto en = ouch::decode<ouch::EnterOrder>(buf);
+        round &= en.token == b && en.instrument == q && en.side == 'S' && en.quantity == q && en.time_in_force == '3';
+    }
+
+    // Accepted, Executed, a stray byte, Executed, cut at every point.
+    std::string stream;
+    {
+        ouch::Accepted acc{};
+        acc.token = 7;
+        acc.quantity = 100;
+        ouch::Executed ex{};
+        ex.token = 7;
+        ex.executed_quantity = 40;
+        ouch::encode(acc, buf);
+        stream.append(buf, sizeof(acc));
+        ouch::encode(ex, buf);
+        stream.append(buf, sizeof(ex));
+        stream += '?';
+        ex.executed_quantity = 60;
+        ouch::encode(ex, buf);
+        stream.append(buf, sizeof(ex));
+    }
+    bool splits = true;
+    std::string seen;
+    for (std::size_t cut = 0; cut <= stream.size(); ++cut) {
+        OuchReader r;
+        std::string got;
+        auto on = [&](const auto& m) {
+            using M = std::decay_t<decltype(m)>;
+            if constexpr (std::is_same_v<M, ouch::Accepted>) got += "A" + std::to_string(m.token) + "/" + std::to_string(m.quantity) + " ";
+            else if constexpr (std::is_same_v<M, ouch::Executed>) got += "E" + std::to_string(m.token) + "/" + std::to_string(m.executed_quantity) + " ";
+        };
+        r.feed(stream.data(), cut, on);
+        r.feed(stream.data() + cut, stream.size() - cut, on);
+        splits &= r.stats().messages == 3 && r.stats().unknown_type == 1 && r.pending() == 0;
+        if (cut == 0) seen = got;
+        splits &= got == seen;
+    }
+    // 101.00005 cannot be said in 1/10000: refused, not truncated to 101.
+    const Order fine{1, 1001, 101.00005_px, 1, 'B'};
+    ss << " round-trip=" << round << " off-grid=" << (!ouch::encode_enter(fine, buf) && !ouch::encode_replace(1, fine, buf))
+       << " splits=" << splits << " " << seen << "sizes=" << ouch::message_size('O') << "/"
+       << ouch::message_size('U') << "/" << ouch::message_size('X') << "/" << ouch::message_size('A') << "/"
+       << ouch::message_size('E') << "/" << ouch::message_size('Z');
+    return ss.str();
+}
+
+// ns per message: EnterOrder built from an Order into a send buffer, and Executed decoded with every field read.
+void OUCH_CODEC_BENCH()
+{
+    constexpr int N = 10000000;
+    std::vector<Order> orders(1024);
+    std::mt19937_64 rng(5);
+    for (auto& o : orders) o = Order{rng(), static_cast<uint32_t>(rng() % 5000), 100_px + Price::from_raw(static_cast<int64_t>(rng() % 10000) * 1'000'000),
+                                     static_cast<uint32_t>(rng() % 1000 + 1), rng() % 2 ? 'S' : 'B'};
+    std::vector<char> out(1024 * sizeof(ouch::EnterOrder));
+    uint64_t sink = 0;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) {
+        const std::size_t k = static_cast<std::size_t>(i) & 1023;
+        sink += ouch::encode_enter(orders[k], out.data() + k * sizeof(ouch::EnterOrder));
+    }
+    const double enc = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+    sink += static_cast<unsigned char>(out[5]);
+
+    std::vector<char> in(1024 * sizeof(ouch::Executed));
+    for (std::size_t k = 0; k < 1024; ++k) {
+        ouch::Executed ex{};
+        ex.token = rng();
+        ex.executed_quantity = static_cast<uint32_t>(rng());
+        ex.execution_price = static_cast<int64_t>(rng() >> 1);
+        ouch::encode(ex, in.data() + k * sizeof(ouch::Executed));
+    }
+    t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) {
+        const auto ex = ouch::decode<ouch::Executed>(in.data() + (static_cast<std::size_t>(i) & 1023) * sizeof(ouch::Executed));
+        sink += ex.token + ex.executed_quantity + static_cast<uint64_t>(static_cast<int64_t>(ex.execution_price)) +
+                ex.timestamp + ex.match_number;
+    }
+    const double dec = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    OuchReader reader;
+    t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < N / 1024; ++r) {
+        reader.feed(in.data(), in.size(), [&](const auto& m) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(m)>, ouch::Executed>) sink += m.executed_quantity;
+        });
+    }
+    const double rd = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N;
+
+    std::cout << "OUCH_CODEC_BENCH encode EnterOrder: " << enc << " ns, decode Executed: " << dec
+              << " ns, framed read Executed: " << rd << " ns (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,340 @@
+/*
+        Design notes
+
+        Pre-trade risk checks
+
+        Every order passes RiskEngine::check() between the strategy and the wire. A full check has to cost tens of
+        nanoseconds, so it is laid out for the cache and the branch predictor rather than for readability:
+
+        - per-instrument limits and running exposure share one 64-byte RiskRecord, indexed directly by instr_id in a
+          NumaArena-backed array: one cache line touched per check, and it stays hot for instruments we trade.
+        - every rule is evaluated unconditionally into a bit of a violation mask (no early exit); the result is the
+          lowest set bit, so the fast path is one well-predicted branch on "mask == 0".
+        - rules: max order qty, max notional, price band around the last trade, worst-case position (position plus
+          all open quantity on that side plus this order) and open-order count per instrument, and a message-rate
+          throttle per engine (fixed TSC window).
+        - the price band is stored as absolute [lo, hi] prices, recomputed on each trade print (on_trade), so the
+          check is two compares with no multiply. No print yet means no band.
+        - prices and notionals are fixed-point (Price): the band check is two integer compares, and notional is
+          one 64x64->128 multiply, exact, against the limit.
+        - the kill switch is a flag alone on its cache line. kill() is a single store from any thread; every check
+          loads it first, so nothing is accepted after the store becomes visible.
+        - accept() reserves the order's exposure, on_fill()/on_done() release it as execution reports arrive. All of
+          that runs on the gateway's core; only the kill switch is shared.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "custom-allocator.h"
+#include "fixed-price.h"
+#include "tsc-clock.h"
+
+enum class RiskResult : uint8_t { Ok, Killed, UnknownInstrument, MaxQty, MaxNotional, PriceBand, Position, OpenOrders, Throttled };
+
+inline const char* to_string(RiskResult r) {
+    switch (r) {
+    case RiskResult::Ok: return "ok";
+    case RiskResult::Killed: return "killed";
+    case RiskResult::UnknownInstrument: return "unknown";
+    case RiskResult::MaxQty: return "max-qty";
+    case RiskResult::MaxNotional: return "max-notional";
+    case RiskResult::PriceBand: return "band";
+    case RiskResult::Position: return "position";
+    case RiskResult::OpenOrders: return "open-orders";
+    case RiskResult::Throttled: return "throttled";
+    }
+    return "?";
+}
+
+struct InstrumentLimits {
+    uint32_t max_qty = 0;
+    Price max_notional{0};
+    double band_frac = 0.05;            // accepted prices: last trade +/- 5%
+    uint32_t max_position = 0;          // absolute, either side
+    uint32_t max_open_orders = 0;
+};
+
+struct RiskOptions {
+    std::size_t max_instruments = 4096;     // instr_id must be below this
+    uint32_t max_msgs_per_window = 1000;
+    std::chrono::microseconds window{1'000'000};
+    int numa_node = 0;
+};
+
+// Limits and live exposure of one instrument: the only memory a check touches besides the engine's own line.
+struct CACHE_ALIGNED RiskRecord {
+    Price max_notional;
+    Price band_lo;
+    Price band_hi;
+    int64_t position;
+    int64_t open_buy;       // quantity
+    int64_t open_sell;
+    uint32_t max_qty;
+    uint32_t max_position;
+    uint32_t open_orders;
+    uint32_t max_open_orders;
+};
+static_assert(sizeof(RiskRecord) == CACHELINE_SIZE);
+
+class RiskEngine {
+public:
+    explicit RiskEngine(RiskOptions opt = {})
+    : opt_(opt),
+      arena_(opt.max_instruments * sizeof(RiskRecord), opt.numa_node),
+      records_(static_cast<RiskRecord*>(arena_.base())),
+      band_frac_(opt.max_instruments, 0.0),
+      window_tsc_(static_cast<uint64_t>(static_cast<double>(std::chrono::nanoseconds(opt.window).count()) *
+                                        TscClock::instance().ticks_per_ns()))
+    {
+        // Unconfigured instruments allow nothing (max_qty 0).
+        std::fill_n(records_, opt_.max_instruments,
+                    RiskRecord{Price{0}, Price{0}, Price::max(), 0, 0, 0, 0, 0, 0, 0});
+    }
+
+    RiskEngine(const RiskEngine&) = delete;
+    RiskEngine& operator=(const RiskEngine&) = delete;
+
+    // Cold path. Keeps the instrument's current exposure.
+    void configure(uint32_t instr_id, const InstrumentLimits& l) {
+        if (instr_id >= opt_.max_instruments) throw std::runtime_error("RiskEngine: instr_id out of range");
+        if (!(l.band_frac >= 0 && l.band_frac <= 1)) throw std::runtime_error("RiskEngine: band_frac outside [0, 1]");
+        RiskRecord& r = records_[instr_id];
+        r.max_qty = l.max_qty;
+        r.max_notional = l.max_notional;
+        r.max_position = l.max_position;
+        r.max_open_orders = l.max_open_orders;
+        band_frac_[instr_id] = l.band_frac;
+    }
+
+    // Last trade print: re-centres the instrument's price band.
+    void on_trade(uint32_t instr_id, Price px) noexcept {
+        if (instr_id >= opt_.max_instruments) return;
+        RiskRecord& r = records_[instr_id];
+        Price width{};
+        if (!Price::from_double(px.to_double() * band_frac_[instr_id], width)) [[unlikely]] return;   // keeps the last band
+        r.band_lo = px - width;
+        r.band_hi = px + width;
+    }
+
+    // Hot path. Changes no exposure, only counts a rule reject in rejects(); call accept() once the order is
+    // actually going out.
+    RiskResult check(uint32_t instr_id, char side, Price px, uint32_t qty, uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        if (killed_.load(std::memory_order_relaxed)) [[unlikely]] return RiskResult::Killed;
+        if (instr_id >= opt_.max_instruments) [[unlikely]] return RiskResult::UnknownInstrument;
+        const RiskRecord& r = records_[instr_id];
+
+        const bool buy = side == 'B';
+        const int64_t q = qty;
+        const int64_t worst = buy ? r.position + r.open_buy + q : r.open_sell + q - r.position;
+        const bool new_window = now_tsc - window_start_ >= window_tsc_;
+
+        const uint32_t mask =
+            (uint32_t{qty > r.max_qty} << 0) |
+            (uint32_t{notional(px, qty) > r.max_notional.raw} << 1) |
+            (uint32_t{!(px >= r.band_lo && px <= r.band_hi)} << 2) |
+            (uint32_t{worst > static_cast<int64_t>(r.max_position)} << 3) |
+            (uint32_t{r.open_orders >= r.max_open_orders} << 4) |
+            (uint32_t{!new_window && window_count_ >= opt_.max_msgs_per_window} << 5);
+        if (!mask) [[likely]] return RiskResult::Ok;
+        ++rejects_;
+        return static_cast<RiskResult>(static_cast<int>(RiskResult::MaxQty) + std::countr_zero(mask));
+    }
+
+    // Hot path, for an amend of a live order to px/new_qty, delta = new_qty - current qty. Same rules as check()
+    // except the open-order count (the order is already counted); an increase counts against position.
+    RiskResult check_amend(uint32_t instr_id, char side, Price px, uint32_t new_qty, int64_t delta,
+                           uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        if (killed_.load(std::memory_order_relaxed)) [[unlikely]] return RiskResult::Killed;
+        if (instr_id >= opt_.max_instruments) [[unlikely]] return RiskResult::UnknownInstrument;
+        const RiskRecord& r = records_[instr_id];
+
+        const int64_t up = std::max<int64_t>(delta, 0);
+        const int64_t worst = side == 'B' ? r.position + r.open_buy + up : r.open_sell + up - r.position;
+        const bool new_window = now_tsc - window_start_ >= window_tsc_;
+
+        const uint32_t mask =
+            (uint32_t{new_qty > r.max_qty} << 0) |
+            (uint32_t{notional(px, new_qty) > r.max_notional.raw} << 1) |
+            (uint32_t{!(px >= r.band_lo && px <= r.band_hi)} << 2) |
+            (uint32_t{worst > static_cast<int64_t>(r.max_position)} << 3) |
+            (uint32_t{!new_window && window_count_ >= opt_.max_msgs_per_window} << 5);
+        if (!mask) [[likely]] return RiskResult::Ok;
+        ++rejects_;
+        return static_cast<RiskResult>(static_cast<int>(RiskResult::MaxQty) + std::countr_zero(mask));
+    }
+
+    // The amend passed check_amend() and is being sent: move open quantity by delta, count the message.
+    void accept_amend(uint32_t instr_id, char side, int64_t delta, uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        RiskRecord& r = records_[instr_id];
+        (side == 'B' ? r.open_buy : r.open_sell) += delta;
+        count_message(now_tsc);
+    }
+
+    // The exchange refused an amend accepted with `delta`.
+    void on_amend_rejected(uint32_t instr_id, char side, int64_t delta) noexcept {
+        RiskRecord& r = records_[instr_id];
+        (side == 'B' ? r.open_buy : r.open_sell) -= delta;
+    }
+
+    // The order passed check() and is being sent: reserve its exposure and count it against the throttle.
+    void accept(uint32_t instr_id, char side, uint32_t qty, uint64_t now_tsc = TscClock::now_tsc()) noexcept {
+        RiskRecord& r = records_[instr_id];
+        (side == 'B' ? r.open_buy : r.open_sell) += qty;
+        ++r.open_orders;
+        count_message(now_tsc);
+    }
+
+    // check() then accept(); the usual call on the send path.
+    RiskResult check_and_accept(uint32_t instr_id, char side, Price px, uint32_t qty) noexcept {
+        const uint64_t now = TscClock::now_tsc();
+        const RiskResult res = check(instr_id, side, px, qty, now);
+        if (res == RiskResult::Ok) [[likely]] accept(instr_id, side, qty, now);
+        return res;
+    }
+
+    // An execution: open quantity becomes position.
+    void on_fill(uint32_t instr_id, char side, uint32_t qty) noexcept {
+        RiskRecord& r = records_[instr_id];
+        if (side == 'B') {
+            r.open_buy -= qty;
+            r.position += qty;
+        } else {
+            r.open_sell -= qty;
+            r.position -= qty;
+        }
+    }
+
+    // The order is no longer live (filled, cancelled, rejected, or never sent); leaves_qty was still open.
+    void on_done(uint32_t instr_id, char side, uint32_t leaves_qty) noexcept {
+        RiskRecord& r = records_[instr_id];
+        (side == 'B' ? r.open_buy : r.open_sell) -= leaves_qty;
+        --r.open_orders;
+    }
+
+    // Any thread. One store; every check after it sees Killed.
+    void kill() noexcept { killed_.store(true, std::memory_order_release); }
+    void revive() noexcept { killed_.store(false, std::memory_order_release); }
+    bool killed() const noexcept { return killed_.load(std::memory_order_acquire); }
+
+    const RiskRecord& record(uint32_t instr_id) const noexcept { return records_[instr_id]; }
+    uint64_t rejects() const noexcept { return rejects_; }
+
+private:
+    // In Price units; 128 bits so no price x qty can overflow.
+    static __int128 notional(Price px, uint32_t qty) noexcept { return static_cast<__int128>(px.raw) * qty; }
+
+    void count_message(uint64_t now_tsc) noexcept {
+        if (now_tsc - window_start_ >= window_tsc_) {
+            window_start_ = now_tsc;
+            window_count_ = 0;
+        }
+        ++window_count_;
+    }
+
+    CACHE_ALIGNED std::atomic<bool> killed_{false};
+    char pad_[CACHELINE_SIZE - sizeof(std::atomic<bool>)]{};
+
+    // Gateway core only.
+    CACHE_ALIGNED uint64_t window_start_ = 0;
+    uint32_t window_count_ = 0;
+    uint64_t rejects_ = 0;
+
+    RiskOptions opt_;
+    NumaArena arena_;
+    RiskRecord* records_;
+    std::vector<double> band_frac_;     // cold: only on_trade reads it
+    uint64_t window_tsc_;
+};
+
+// Walks one instrument into each rule in turn. Returns the results, space separated.
+std::string RISK_Test()
+{
+    RiskOptions opt;
+    opt.max_instruments = 16;
+    opt.max_msgs_per_window = 6;
+    opt.window = std::chrono::microseconds(60'000'000);     // never rolls over during the test
+    RiskEngine risk(opt);
+    risk.configure(1, InstrumentLimits{100, 50'000_px, 0.05, 300, 3});
+    risk.on_trade(1, 100_px);
+
+    std::stringstream ss;
+    auto send = [&](char side, Price px, uint32_t qty) {
+        const RiskResult r = risk.check_and_accept(1, side, px, qty);
+        ss << to_string(r) << " ";
+        return r;
+    };
+    send('B', 100_px, 100);                                  // ok: open buy 100
+    send('B', 100_px, 101);                                  // max-qty
+    risk.configure(1, InstrumentLimits{100, 5'000_px, 0.05, 300, 3});
+    send('B', 100_px, 60);                                   // max-notional (6000)
+    risk.configure(1, InstrumentLimits{100, 50'000_px, 0.05, 300, 3});
+    send('B', 106_px, 10);                                   // band
+    send('B', 100_px, 100);                                  // ok: open buy 200
+    risk.on_fill(1, 'B', 100);                              // position 100, open buy 100
+    risk.on_done(1, 'B', 0);
+    send('B', 100_px, 100);                                  // ok: worst long 300
+    send('B', 100_px, 1);                                    // position (301)
+    send('S', 100_px, 100);                                  // ok: 3rd open order, 4th message
+    send('S', 100_px, 100);                                  // open-orders
+    risk.on_done(1, 'S', 100);
+    risk.on_done(1, 'B', 100);
+    risk.on_done(1, 'B', 100);
+    send('S', 100_px, 10);                                   // ok: 5th message
+    send('S', 100_px, 10);                                   // ok: 6th
+    send('S', 100_px, 10);                                   // throttled
+    risk.kill();
+    ss << to_string(risk.check(1, 'S', 100_px, 1)) << " ";
+    risk.revive();
+    ss << to_string(risk.check(99, 'S', 100_px, 1));
+    return ss.str();
+}
+
+// ns per check on the accept path and on a reject path, over 1024 configured instruments.
+void RISK_BENCH()
+{
+    constexpr uint32_t INSTRUMENTS = 1024;
+    constexpr int N = 10'000'000;
+    RiskOptions opt;
+    opt.max_instruments = INSTRUMENTS;
+    opt.max_msgs_per_window = std::numeric_limits<uint32_t>::max();
+    RiskEngine risk(opt);
+    for (uint32_t i = 0; i < INSTRUMENTS; ++i) {
+        risk.configure(i, InstrumentLimits{1000, 1'000'000'000_px, 0.05, 1'000'000, std::numeric_limits<uint32_t>::max()});
+        risk.on_trade(i, 100_px);
+    }
+    const uint64_t now = TscClock::now_tsc();
+    auto run = [&](const char* what, Price px, uint32_t qty) {
+        uint64_t ok = 0;
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            const uint32_t instr = static_cast<uint32_t>(i * 7) & (INSTRUMENTS - 1);
+            ok += risk.check(instr, (i & 1) ? 'B' : 'S', px, qty, now) == RiskResult::Ok;
+        }
+        const auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "RISK_BENCH " << what << ": " << ns / N << " ns/check (ok=" << ok << ")\n";
+    };
+    run("pass", 100_px, 10);
+    run("reject", 200_px, 10);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) (void)risk.check_and_accept(static_cast<uint32_t>(i) & (INSTRUMENTS - 1), 'B', 100_px, 0);
+    std::cout << "RISK_BENCH check+accept (with rdtsc): "
+              << std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N << " ns\n";
+    risk.kill();
+    t0 = std::chrono::steady_clock::now();
+    uint64_t killed = 0;
+    for (int i = 0; i < N; ++i) killed += risk.check(static_cast<uint32_t>(i) & (INSTRUMENTS - 1), 'B', 100_px, 10, now) == RiskResult::Killed;
+    std::cout << "RISK_BENCH killed: "
+              << std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / N
+              << " ns/check (killed=" << killed << ")\n";
+}
@@ -0,0 +1,475 @@
+/*
+        Design notes
+
+        Zero-copy handoff between processes
+
+        The feed handler allocates a message in a pool that lives in shared memory, fills it and publishes only its
+        offset (8 bytes) to the consumer process. The consumer reads the message in place and frees it back into the
+        same pool. Nothing is copied and no syscall is made after setup.
+
+        Backing
+
+        Memfd     - anonymous, shared with children via fork() or by passing the fd (SCM_RIGHTS). No name in any fs.
+        PosixShm  - shm_open() name under /dev/shm; any process can attach by name.
+        HugeTlbFs - a file in a hugetlbfs mount (see dpdk-script.sh); attach by name, 2MB pages, no THP games.
+
+        The region is mbind()ed to the requested node and prefaulted by the creator, so pages are NUMA-local to the
+        producer. Attachers just map the already-populated pages.
+
+        Offsets, not pointers
+
+        Each process maps the region at a different address, so raw pointers in the freelist would be garbage in the
+        other process. OffsetFixedPool links free slots by slot index and keeps the head as (tag << 32 | index)
+        in one 64-bit atomic. The tag is bumped on every pop/push, which also removes the ABA hazard that FixedPool
+        only avoids by keeping alloc/free on one thread - here several processes free by design.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <numaif.h>
+
+#include "custom-allocator.h"
+
+// mount point used by dpdk-script.sh
+constexpr const char* HUGETLBFS_DIR = "/mnt/C406655E0665528A/Code-Factory/MINE/QtCreator-Projects/practice/hft-programs/huge";
+constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+enum class ShmBacking { Memfd, PosixShm, HugeTlbFs };
+
+// ---------- process-shared NUMA arena ----------
+class SharedNumaArena {
+public:
+    // Create (or truncate) a named region of `bytes` bound to `numa_node` and prefault it.
+    static SharedNumaArena create(const std::string& name, std::size_t bytes, int numa_node,
+                                  ShmBacking backing = ShmBacking::PosixShm)
+    {
+        require_numa_node(numa_node, "SharedNumaArena");
+        int fd = -1;
+        switch (backing) {
+            case ShmBacking::Memfd:
+                fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+                break;
+            case ShmBacking::PosixShm:
+                fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+                break;
+            case ShmBacking::HugeTlbFs:
+                fd = open(hugetlbfs_path(name).c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+                break;
+        }
+        if (fd < 0) throw std::runtime_error("shm create failed for " + name + ": " + strerror(errno));
+
+        const std::size_t size = round_up(bytes, backing == ShmBacking::HugeTlbFs ? HUGE_PAGE_SIZE : page_size());
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            throw std::runtime_error("ftruncate failed for " + name + ": " + strerror(errno));
+        }
+
+        SharedNumaArena a(name, backing, fd, size, numa_node);
+        a.map();
+
+        // Bind before first touch so the creator's prefault places every page on `numa_node`.
+        unsigned long nodemask = 1UL << numa_node;
+        (void)mbind(a.base_, a.size_, MPOL_BIND, &nodemask, sizeof(nodemask) * 8, 0);
+        (void)Prefault::run(a.base_, a.size_, numa_node, backing == ShmBacking::HugeTlbFs, PrefaultOptions{});
+        return a;
+    }
+
+    // Whether a named region exists (PosixShm / HugeTlbFs).
+    static bool exists(const std::string& name, ShmBacking backing = ShmBacking::PosixShm)
+    {
+        struct stat st{};
+        if (backing == ShmBacking::HugeTlbFs) return stat(hugetlbfs_path(name).c_str(), &st) == 0;
+        return stat(("/dev/shm/" + (name.starts_with('/') ? name.substr(1) : name)).c_str(), &st) == 0;
+    }
+
+    // Map an existing named region (PosixShm / HugeTlbFs). Size comes from the file itself.
+    static SharedNumaArena attach(const std::string& name, ShmBacking backing = ShmBacking::PosixShm)
+    {
+        int fd = -1;
+        if (backing == ShmBacking::PosixShm)
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+        else if (backing == ShmBacking::HugeTlbFs)
+            fd = open(hugetlbfs_path(name).c_str(), O_RDWR);
+        else
+            throw std::runtime_error("memfd regions have no name; use attach_fd()");
+        if (fd < 0) throw std::runtime_error("shm attach failed for " + name + ": " + strerror(errno));
+        return from_fd(name, backing, fd);
+    }
+
+    // Map a memfd (or any shm fd) received from another process. Takes ownership of a dup of `fd`.
+    static SharedNumaArena attach_fd(int fd)
+    {
+        int own = dup(fd);
+        if (own < 0) throw std::runtime_error(std::string("dup failed: ") + strerror(errno));
+        return from_fd("memfd", ShmBacking::Memfd, own);
+    }
+
+    // Remove the name; mappings that already exist stay valid until detached.
+    static void unlink(const std::string& name, ShmBacking backing = ShmBacking::PosixShm)
+    {
+        if (backing == ShmBacking::PosixShm) (void)shm_unlink(name.c_str());
+        else if (backing == ShmBacking::HugeTlbFs) (void)::unlink(hugetlbfs_path(name).c_str());
+    }
+
+    SharedNumaArena(SharedNumaArena&& o) noexcept
+    : name_(std::move(o.name_)), backing_(o.backing_), fd_(std::exchange(o.fd_, -1)),
+      base_(std::exchange(o.base_, nullptr)), size_(o.size_), node_(o.node_) {}
+    SharedNumaArena& operator=(SharedNumaArena&&) = delete;
+    SharedNumaArena(const SharedNumaArena&) = delete;
+    SharedNumaArena& operator=(const SharedNumaArena&) = delete;
+
+    ~SharedNumaArena() { detach(); }
+
+    // Unmap and close; the region itself lives on until every process detached and the name is unlinked.
+    void detach() noexcept {
+        if (base_) munmap(base_, size_);
+        if (fd_ >= 0) close(fd_);
+        base_ = nullptr;
+        fd_ = -1;
+    }
+
+    void* base() const noexcept { return base_; }
+    std::size_t size() const noexcept { return size_; }
+    int node() const noexcept { return node_; }
+    int fd() const noexcept { return fd_; }
+    const std::string& name() const noexcept { return name_; }
+
+    // Map every page of an attached region without writing to it (prefault would clobber existing contents).
+    void populate() noexcept { (void)madvise(base_, size_, MADV_POPULATE_WRITE); }
+
+    // Address-independent handles for anything inside the region.
+    uint64_t offset_of(const void* p) const noexcept {
+        return static_cast<uint64_t>(static_cast<const std::byte*>(p) - static_cast<const std::byte*>(base_));
+    }
+    template <class T>
+    T* at(uint64_t off) const noexcept {
+        return std::launder(reinterpret_cast<T*>(static_cast<std::byte*>(base_) + off));
+    }
+
+private:
+    SharedNumaArena(std::string name, ShmBacking backing, int fd, std::size_t size, int node)
+    : name_(std::move(name)), backing_(backing), fd_(fd), size_(size), node_(node) {}
+
+    static SharedNumaArena from_fd(const std::string& name, ShmBacking backing, int fd)
+    {
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("shm region " + name + " is empty or unreadable");
+        }
+        SharedNumaArena a(name, backing, fd, static_cast<std::size_t>(st.st_size), -1);
+        a.map();
+        int node = -1;
+        if (get_mempolicy(&node, nullptr, 0, a.base_, MPOL_F_NODE | MPOL_F_ADDR) == 0) a.node_ = node;
+        return a;
+    }
+
+    void map() {
+        void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("mmap shm failed for " + name_ + ": " + strerror(errno));
+        base_ = p;
+    }
+
+    static std::string hugetlbfs_path(const std::string& name) {
+        return std::string(HUGETLBFS_DIR) + "/" + (name.starts_with('/') ? name.substr(1) : name);
+    }
+    static std::size_t page_size() {
+        static const long ps = sysconf(_SC_PAGESIZE);
+        return static_cast<std::size_t>(ps);
+    }
+    static std::size_t round_up(std::size_t x, std::size_t a) {
+        return (x + a - 1) & ~(a - 1);
+    }
+
+    std::string name_;
+    ShmBacking backing_{ShmBacking::PosixShm};
+    int fd_{-1};
+    void* base_{nullptr};
+    std::size_t size_{0};
+    int node_{-1};
+};
+
+// ---------- Fixed-size pool with an offset-linked freelist ----------
+// Lives entirely inside a SharedNumaArena, at byte offset `at` (0 = the whole arena):
+// [ header (2 cache lines) | slot 0 | slot 1 | ... ]
+template <PoolStorable T>
+class OffsetFixedPool {
+public:
+    static constexpr uint64_t kMagic = 0x4F46465F504F4F4Cull; // "OFF_POOL"
+    static constexpr uint32_t kVersion = 1;
+
+    // Bytes a pool of `capacity` occupies, header included.
+    static constexpr std::size_t bytes_needed(uint32_t capacity) noexcept {
+        return sizeof(Header) + std::size_t{capacity} * slot_bytes();
+    }
+
+    // Format the arena (or the part of it starting at `at`) as a fresh pool. Only the creating process calls this.
+    static OffsetFixedPool create(SharedNumaArena& arena, uint32_t capacity, uint64_t at = 0)
+    {
+        if (at % CACHELINE_SIZE != 0 || at + bytes_needed(capacity) > arena.size())
+            throw std::runtime_error("Shared arena too small for requested capacity");
+
+        auto* h = new (arena.at<std::byte>(at)) Header{};
+        h->capacity = capacity;
+        h->slot_size = slot_bytes();
+        h->type_size = sizeof(T);
+        OffsetFixedPool pool(arena, at);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            pool.next_of(i) = (i + 1 < capacity) ? i + 1 : kNil;
+        }
+        h->free_head.store(capacity ? pack(0, 0) : pack(0, kNil), std::memory_order_relaxed);
+        // Publish last: attachers spin on magic before trusting anything else.
+        std::atomic_ref<uint64_t>(h->magic).store(kMagic, std::memory_order_release);
+        return pool;
+    }
+
+    // Use a pool another process (or an earlier run of this one) created in `arena` at `at`.
+    static OffsetFixedPool attach(SharedNumaArena& arena, uint64_t at = 0)
+    {
+        auto* h = arena.at<Header>(at);
+        if (std::atomic_ref<uint64_t>(h->magic).load(std::memory_order_acquire) != kMagic ||
+            h->version != kVersion || h->type_size != sizeof(T))
+            throw std::runtime_error("Shared arena does not hold a compatible OffsetFixedPool");
+        return OffsetFixedPool(arena, at);
+    }
+
+    // O(1), no syscalls. Safe from any thread of any attached process.
+    T* allocate() noexcept {
+        uint64_t head = hdr_->free_head.load(std::memory_order_acquire);
+        for (;;) {
+            const uint32_t idx = index_of(head);
+            if (idx == kNil) return nullptr;
+            const uint64_t next = pack(tag_of(head) + 1, next_of(idx));
+            if (hdr_->free_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire))
+                return std::launder(reinterpret_cast<T*>(slot(idx)));
+        }
+    }
+
+    void deallocate(T* obj) noexcept {
+        if (!obj) return;
+        const uint32_t idx = static_cast<uint32_t>((reinterpret_cast<std::byte*>(obj) - slots_) / hdr_->slot_size);
+        uint64_t head = hdr_->free_head.load(std::memory_order_acquire);
+        do {
+            next_of(idx) = index_of(head);
+        } while (!hdr_->free_head.compare_exchange_weak(head, pack(tag_of(head) + 1, idx),
+                                                        std::memory_order_acq_rel, std::memory_order_acquire));
+    }
+
+    // Handles that mean the same object in every process.
+    uint64_t to_offset(const T* obj) const noexcept { return arena_->offset_of(obj); }
+    T* from_offset(uint64_t off) const noexcept { return arena_->at<T>(off); }
+
+    uint32_t capacity() const noexcept { return hdr_->capacity; }
+    std::size_t slot_size() const noexcept { return hdr_->slot_size; }
+
+private:
+    static constexpr uint32_t kNil = 0xFFFFFFFFu;
+
+    struct CACHE_ALIGNED Header {
+        uint64_t magic{0};
+        uint32_t version{kVersion};
+        uint32_t capacity{0};
+        uint64_t slot_size{0};
+        uint64_t type_size{0};
+        CACHE_ALIGNED std::atomic<uint64_t> free_head{0};
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "cross-process CAS needs a lock-free 64-bit atomic");
+
+    OffsetFixedPool(SharedNumaArena& arena, uint64_t at)
+    : arena_(&arena), hdr_(arena.at<Header>(at)),
+      slots_(arena.at<std::byte>(at) + sizeof(Header)) {}
+
+    static constexpr std::size_t slot_bytes() noexcept {
+        return round_up(std::max(sizeof(T), sizeof(uint32_t)), CACHELINE_SIZE);
+    }
+
+    static uint64_t pack(uint32_t tag, uint32_t idx) noexcept { return (uint64_t{tag} << 32) | idx; }
+    static uint32_t tag_of(uint64_t v) noexcept { return static_cast<uint32_t>(v >> 32); }
+    static uint32_t index_of(uint64_t v) noexcept { return static_cast<uint32_t>(v); }
+
+    std::byte* slot(uint32_t idx) const noexcept { return slots_ + std::size_t{idx} * hdr_->slot_size; }
+    // Free slots store the index of the next free slot in their first 4 bytes.
+    uint32_t& next_of(uint32_t idx) const noexcept { return *reinterpret_cast<uint32_t*>(slot(idx)); }
+
+    static constexpr std::size_t round_up(std::size_t x, std::size_t a) {
+        return (x + a - 1) & ~(a - 1);
+    }
+
+    SharedNumaArena* arena_;
+    Header* hdr_;
+    std::byte* slots_;
+};
+
+// ---------- single-producer/single-consumer ring of offsets, placed in shared memory ----------
+template <std::size_t N>
+struct ShmOffsetRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+    CACHE_ALIGNED std::atomic<uint64_t> head{0};   // written by consumer
+    CACHE_ALIGNED std::atomic<uint64_t> tail{0};   // written by producer
+    CACHE_ALIGNED uint64_t slots[N];
+
+    bool push(uint64_t v) noexcept {
+        const uint64_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) return false;
+        slots[t & (N - 1)] = v;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(uint64_t& v) noexcept {
+        const uint64_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        v = slots[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+namespace SHM
+{
+    using Ring = ShmOffsetRing<4096>;
+
+    // Consumer side of the handoff: runs in the forked child, attaches both regions by name
+    // (so they land at different addresses than in the parent) and frees every message it reads.
+    [[noreturn]] inline void consume(const std::string& pool_name, const std::string& ring_name, uint64_t count)
+    {
+        auto pool_arena = SharedNumaArena::attach(pool_name);
+        auto ring_arena = SharedNumaArena::attach(ring_name);
+        auto pool = OffsetFixedPool<OrderMsg>::attach(pool_arena);
+        auto* ring = ring_arena.at<Ring>(0);
+
+        uint64_t sum = 0;
+        for (uint64_t n = 0; n < count; ) {
+            uint64_t off;
+            if (!ring->pop(off)) continue;
+            OrderMsg* m = pool.from_offset(off);
+            sum += m->order_id + m->qty;
+            pool.deallocate(m);
+            ++n;
+        }
+        // hand the checksum back through the ring's spare first slot
+        *ring_arena.at<uint64_t>(sizeof(Ring)) = sum;
+        _exit(0);
+    }
+}
+
+// Parent allocates in the shared pool and passes offsets; the child attaches by name, reads in place and frees.
+// Returns "ok" when the child saw every message and the pool is whole again.
+std::string SHM_POOL_Test()
+{
+    const std::string pool_name = "/hft-shm-pool-test";
+    const std::string ring_name = "/hft-shm-ring-test";
+    constexpr uint32_t CAP = 1024;
+    constexpr uint64_t COUNT = 100'000;
+
+    auto pool_arena = SharedNumaArena::create(pool_name, 1ULL * 1024 * 1024, 0);
+    auto ring_arena = SharedNumaArena::create(ring_name, sizeof(SHM::Ring) + CACHELINE_SIZE, 0);
+    auto pool = OffsetFixedPool<OrderMsg>::create(pool_arena, CAP);
+    auto* ring = new (ring_arena.base()) SHM::Ring{};
+
+    pid_t pid = fork();
+    if (pid == 0) SHM::consume(pool_name, ring_name, COUNT);
+
+    uint64_t expect = 0;
+    for (uint64_t i = 0; i < COUNT; ++i) {
+        OrderMsg* m;
+        while (!(m = pool.allocate())) {}                // child frees concurrently
+        m->order_id = i;
+        m->qty = static_cast<uint32_t>(i & 0xFF);
+        expect += m->order_id + m->qty;
+        while (!ring->push(pool.to_offset(m))) {}
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    const uint64_t got = *ring_arena.at<uint64_t>(sizeof(SHM::Ring));
+    uint32_t reclaimed = 0;
+    while (pool.allocate()) ++reclaimed;
+
+    SharedNumaArena::unlink(pool_name);
+    SharedNumaArena::unlink(ring_name);
+
+    if (!WIFEXITED(status) || got != expect) return "checksum mismatch";
+    if (reclaimed != CAP) return "leaked " + std::to_string(CAP - reclaimed);
+    return "ok";
+}
+
+// Zero-copy offset handoff through shared memory vs copying the same message through a socketpair.
+void SHM_POOL_BENCH()
+{
+    const std::string pool_name = "/hft-shm-pool-bench";
+    const std::string ring_name = "/hft-shm-ring-bench";
+    constexpr uint64_t COUNT = 2'000'000;
+
+    auto pool_arena = SharedNumaArena::create(pool_name, 8ULL * 1024 * 1024, 0);
+    auto ring_arena = SharedNumaArena::create(ring_name, sizeof(SHM::Ring) + CACHELINE_SIZE, 0);
+    auto pool = OffsetFixedPool<OrderMsg>::create(pool_arena, 64 * 1024);
+    auto* ring = new (ring_arena.base()) SHM::Ring{};
+
+    auto t0 = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) SHM::consume(pool_name, ring_name, COUNT);
+    for (uint64_t i = 0; i < COUNT; ++i) {
+        OrderMsg* m;
+        while (!(m = pool.allocate())) {}
+        m->order_id = i;
+        m->qty = 1;
+        while (!ring->push(pool.to_offset(m))) {}
+    }
+    waitpid(pid, nullptr, 0);
+    auto t1 = std::chrono::steady_clock::now();
+
+    SharedNumaArena::unlink(pool_name);
+    SharedNumaArena::unlink(ring_name);
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) { perror("socketpair"); return; }
+    auto t2 = std::chrono::steady_clock::now();
+    pid = fork();
+    if (pid == 0) {
+        close(sv[0]);
+        OrderMsg m;
+        uint64_t sum = 0;
+        for (uint64_t n = 0; n < COUNT; ++n) {
+            std::size_t got = 0;
+            while (got < sizeof(m)) {
+                ssize_t r = read(sv[1], reinterpret_cast<char*>(&m) + got, sizeof(m) - got);
+                if (r <= 0) _exit(1);
+                got += static_cast<std::size_t>(r);
+            }
+            sum += m.order_id;
+        }
+        _exit(sum == 0);
+    }
+    close(sv[1]);
+    OrderMsg m{};
+    for (uint64_t i = 0; i < COUNT; ++i) {
+        m.order_id = i;
+        m.qty = 1;
+        if (write(sv[0], &m, sizeof(m)) != sizeof(m)) break;
+    }
+    waitpid(pid, nullptr, 0);
+    auto t3 = std::chrono::steady_clock::now();
+    close(sv[0]);
+
+    auto ns = [](auto d) { return std::chrono::duration<double, std::nano>(d).count() / COUNT; };
+    std::cout << "SHM_POOL_BENCH " << COUNT << " x " << sizeof(OrderMsg) << "B messages\n"
+              << "  shared pool offset handoff : " << ns(t1 - t0) << " ns/msg\n"
+              << "  socketpair copy            : " << ns(t3 - t2) << " ns/msg\n";
+}
@@ -0,0 +1,399 @@
+/*
+        Design notes
+
+        SIMD price-level search for L2 books
+
+        An L2 (price-aggregated) feed sends "level at price p is now q" and nothing else, so every update starts
+        by finding p among the side's levels. The old way was a binary search over sorted doubles: about log2(n)
+        unpredictable branches, and each one waits on a float compare. Almost all the updates land within a few
+        levels of the touch.
+
+        - prices are fixed-point: int32 ticks. Each side keeps its nearest DENSE levels in a small sorted array of
+          keys (bids are stored as -tick, so both sides sort best-first ascending and share one search) with the
+          quantities alongside.
+        - the search counts keys below the target 8 at a time (AVX2 vpcmpgtd + movemask) or 4 at a time (SSE2),
+          front to back, and stops at the first block that is not all below. A touch update costs one or two
+          compares and a predictable loop exit. The same count is the insertion point. The key array is padded
+          with INT32_MAX up to a whole block past DENSE, so blocks never need a tail case.
+        - insert and delete memmove at most DENSE entries: 256 bytes of keys and 512 of quantities, all in L1.
+        - sparse fallback: levels beyond the DENSE best go to a sorted vector, stored worst-first so evicting the
+          dense array's last level or refilling it is a push_back/pop_back, and searched with std::lower_bound.
+          A wide, gappy book only pays the binary search for its tail. The vector is reserved up front and only
+          allocates past the reserve.
+        - qty 0 deletes the level. Deleting a level that is not there, a side other than 'B'/'S', or a tick
+          outside (0, INT32_MAX) returns false and changes nothing.
+        - SortedL2Book is the double / binary search book this replaces, kept as the reference the test checks
+          against and the baseline in the benchmark.
+
+        The book searches with AVX2 when the build enables it (CMake HFT_AVX2, on by default: -mavx2), otherwise
+        with SSE2, which every x86-64 has. Both searches are always compiled (the AVX2 one as a target("avx2")
+        function), so the test checks each against std::lower_bound on any host with AVX2, whatever the build.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+struct L2Level {
+    int32_t tick;
+    uint64_t qty;
+};
+
+// ---------- search ----------
+namespace l2_detail {
+
+// Key arrays are padded to a whole AVX2 block (two SSE2 ones) past their last key, whichever search reads them.
+inline constexpr uint32_t BLOCK = 8;
+
+// Number of keys below k in key[0, n): key is sorted ascending, 32-byte aligned and padded with INT32_MAX to a
+// whole block past n. One version per instruction set; rank() is the one the build targets.
+inline uint32_t rank_scalar(const int32_t* key, uint32_t n, int32_t k) noexcept {
+    for (uint32_t i = 0; i < n; ++i)
+        if (key[i] >= k) return i;
+    return n;
+}
+
+#if defined(__SSE2__)
+inline uint32_t rank_sse2(const int32_t* key, uint32_t n, int32_t k) noexcept {
+    const __m128i vk = _mm_set1_epi32(k);
+    for (uint32_t i = 0; i < n; i += 4) {
+        const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(key + i));
+        const auto below = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(vk, v))));
+        if (below != 0xF) return i + static_cast<uint32_t>(std::countr_one(below));
+    }
+    return n;
+}
+
+// Callable from any build; only on a CPU with AVX2 (has_avx2()).
+__attribute__((target("avx2"))) inline uint32_t rank_avx2(const int32_t* key, uint32_t n, int32_t k) noexcept {
+    const __m256i vk = _mm256_set1_epi32(k);
+    for (uint32_t i = 0; i < n; i += 8) {
+        const __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i*>(key + i));
+        const auto below = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(vk, v))));
+        if (below != 0xFF) return i + static_cast<uint32_t>(std::countr_one(below));
+    }
+    return n;
+}
+
+inline bool has_avx2() noexcept { return __builtin_cpu_supports("avx2"); }
+#else
+inline bool has_avx2() noexcept { return false; }
+#endif
+
+inline uint32_t rank(const int32_t* key, uint32_t n, int32_t k) noexcept {
+#if defined(__AVX2__)
+    return rank_avx2(key, n, k);
+#elif defined(__SSE2__)
+    return rank_sse2(key, n, k);
+#else
+    return rank_scalar(key, n, k);
+#endif
+}
+
+} // namespace l2_detail
+
+class SimdL2Book {
+public:
+    static constexpr uint32_t DENSE = 64;
+
+    explicit SimdL2Book(std::size_t sparse_reserve = 1024) {
+        for (Side* s : {&bids_, &asks_}) {
+            std::fill(std::begin(s->key), std::end(s->key), INT32_MAX);
+            s->sparse.reserve(sparse_reserve);
+        }
+    }
+
+    // Set the level at `tick` to qty; 0 deletes it.
+    bool update(char side, int32_t tick, uint64_t qty) noexcept {
+        if ((side != 'B' && side != 'S') || tick <= 0 || tick == INT32_MAX) [[unlikely]] return false;
+        Side& s = side == 'B' ? bids_ : asks_;
+        const int32_t k = side == 'B' ? -tick : tick;
+        const uint32_t i = l2_detail::rank(s.key, s.n, k);
+        if (i < s.n && s.key[i] == k) [[likely]] {
+            if (qty) s.qty[i] = qty;
+            else erase(s, i);
+            return true;
+        }
+        if (i == DENSE) [[unlikely]] return update_sparse(s, k, qty);
+        if (!qty) return false;
+        if (s.n == DENSE) {
+            s.sparse.push_back(Entry{s.key[DENSE - 1], s.qty[DENSE - 1]});
+            --s.n;
+        }
+        std::memmove(s.key + i + 1, s.key + i, (s.n - i) * sizeof(int32_t));
+        std::memmove(s.qty + i + 1, s.qty + i, (s.n - i) * sizeof(uint64_t));
+        s.key[i] = k;
+        s.qty[i] = qty;
+        ++s.n;
+        return true;
+    }
+
+    // Best level; qty 0 when the side is empty.
+    L2Level best(char side) const noexcept {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        return s.n ? L2Level{tick_of(side, s.key[0]), s.qty[0]} : L2Level{0, 0};
+    }
+
+    // Qty at a price, 0 if there is no level there.
+    uint64_t qty_at(char side, int32_t tick) const noexcept {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        const int32_t k = side == 'B' ? -tick : tick;
+        const uint32_t i = l2_detail::rank(s.key, s.n, k);
+        if (i < s.n) return s.key[i] == k ? s.qty[i] : 0;
+        const auto it = std::lower_bound(s.sparse.begin(), s.sparse.end(), k, worse_first);
+        return it != s.sparse.end() && it->key == k ? it->qty : 0;
+    }
+
+    // Up to n levels, best first. Returns how many were written.
+    std::size_t depth(char side, L2Level* out, std::size_t n) const noexcept {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        std::size_t k = 0;
+        for (uint32_t i = 0; i < s.n && k < n; ++i) out[k++] = L2Level{tick_of(side, s.key[i]), s.qty[i]};
+        for (auto it = s.sparse.rbegin(); it != s.sparse.rend() && k < n; ++it) out[k++] = L2Level{tick_of(side, it->key), it->qty};
+        return k;
+    }
+
+    std::size_t levels(char side) const noexcept {
+        const Side& s = side == 'B' ? bids_ : asks_;
+        return s.n + s.sparse.size();
+    }
+
+private:
+    struct Entry {
+        int32_t key;
+        uint64_t qty;
+    };
+
+    struct Side {
+        alignas(32) int32_t key[DENSE + l2_detail::BLOCK];
+        uint64_t qty[DENSE];
+        uint32_t n = 0;
+        std::vector<Entry> sparse;      // levels past the DENSE best, worst first
+    };
+
+    static bool worse_first(const Entry& e, int32_t k) noexcept { return e.key > k; }
+    static int32_t tick_of(char side, int32_t key) noexcept { return side == 'B' ? -key : key; }
+
+    // Remove dense level i and refill the array from the sparse levels.
+    static void erase(Side& s, uint32_t i) noexcept {
+        --s.n;
+        std::memmove(s.key + i, s.key + i + 1, (s.n - i) * sizeof(int32_t));
+        std::memmove(s.qty + i, s.qty + i + 1, (s.n - i) * sizeof(uint64_t));
+        s.key[s.n] = INT32_MAX;
+        if (s.sparse.empty()) return;
+        s.key[s.n] = s.sparse.back().key;
+        s.qty[s.n] = s.sparse.back().qty;
+        ++s.n;
+        s.sparse.pop_back();
+    }
+
+    // k is worse than every dense level and the dense array is full.
+    static bool update_sparse(Side& s, int32_t k, uint64_t qty) noexcept {
+        const auto it = std::lower_bound(s.sparse.begin(), s.sparse.end(), k, worse_first);
+        if (it != s.sparse.end() && it->key == k) {
+            if (qty) it->qty = qty;
+            else s.sparse.erase(it);
+            return true;
+        }
+        if (!qty) return false;
+        s.sparse.insert(it, Entry{k, qty});
+        return true;
+    }
+
+    Side bids_;
+    Side asks_;
+};
+
+// ---------- reference ----------
+// Sorted vector of double prices per side, best first, found with std::lower_bound.
+class SortedL2Book {
+public:
+    bool update(char side, double px, uint64_t qty) {
+        if (side != 'B' && side != 'S') return false;
+        auto& v = side == 'B' ? bids_ : asks_;
+        const auto it = side == 'B' ? std::lower_bound(v.begin(), v.end(), px, [](const Level& l, double p) { return l.px > p; })
+                                    : std::lower_bound(v.begin(), v.end(), px, [](const Level& l, double p) { return l.px < p; });
+        if (it != v.end() && it->px == px) {
+            if (qty) it->qty = qty;
+            else v.erase(it);
+            return true;
+        }
+        if (!qty) return false;
+        v.insert(it, Level{px, qty});
+        return true;
+    }
+
+    std::size_t depth(char side, L2Level* out, std::size_t n, uint32_t ticks_per_unit) const {
+        const auto& v = side == 'B' ? bids_ : asks_;
+        std::size_t k = 0;
+        for (; k < v.size() && k < n; ++k) out[k] = L2Level{static_cast<int32_t>(std::llround(v[k].px * ticks_per_unit)), v[k].qty};
+        return k;
+    }
+
+private:
+    struct Level {
+        double px;
+        uint64_t qty;
+    };
+    std::vector<Level> bids_;
+    std::vector<Level> asks_;
+};
+
+// ---------- synthetic updates ----------
+namespace l2_detail {
+
+struct L2Update {
+    char side;
+    int32_t tick;
+    double price;
+    uint64_t qty;
+};
+
+// How far from the touch updates land: levels `spacing` ticks apart (1 = every tick populated), distance in
+// levels geometric with parameter p (higher p = more concentrated at the touch).
+struct DepthProfile {
+    const char* name;
+    double p;
+    int spacing;
+};
+
+inline constexpr DepthProfile PROFILES[] = {
+    {"touch-heavy", 0.35, 1},      // liquid large cap: most updates in the top 3 levels
+    {"typical", 0.08, 1},          // activity spread over the top ~30 levels
+    {"sparse", 0.02, 7},           // wide, gappy book: hundreds of levels, many past the dense array
+};
+
+// A third of updates delete a level; the mid walks a tick every 256 updates.
+inline std::vector<L2Update> make_updates(std::size_t n, uint64_t seed, const DepthProfile& prof) {
+    std::mt19937_64 rng(seed);
+    std::geometric_distribution<int> away(prof.p);
+    std::vector<L2Update> up;
+    up.reserve(n);
+    int32_t mid = 100000;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i % 256 == 0) mid += rng() & 1 ? 1 : -1;
+        const char side = rng() & 1 ? 'B' : 'S';
+        const int32_t off = 1 + std::min(away(rng), 2000) * prof.spacing;
+        const int32_t tick = side == 'B' ? mid - off : mid + off;
+        const uint64_t qty = rng() % 3 == 0 ? 0 : 100 * (1 + rng() % 50);
+        up.push_back(L2Update{side, tick, tick / 100.0, qty});
+    }
+    return up;
+}
+
+} // namespace l2_detail
+
+// Levels insert, update and delete in price order on both sides; the dense array spills to and refills from the
+// sparse levels; every block search the host can run agrees with std::lower_bound; random updates on every
+// profile give the same book as the double/binary search one.
+std::string SIMD_L2_BOOK_Test()
+{
+    std::stringstream ss;
+    SimdL2Book b;
+    L2Level lv[8];
+    auto show = [&](char side) {
+        std::string s;
+        const std::size_t k = b.depth(side, lv, 8);
+        for (std::size_t i = 0; i < k; ++i) s += (i ? "," : "") + std::to_string(lv[i].tick) + "x" + std::to_string(lv[i].qty);
+        return s;
+    };
+    b.update('B', 9999, 10);
+    b.update('B', 10000, 5);
+    b.update('B', 9990, 7);
+    b.update('S', 10002, 3);
+    b.update('S', 10001, 4);
+    ss << "bids=" << show('B') << " asks=" << show('S');
+    b.update('B', 9999, 12);
+    b.update('S', 10001, 0);
+    ss << " bids=" << show('B') << " asks=" << show('S');
+    ss << " unknown=" << !b.update('S', 10005, 0) << " bad-tick=" << !b.update('B', 0, 1) << " at=" << b.qty_at('B', 9990);
+
+    // Fill past DENSE: the worst levels spill to the sparse vector, and come back as better levels go.
+    SimdL2Book deep;
+    for (int32_t t = 1; t <= 100; ++t) deep.update('S', 1000 + t, static_cast<uint64_t>(t));
+    for (int32_t t = 1; t <= 50; ++t) deep.update('S', 1000 + t, 0);
+    ss << " spill=" << deep.levels('S') << "/" << deep.best('S').tick << "/" << deep.qty_at('S', 1100);
+
+    std::mt19937 rng(3);
+    bool rank_ok = true;
+    alignas(32) int32_t key[SimdL2Book::DENSE + l2_detail::BLOCK];
+    for (int r = 0; r < 2000; ++r) {
+        const uint32_t n = rng() % (SimdL2Book::DENSE + 1);
+        std::fill(std::begin(key), std::end(key), INT32_MAX);
+        for (uint32_t i = 0; i < n; ++i) key[i] = static_cast<int32_t>(rng() % 200) - 100;
+        std::sort(key, key + n);
+        const int32_t k = static_cast<int32_t>(rng() % 220) - 110;
+        const auto want = static_cast<uint32_t>(std::lower_bound(key, key + n, k) - key);
+        rank_ok &= l2_detail::rank(key, n, k) == want && l2_detail::rank_scalar(key, n, k) == want;
+#if defined(__SSE2__)
+        rank_ok &= l2_detail::rank_sse2(key, n, k) == want;
+        if (l2_detail::has_avx2()) rank_ok &= l2_detail::rank_avx2(key, n, k) == want;
+#endif
+    }
+    ss << " rank=" << rank_ok;
+
+    bool agree = true;
+    std::size_t spilled = 0;
+    for (const auto& prof : l2_detail::PROFILES) {
+        SimdL2Book fast;
+        SortedL2Book ref;
+        std::vector<L2Level> x(1000), y(1000);
+        std::size_t i = 0;
+        for (const auto& u : l2_detail::make_updates(100000, 9, prof)) {
+            agree &= fast.update(u.side, u.tick, u.qty) == ref.update(u.side, u.price, u.qty);
+            if (++i % 500) continue;
+            spilled = std::max(spilled, fast.levels('B'));
+            for (char side : {'B', 'S'}) {
+                const std::size_t k = fast.depth(side, x.data(), x.size());
+                agree &= k == ref.depth(side, y.data(), y.size(), 100);
+                for (std::size_t j = 0; j < k; ++j) agree &= x[j].tick == y[j].tick && x[j].qty == y[j].qty;
+            }
+        }
+    }
+    ss << " reference=" << (agree && spilled > SimdL2Book::DENSE);
+    return ss.str();
+}
+
+// L2 updates per second on one core, block search over ticks vs binary search over doubles, per depth profile.
+void SIMD_L2_BOOK_BENCH()
+{
+    constexpr std::size_t N = 4'000'000;
+    uint64_t sink = 0;
+    std::cout << "SIMD_L2_BOOK_BENCH "
+#if defined(__AVX2__)
+              << "AVX2"
+#else
+              << "SSE2"
+#endif
+              << ":";
+    for (const auto& prof : l2_detail::PROFILES) {
+        const auto up = l2_detail::make_updates(N, 42, prof);
+        SimdL2Book fast;
+        SortedL2Book ref;
+        auto t0 = std::chrono::steady_clock::now();
+        for (const auto& u : up) sink += fast.update(u.side, u.tick, u.qty);
+        const double simd = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        t0 = std::chrono::steady_clock::now();
+        for (const auto& u : up) sink += ref.update(u.side, u.price, u.qty);
+        const double bsearch = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << " " << prof.name << " (" << fast.levels('B') + fast.levels('S') << " levels) " << N / simd / 1e6
+                  << " vs " << N / bsearch / 1e6 << " M updates/s;";
+    }
+    std::cout << " (sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,82 @@
+/*
+        Design notes
+
+        Bounded single-producer/single-consumer ring, the building block for per-thread queues (logger, per-core
+        order queues) and the baseline the Disruptor ring is compared against.
+
+        - N is a power of two; head/tail are free-running 64-bit counters, masked on access (no wrap handling).
+        - producer and consumer indices sit on separate cache lines; each side also keeps a cached copy of the
+          other side's index, so the shared line is only read when the cached value says full/empty.
+        - one release store per push/pop, no RMW instructions.
+        - slots are constructed in place via emplace/claim so large records are written once, not copied.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#include "custom-allocator.h"
+
+template <class T, std::size_t N>
+class SpscRing {
+    static_assert((N & (N - 1)) == 0, "N must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "slots are reused without destruction");
+
+public:
+    // Producer: copy `v` in. False if full.
+    bool try_push(const T& v) noexcept {
+        T* slot = claim();
+        if (!slot) return false;
+        *slot = v;
+        publish();
+        return true;
+    }
+
+    // Producer, two-phase: write straight into the slot, then publish(). nullptr if full.
+    T* claim() noexcept {
+        const uint64_t t = tail_.load(std::memory_order_relaxed);
+        if (t - head_cache_ == N) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (t - head_cache_ == N) return nullptr;
+        }
+        return &slots_[t & (N - 1)];
+    }
+    void publish() noexcept { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Consumer: copy the oldest element out. False if empty.
+    bool try_pop(T& out) noexcept {
+        const T* slot = front();
+        if (!slot) return false;
+        out = *slot;
+        pop();
+        return true;
+    }
+
+    // Consumer, two-phase: read in place, then pop(). nullptr if empty.
+    const T* front() noexcept {
+        const uint64_t h = head_.load(std::memory_order_relaxed);
+        if (h == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (h == tail_cache_) return nullptr;
+        }
+        return &slots_[h & (N - 1)];
+    }
+    void pop() noexcept { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // Approximate, for monitors.
+    std::size_t size() const noexcept {
+        return static_cast<std::size_t>(tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire));
+    }
+    static constexpr std::size_t capacity() noexcept { return N; }
+
+private:
+    CACHE_ALIGNED std::atomic<uint64_t> tail_{0};   // producer line
+    uint64_t head_cache_{0};
+    CACHE_ALIGNED std::atomic<uint64_t> head_{0};   // consumer line
+    uint64_t tail_cache_{0};
+    CACHE_ALIGNED T slots_[N];
+};
@@ -0,0 +1,29 @@
+/*
+        Design notes
+
+        Market data wire format
+
+        TickerData is what the feed multicasts, back to back in each datagram: a packed little-endian struct, decoded
+        with one unaligned load per field. It lives here, apart from any receiver, so the DPDK feed handler, the
+        exchange simulator and tests share it.
+
+        The price stays a double on the wire: recorded captures (ticker_packet.bin) fix the layout. Decoders turn it
+        into a Price once, with ticker_price(), and nothing downstream sees the double. A tick whose double is not
+        a price is dropped and counted by the decoder, never passed on with a made-up value.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#include "fixed-price.h"
+
+struct TickerData {
+    uint64_t ts_ns;
+    uint32_t instr_id;
+    double price;
+    uint32_t qty;
+} __attribute__((__packed__));
+
+// False, and p untouched, if the wire double is not a price (NaN, infinite, out of range).
+inline bool ticker_price(const TickerData& t, Price& p) noexcept { return Price::from_double(t.price, p); }
@@ -0,0 +1,311 @@
+/*
+        Design notes
+
+        One clock for every component
+
+        RX, decode, risk, send and the logger all stamp with the raw TSC: one rdtsc, no syscall, no vDSO page, and
+        stamps taken on different cores are directly comparable. Converting ticks to nanoseconds is deferred to
+        whoever needs a number (latency histograms, the logger's cold thread).
+
+        - invariant TSC (CPUID 0x80000007 EDX bit 8) means the counter runs at a constant rate through P/C-states
+          and is synchronised across cores. Without it TSC deltas are not time; we warn, or refuse if asked to.
+        - calibration: (tsc, CLOCK_MONOTONIC_RAW) pairs are sampled with the tightest rdtsc bracket out of a few
+          tries, so a preemption between the two reads does not skew the pair. Startup takes two pairs a few ms
+          apart; MONOTONIC_RAW is used because NTP does not slew it.
+        - conversion is fixed point: ns = base_ns + ((tsc - base_tsc) * mult) >> 32. No division, no double.
+        - a background thread re-samples periodically. The rate is re-estimated over the whole baseline since
+          start-up (more accurate the longer we run) and any offset error is slewed out over the next period,
+          never stepped, so tsc_to_ns() stays monotonic across updates.
+        - parameters are published through a seqlock. Readers never write shared memory and never block; they
+          only retry if they raced the (once per period) writer.
+        - wall clock is CLOCK_REALTIME - CLOCK_MONOTONIC_RAW, re-measured at every resync, so NTP steps show up
+          after at most one period without disturbing the monotonic timeline.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#include "custom-allocator.h"
+
+struct TscClockOptions {
+    std::chrono::milliseconds calibrate_for{20};     // startup baseline
+    std::chrono::milliseconds resync_every{1000};    // background period; 0 disables the thread
+    bool require_invariant = false;                  // throw instead of warn when the TSC is not invariant
+};
+
+class TscClock {
+public:
+    // Process-wide clock, calibrated on first use.
+    static TscClock& instance() {
+        static TscClock clock;
+        return clock;
+    }
+
+    explicit TscClock(TscClockOptions opt = {}) : opt_(opt)
+    {
+        invariant_ = invariant_tsc();
+        if (!invariant_) {
+            if (opt_.require_invariant) throw std::runtime_error("TscClock: TSC is not invariant");
+            std::cerr << "TscClock: TSC is not invariant, timestamps across cores/P-states are unreliable\n";
+        }
+        origin_ = sample();
+        std::this_thread::sleep_for(opt_.calibrate_for);
+        const Sample s = sample();
+        const uint64_t mult = rate_mult(origin_, s);
+        if (mult == 0) throw std::runtime_error("TscClock: calibration failed");
+        publish(Params{s.tsc, s.mono_ns, mult, s.wall_off_ns});
+
+        if (opt_.resync_every.count() > 0) worker_ = std::thread([this] { run(); });
+    }
+
+    TscClock(const TscClock&) = delete;
+    TscClock& operator=(const TscClock&) = delete;
+
+    ~TscClock() {
+        {
+            std::lock_guard lk(stop_mutex_);
+            stop_ = true;
+        }
+        stop_cv_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    // ---------- hot side ----------
+    static uint64_t now_tsc() noexcept { return __rdtsc(); }
+
+    // TSC -> CLOCK_MONOTONIC_RAW nanoseconds.
+    uint64_t tsc_to_ns(uint64_t tsc) const noexcept {
+        const Params p = read();
+        return to_ns(p, tsc);
+    }
+
+    // TSC -> CLOCK_REALTIME nanoseconds since the epoch.
+    uint64_t tsc_to_wall_ns(uint64_t tsc) const noexcept {
+        const Params p = read();
+        return static_cast<uint64_t>(static_cast<int64_t>(to_ns(p, tsc)) + p.wall_off_ns);
+    }
+
+    uint64_t now_ns() const noexcept { return tsc_to_ns(now_tsc()); }
+    uint64_t now_wall_ns() const noexcept { return tsc_to_wall_ns(now_tsc()); }
+
+    // Tick deltas (latencies) need no base, just the rate.
+    uint64_t ticks_to_ns(uint64_t ticks) const noexcept {
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(ticks) * read().mult) >> 32);
+    }
+
+    // ---------- monitoring / control ----------
+    bool invariant() const noexcept { return invariant_; }
+    double ticks_per_ns() const noexcept { return 4294967296.0 / static_cast<double>(read().mult); }
+    uint64_t resyncs() const noexcept { return resyncs_.load(std::memory_order_relaxed); }
+    int64_t last_error_ns() const noexcept { return last_error_ns_.load(std::memory_order_relaxed); }
+
+    // Re-sample against CLOCK_MONOTONIC_RAW now (the background thread calls this every resync_every).
+    void resync() {
+        std::lock_guard lk(writer_mutex_);
+        const Sample s = sample();
+        const Params cur = read();
+        const uint64_t ours = to_ns(cur, s.tsc);
+        const int64_t err = static_cast<int64_t>(s.mono_ns - ours);
+
+        // Long-baseline rate, then bend it so the offset error is gone one period from now.
+        const uint64_t rate = rate_mult(origin_, s);
+        const uint64_t period_ticks = static_cast<uint64_t>(
+            static_cast<double>(std::chrono::nanoseconds(opt_.resync_every).count()) * 4294967296.0 /
+            static_cast<double>(rate ? rate : cur.mult));
+        int64_t mult = static_cast<int64_t>(rate ? rate : cur.mult);
+        if (period_ticks) mult += static_cast<int64_t>((static_cast<__int128>(err) << 32) / period_ticks);
+        // never let the slew stop or reverse the clock
+        mult = std::max<int64_t>(mult, static_cast<int64_t>(cur.mult / 2));
+
+        publish(Params{s.tsc, ours, static_cast<uint64_t>(mult), s.wall_off_ns});
+        last_error_ns_.store(err, std::memory_order_relaxed);
+        resyncs_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // CPUID.80000007H:EDX[8]
+    static bool invariant_tsc() noexcept {
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u) return false;
+        __cpuid(0x80000007u, eax, ebx, ecx, edx);
+        return (edx >> 8) & 1u;
+    }
+
+private:
+    struct Sample {
+        uint64_t tsc;
+        uint64_t mono_ns;
+        int64_t wall_off_ns;
+    };
+
+    struct Params {
+        uint64_t base_tsc;
+        uint64_t base_ns;
+        uint64_t mult;          // ns per tick, 32.32 fixed point
+        int64_t wall_off_ns;    // REALTIME - MONOTONIC_RAW
+    };
+
+    static uint64_t to_ns(const Params& p, uint64_t tsc) noexcept {
+        // signed: a stamp taken just before the last resync may be converted just after it
+        const int64_t d = static_cast<int64_t>(tsc - p.base_tsc);
+        const __int128 ns = (static_cast<__int128>(d) * static_cast<__int128>(p.mult)) >> 32;
+        return static_cast<uint64_t>(static_cast<int64_t>(p.base_ns) + static_cast<int64_t>(ns));
+    }
+
+    static uint64_t ts_ns(const timespec& ts) noexcept {
+        return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000ull + static_cast<uint64_t>(ts.tv_nsec);
+    }
+
+    // (tsc, MONOTONIC_RAW) pair with the tightest bracket out of a few tries.
+    static Sample sample() noexcept {
+        Sample best{};
+        uint64_t best_window = ~0ull;
+        for (int i = 0; i < 16; ++i) {
+            timespec mono{}, wall{};
+            const uint64_t t0 = __rdtsc();
+            clock_gettime(CLOCK_MONOTONIC_RAW, &mono);
+            const uint64_t t1 = __rdtsc();
+            clock_gettime(CLOCK_REALTIME, &wall);
+            if (t1 - t0 < best_window) {
+                best_window = t1 - t0;
+                best.tsc = t0 + (t1 - t0) / 2;
+                best.mono_ns = ts_ns(mono);
+                best.wall_off_ns = static_cast<int64_t>(ts_ns(wall) - ts_ns(mono));
+            }
+        }
+        return best;
+    }
+
+    static uint64_t rate_mult(const Sample& a, const Sample& b) noexcept {
+        if (b.tsc <= a.tsc) return 0;
+        return static_cast<uint64_t>((static_cast<unsigned __int128>(b.mono_ns - a.mono_ns) << 32) / (b.tsc - a.tsc));
+    }
+
+    // ---------- seqlock ----------
+    Params read() const noexcept {
+        Params p;
+        uint32_t s0, s1;
+        do {
+            s0 = seq_.load(std::memory_order_acquire);
+            p.base_tsc = base_tsc_.load(std::memory_order_relaxed);
+            p.base_ns = base_ns_.load(std::memory_order_relaxed);
+            p.mult = mult_.load(std::memory_order_relaxed);
+            p.wall_off_ns = wall_off_ns_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            s1 = seq_.load(std::memory_order_relaxed);
+        } while ((s0 & 1u) || s0 != s1);
+        return p;
+    }
+
+    void publish(const Params& p) noexcept {
+        const uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        base_tsc_.store(p.base_tsc, std::memory_order_relaxed);
+        base_ns_.store(p.base_ns, std::memory_order_relaxed);
+        mult_.store(p.mult, std::memory_order_relaxed);
+        wall_off_ns_.store(p.wall_off_ns, std::memory_order_relaxed);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    void run() {
+        std::unique_lock lk(stop_mutex_);
+        while (!stop_cv_.wait_for(lk, opt_.resync_every, [this] { return stop_; })) {
+            lk.unlock();
+            resync();
+            lk.lock();
+        }
+    }
+
+    // read-mostly line: every hot thread reads it, the resync thread writes it once per period
+    CACHE_ALIGNED std::atomic<uint32_t> seq_{0};
+    std::atomic<uint64_t> base_tsc_{0};
+    std::atomic<uint64_t> base_ns_{0};
+    std::atomic<uint64_t> mult_{0};
+    std::atomic<int64_t> wall_off_ns_{0};
+
+    CACHE_ALIGNED TscClockOptions opt_;
+    bool invariant_{false};
+    Sample origin_{};
+    std::atomic<uint64_t> resyncs_{0};
+    std::atomic<int64_t> last_error_ns_{0};
+
+    std::mutex writer_mutex_;
+    std::mutex stop_mutex_;
+    std::condition_variable stop_cv_;
+    bool stop_{false};
+    std::thread worker_;
+};
+
+// Checks agreement with the kernel clocks and monotonicity across forced resyncs.
+std::string TSC_CLOCK_Test()
+{
+    TscClockOptions opt;
+    opt.resync_every = std::chrono::milliseconds(5);
+    TscClock clock(opt);
+
+    auto mono_raw = [] { timespec ts{}; clock_gettime(CLOCK_MONOTONIC_RAW, &ts); return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec; };
+    auto realtime = [] { timespec ts{}; clock_gettime(CLOCK_REALTIME, &ts); return int64_t(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec; };
+
+    bool monotonic = true;
+    int64_t worst = 0, worst_wall = 0;
+    uint64_t prev = 0;
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(60);
+    while (std::chrono::steady_clock::now() < until) {
+        for (int i = 0; i < 1000; ++i) {
+            const uint64_t ns = clock.now_ns();
+            monotonic &= ns >= prev;
+            prev = ns;
+        }
+        worst = std::max(worst, std::abs(static_cast<int64_t>(clock.now_ns()) - mono_raw()));
+        worst_wall = std::max(worst_wall, std::abs(static_cast<int64_t>(clock.now_wall_ns()) - realtime()));
+        clock.resync();
+    }
+
+    const uint64_t t0 = TscClock::now_tsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const uint64_t ms = clock.ticks_to_ns(TscClock::now_tsc() - t0) / 1'000'000;
+
+    std::cout << "TSC_CLOCK invariant=" << clock.invariant() << " ticks/ns=" << clock.ticks_per_ns()
+              << " worst mono err=" << worst << "ns wall err=" << worst_wall << "ns resyncs=" << clock.resyncs() << "\n";
+    std::stringstream ss;
+    // 50us covers a preempted sample on a loaded CI box; a bad rate would be off by milliseconds
+    ss << "monotonic=" << monotonic << " mono-ok=" << (worst < 50'000) << " wall-ok=" << (worst_wall < 50'000)
+       << " sleep10=" << (ms >= 10 && ms < 20);
+    return ss.str();
+}
+
+void TSC_CLOCK_BENCH()
+{
+    constexpr int N = 10'000'000;
+    TscClock& clock = TscClock::instance();
+    uint64_t sink = 0;
+    auto bench = [&](const char* what, auto&& fn) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) sink += fn();
+        const auto t1 = std::chrono::steady_clock::now();
+        std::cout << "TSC_CLOCK_BENCH " << what << ": "
+                  << static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) / N
+                  << " ns/call\n";
+    };
+    bench("now_tsc()", [] { return TscClock::now_tsc(); });
+    bench("tsc_to_ns(now_tsc())", [&] { return clock.tsc_to_ns(TscClock::now_tsc()); });
+    bench("clock_gettime(MONOTONIC_RAW)", [] { timespec ts{}; clock_gettime(CLOCK_MONOTONIC_RAW, &ts); return uint64_t(ts.tv_nsec); });
+    bench("clock_gettime(MONOTONIC)", [] { timespec ts{}; clock_gettime(CLOCK_MONOTONIC, &ts); return uint64_t(ts.tv_nsec); });
+    bench("steady_clock::now()", [] { return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()); });
+    std::cout << "(sink " << (sink & 1) << ")\n";
+}
@@ -0,0 +1,288 @@
+/*
+        Design notes
+
+        Warm restart
+
+        A crash or a deploy mid-session normally means a cold start: rebuild books from snapshots, re-warm pools and
+        refault gigabytes. PersistentArena keeps that state in a named hugetlbfs file (the mount dpdk-script.sh
+        creates) so the next process maps the very same pages and resumes in milliseconds: no snapshot replay, no
+        page faults, hugepages already reserved.
+
+        Layout
+
+        [ PersistHeader (4KB) | region 0 | region 1 | ... ]
+
+        The header carries magic, format version, the application's layout hash, the arena size, a restart
+        generation, a clean-shutdown flag and a sequence watermark, plus a directory of named regions (offset, size,
+        type hash). Static fields are covered by a checksum. On open, any mismatch - magic, version, layout hash,
+        size, checksum, or a region whose type changed - discards the file and starts cold. Never trust
+        half-understood state.
+
+        What can live in it
+
+        Anything trivially copyable and position independent: books, last-value caches, and OffsetFixedPool (whose
+        freelist is offsets, so it is valid at whatever address the new process maps the file). Raw pointers are not.
+
+        Sequence watermark
+
+        The hot path stores the sequence number of the last fully applied message with a release store (no RMW).
+        After a crash (clean flag not set) state up to the watermark is complete; a message past it may be half
+        applied, so updates must be idempotent per sequence (last-value writes are) and recovery requests a
+        retransmit from watermark + 1.
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+
+#include "shared-mem-pool.h"
+
+// ---------- persistent arena ----------
+class PersistentArena {
+public:
+    static constexpr uint64_t kMagic = 0x5741524D5F525354ull;   // "WARM_RST"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr std::size_t kMaxRegions = 32;
+    static constexpr std::size_t kNameLen = 32;
+
+    enum class State : uint32_t { Dirty = 0, Clean = 1 };
+
+    // Open the named arena, or create it if missing or if it fails validation.
+    // `layout_hash` identifies the application's data layout; bump it whenever a persisted struct changes.
+    PersistentArena(const std::string& name, std::size_t bytes, int numa_node, uint64_t layout_hash,
+                    ShmBacking backing = ShmBacking::HugeTlbFs)
+    : arena_(open(name, bytes, numa_node, layout_hash, backing, warm_))
+    {
+        hdr_ = arena_.at<PersistHeader>(0);
+        if (warm_) {
+            was_clean_ = hdr_->state.load(std::memory_order_acquire) == State::Clean;
+            hdr_->generation++;
+        } else {
+            format(layout_hash);
+        }
+        // Until close_clean(), a crash leaves the arena marked dirty.
+        hdr_->state.store(State::Dirty, std::memory_order_release);
+    }
+
+    PersistentArena(const PersistentArena&) = delete;
+    PersistentArena& operator=(const PersistentArena&) = delete;
+
+    // Orderly shutdown: record the final watermark and mark the state complete.
+    void close_clean(uint64_t seq) noexcept {
+        commit(seq);
+        hdr_->state.store(State::Clean, std::memory_order_release);
+    }
+
+    // Hot path: everything up to and including `seq` is applied. A plain release store.
+    void commit(uint64_t seq) noexcept { hdr_->watermark.store(seq, std::memory_order_release); }
+    uint64_t watermark() const noexcept { return hdr_->watermark.load(std::memory_order_acquire); }
+
+    bool warm() const noexcept { return warm_; }                // existing state was mapped
+    bool was_clean() const noexcept { return was_clean_; }      // ... and the previous owner shut down cleanly
+    uint64_t generation() const noexcept { return hdr_->generation; }
+    SharedNumaArena& shared() noexcept { return arena_; }
+
+    // Typed region `name` holding `count` T. Existing regions are returned as they were left; new ones are zeroed.
+    template <PoolStorable T>
+    T* region(std::string_view name, std::size_t count = 1) {
+        return arena_.at<T>(reserve(name, sizeof(T) * count, type_hash<T>(count)));
+    }
+
+    // OffsetFixedPool in region `name`; on a warm start the freelist and every live object are exactly as left.
+    template <PoolStorable T>
+    OffsetFixedPool<T> pool(std::string_view name, uint32_t capacity) {
+        bool fresh = false;
+        const uint64_t off = reserve(name, OffsetFixedPool<T>::bytes_needed(capacity), type_hash<T>(capacity), &fresh);
+        return fresh ? OffsetFixedPool<T>::create(arena_, capacity, off) : OffsetFixedPool<T>::attach(arena_, off);
+    }
+
+    static void remove(const std::string& name, ShmBacking backing = ShmBacking::HugeTlbFs) {
+        SharedNumaArena::unlink(name, backing);
+    }
+
+private:
+    struct Region {
+        char name[kNameLen];
+        uint64_t offset;
+        uint64_t size;
+        uint64_t type_hash;
+    };
+
+    struct alignas(4096) PersistHeader {
+        // static part, covered by checksum
+        uint64_t magic;
+        uint32_t version;
+        uint32_t region_count;
+        uint64_t layout_hash;
+        uint64_t size;
+        uint64_t next_free;                      // bump pointer for new regions
+        std::array<Region, kMaxRegions> regions;
+        uint64_t checksum;
+        // dynamic part
+        uint64_t generation;
+        CACHE_ALIGNED std::atomic<State> state;
+        CACHE_ALIGNED std::atomic<uint64_t> watermark;
+    };
+    static_assert(sizeof(PersistHeader) == 4096);
+
+    static uint64_t fnv1a(const void* p, std::size_t n, uint64_t h = 0xcbf29ce484222325ull) noexcept {
+        auto* b = static_cast<const unsigned char*>(p);
+        for (std::size_t i = 0; i < n; ++i) h = (h ^ b[i]) * 0x100000001b3ull;
+        return h;
+    }
+    static uint64_t checksum_of(const PersistHeader* h) noexcept {
+        return fnv1a(h, offsetof(PersistHeader, checksum));
+    }
+
+    template <class T>
+    static uint64_t type_hash(std::size_t count) noexcept {
+        const uint64_t v[] = {sizeof(T), alignof(T), count};
+        return fnv1a(v, sizeof(v));
+    }
+
+    static bool valid(SharedNumaArena& a, std::size_t size, uint64_t layout_hash) noexcept {
+        if (a.size() < sizeof(PersistHeader) || a.size() != size) return false;
+        auto* h = a.at<PersistHeader>(0);
+        return h->magic == kMagic && h->version == kVersion && h->layout_hash == layout_hash &&
+               h->size == size && h->checksum == checksum_of(h);
+    }
+
+    static SharedNumaArena open(const std::string& name, std::size_t bytes, int node, uint64_t layout_hash,
+                                ShmBacking backing, bool& warm)
+    {
+        const std::size_t align = backing == ShmBacking::HugeTlbFs ? HUGE_PAGE_SIZE : Prefault::SMALL_PAGE;
+        const std::size_t size = (bytes + sizeof(PersistHeader) + align - 1) & ~(align - 1);
+        if (SharedNumaArena::exists(name, backing)) {
+            auto a = SharedNumaArena::attach(name, backing);
+            if (valid(a, size, layout_hash)) {
+                a.populate();      // map the existing pages up front; contents untouched
+                warm = true;
+                return a;
+            }
+            std::cerr << "PersistentArena: " << name << " failed validation, starting cold\n";
+        }
+        warm = false;
+        return SharedNumaArena::create(name, size, node, backing);
+    }
+
+    void format(uint64_t layout_hash) noexcept {
+        std::memset(static_cast<void*>(hdr_), 0, sizeof(PersistHeader));
+        hdr_->magic = kMagic;
+        hdr_->version = kVersion;
+        hdr_->layout_hash = layout_hash;
+        hdr_->size = arena_.size();
+        hdr_->next_free = sizeof(PersistHeader);
+        hdr_->checksum = checksum_of(hdr_);
+    }
+
+    uint64_t reserve(std::string_view name, std::size_t bytes, uint64_t hash, bool* fresh = nullptr) {
+        if (name.size() >= kNameLen) throw std::runtime_error("PersistentArena: region name too long");
+        for (uint32_t i = 0; i < hdr_->region_count; ++i) {
+            Region& r = hdr_->regions[i];
+            if (name != r.name) continue;
+            if (r.type_hash != hash || r.size != bytes)
+                throw std::runtime_error("PersistentArena: region " + std::string(name) + " changed type; bump layout_hash");
+            if (fresh) *fresh = false;
+            return r.offset;
+        }
+        const uint64_t off = (hdr_->next_free + CACHELINE_SIZE - 1) & ~uint64_t{CACHELINE_SIZE - 1};
+        if (hdr_->region_count == kMaxRegions || off + bytes > hdr_->size)
+            throw std::runtime_error("PersistentArena: out of space for region " + std::string(name));
+
+        std::memset(arena_.at<std::byte>(off), 0, bytes);
+        Region& r = hdr_->regions[hdr_->region_count];
+        std::memset(r.name, 0, kNameLen);
+        name.copy(r.name, kNameLen - 1);
+        r.offset = off;
+        r.size = bytes;
+        r.type_hash = hash;
+        hdr_->next_free = off + bytes;
+        hdr_->region_count++;
+        hdr_->checksum = checksum_of(hdr_);
+        if (fresh) *fresh = true;
+        return off;
+    }
+
+    bool warm_{false};
+    bool was_clean_{false};
+    SharedNumaArena arena_;
+    PersistHeader* hdr_{nullptr};
+};
+
+// ---------- persisted last-value cache ----------
+struct CACHE_ALIGNED LastValue {
+    uint64_t seq;
+    uint64_t ts_ns;
+    Price    price;
+    uint32_t qty;
+    uint32_t instr_id;
+};
+
+template <std::size_t MaxInstr>
+class LastValueCache {
+public:
+    explicit LastValueCache(PersistentArena& arena) : values_(arena.region<LastValue>("lvc", MaxInstr)) {}
+
+    // Idempotent per sequence, so re-applying messages past a crash watermark is harmless.
+    void update(uint32_t instr, uint64_t seq, uint64_t ts_ns, Price price, uint32_t qty) noexcept {
+        LastValue& v = values_[instr];
+        if (seq <= v.seq) return;
+        v = LastValue{seq, ts_ns, price, qty, instr};
+    }
+    const LastValue& operator[](uint32_t instr) const noexcept { return values_[instr]; }
+
+private:
+    LastValue* values_;
+};
+
+// A child "session" fills an LVC and a pool of live orders, commits a watermark and dies without a clean close.
+// The parent then restarts on the same file and reports what survived.
+std::string WARM_RESTART_Test(ShmBacking backing = ShmBacking::PosixShm)
+{
+    const std::string name = "/hft-warm-restart-test";
+    constexpr uint64_t LAYOUT = 0x0001;
+    constexpr std::size_t BYTES = 4ULL * 1024 * 1024;
+    PersistentArena::remove(name, backing);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        PersistentArena arena(name, BYTES, 0, LAYOUT, backing);
+        LastValueCache<1024> lvc(arena);
+        auto orders = arena.pool<OrderMsg>("orders", 256);
+        for (uint64_t seq = 1; seq <= 42; ++seq) {
+            lvc.update(static_cast<uint32_t>(seq % 4), seq, seq * 1000, 100_px + Price::from_raw(static_cast<int64_t>(seq) * Price::SCALE / 4), 10);
+            arena.commit(seq);
+        }
+        for (uint64_t id = 1; id <= 3; ++id) orders.allocate()->order_id = id;
+        _exit(0);   // crash: no close_clean()
+    }
+    waitpid(pid, nullptr, 0);
+
+    auto t0 = std::chrono::steady_clock::now();
+    PersistentArena arena(name, BYTES, 0, LAYOUT, backing);
+    LastValueCache<1024> lvc(arena);
+    auto orders = arena.pool<OrderMsg>("orders", 256);
+    auto t1 = std::chrono::steady_clock::now();
+
+    uint32_t free_slots = 0;
+    while (orders.allocate()) ++free_slots;
+
+    std::stringstream ss;
+    ss << (arena.warm() ? "warm" : "cold") << (arena.was_clean() ? " clean" : " crashed")
+       << " seq=" << arena.watermark() << " px2=" << lvc[2].price << " live=" << 256 - free_slots;
+    std::cout << "WARM_RESTART reopen took "
+              << std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count() << " us\n";
+    arena.close_clean(arena.watermark());
+    PersistentArena::remove(name, backing);
+    return ss.str();
+}
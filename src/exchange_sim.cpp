@@ -0,0 +1,39 @@
+// Local exchange simulator: order entry on TCP, fills back on the same session, trades/book changes as TickerData.
+//   exchange-sim [port] [feed_ip] [feed_port] [feed_if]      defaults: 9000 239.255.0.1 12345 127.0.0.1
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+#include "exchange-sim.h"
+
+namespace {
+ExchangeSim* g_sim = nullptr;
+
+void on_signal(int) { if (g_sim) g_sim->stop(); }
+}
+
+int main(int argc, char** argv)
+{
+    ExchangeSimOptions opt;
+    if (argc > 1) opt.port = static_cast<uint16_t>(std::atoi(argv[1]));
+    if (argc > 2) opt.feed_ip = argv[2];
+    if (argc > 3) opt.feed_port = static_cast<uint16_t>(std::atoi(argv[3]));
+    if (argc > 4) opt.feed_if = argv[4];
+    try {
+        ExchangeSim sim(opt);
+        g_sim = &sim;
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        std::cout << "exchange-sim: orders on " << opt.bind_ip << ":" << sim.port() << ", feed to " << opt.feed_ip << ":"
+                  << opt.feed_port << std::endl;
+        sim.run();
+        g_sim = nullptr;
+        const ExchangeSimStats& s = sim.stats();
+        std::cout << "sessions=" << s.sessions << " messages=" << s.messages << " rejects=" << s.rejects << " trades=" << s.trades
+                  << " ticks=" << s.ticks << " datagrams=" << s.datagrams << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "exchange-sim: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+// Open-loop order load against an exchange (e.g. exchange-sim) over kernel TCP, one step per offered rate.
+//   order-load-gen [ip] [port] [rates,...] [seconds]      defaults: 127.0.0.1 9000 10000,50000,100000,200000 1
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "order-load-gen.h"
+
+int main(int argc, char** argv)
+{
+    const std::string ip = argc > 1 ? argv[1] : "127.0.0.1";
+    const auto port = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 9000);
+    std::vector<double> rates;
+    std::stringstream list(argc > 3 ? argv[3] : "10000,50000,100000,200000");
+    for (std::string r; std::getline(list, r, ',');) rates.push_back(std::atof(r.c_str()));
+    LoadGenOptions opt;
+    if (argc > 4) opt.seconds = std::atof(argv[4]);
+    try {
+        const auto steps = sweep([&] {
+            auto gw = std::make_unique<KernelOrderSession>(1 << 16);
+            gw->connect_to(ip, port);
+            return gw;
+        }, rates, opt);
+        for (const LoadGenResult& s : steps) std::cout << s.summary() << std::endl;
+        const std::size_t k = knee(steps);
+        std::cout << "knee: " << (k < steps.size() ? std::to_string(static_cast<uint64_t>(steps[k].offered)) + " msgs/s" : "not reached")
+                  << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "order-load-gen: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -8,8 +8,30 @@
 #include "io_uring_test_no_zero_copy.h"
 #include "io_uring_test_zero_copy.h"
 #include "dpdk-tbt-handler.h"
+#include "custom-allocator.h"
+#include "shared-mem-pool.h"
+#include "hot-alloc-interposer.h"
+#include "warm-restart.h"
+#include "hot-thread.h"
+#include "async-logger.h"
+#include "tsc-clock.h"
+#include "coro-event-loop.h"
+#include "disruptor-ring.h"
+#include "latency-histogram.h"
+#include "order-tracker.h"
+#include "risk-engine.h"
+#include "order-throttle.h"
+#include "fix-encoder.h"
+#include "fix-parser.h"
+#include "ouch-codec.h"
+#include "exchange-sim.h"
+#include "order-load-gen.h"
+#include "l3-order-book.h"
+#include "simd-l2-book.h"
+#include "fixed-price.h"
 #if 0 // mTCP no supported in ubuntu noble
 #include "mtcp-ordergateway-handler.h"
+#include "mtcp-sharded-gateway.h"
 #endif
 
 TEST_CASE("IO_URING_Test_NO_ZERO_COPY")
@@ -92,6 +114,243 @@ TEST_CASE("DPDK_TBT")
     REQUIRE(DPDK_TBT_Test(/*"7a:e3:16:0f:41:69"*/"3e:a4:7f:02:54:af", 0)=="Tick: instr=2 price=20.8 qty=20 ts_ns=0");
 }
 
+TEST_CASE("CUST_ALLOC_TEST")
+{
+    REQUIRE(CUST_ALLOC_TEST()==0);
+}
+
+TEST_CASE("CUST_ALLOC_GUARD_TEST")
+{
+    // the write-after-free probe is skipped under ASan, which reports the scribble itself
+#ifdef HFT_POOL_ASAN
+    REQUIRE(CUST_ALLOC_GUARD_TEST()=="double_free,foreign_pointer,canary_clobbered");
+#else
+    REQUIRE(CUST_ALLOC_GUARD_TEST()=="double_free,foreign_pointer,canary_clobbered,write_after_free");
+#endif
+}
+
+TEST_CASE("NUMA_PREFAULT_BENCH", "[.][bench]")
+{
+    // arena startup time vs size, serial touch vs parallel node-pinned populate
+    NUMA_PREFAULT_BENCH();
+}
+
+TEST_CASE("SHM_POOL_TEST")
+{
+    // forks a consumer process that attaches the pool by name and frees what the parent allocated
+    REQUIRE(SHM_POOL_Test()=="ok");
+}
+
+TEST_CASE("SHM_POOL_BENCH", "[.][bench]")
+{
+    // run explicitly: ./hft-programs "[bench]"
+    SHM_POOL_BENCH();
+}
+
+TEST_CASE("WARM_RESTART_TEST")
+{
+    // /dev/shm stands in for the hugetlbfs mount so the test runs without dpdk-script.sh
+    REQUIRE(WARM_RESTART_Test(ShmBacking::PosixShm)=="warm crashed seq=42 px2=110.5 live=3");
+}
+
+TEST_CASE("HOT_THREAD_TEST")
+{
+    REQUIRE(HOT_THREAD_Test()=="dup-refused cpu-ok=1 slack-ok=1 isolcpus-rule=1 offline-refused");
+}
+
+TEST_CASE("TSC_CLOCK_TEST")
+{
+    REQUIRE(TSC_CLOCK_Test()=="monotonic=1 mono-ok=1 wall-ok=1 sleep10=1");
+}
+
+TEST_CASE("TSC_CLOCK_BENCH", "[.][bench]")
+{
+    TSC_CLOCK_BENCH();
+}
+
+TEST_CASE("CORO_LOOP_TEST")
+{
+    REQUIRE(CORO_LOOP_Test()=="PING|ORDER|CANCEL sum=5 slept=1 frames=0 refused=1");
+}
+
+TEST_CASE("CORO_LOOP_BENCH", "[.][bench]")
+{
+    CORO_LOOP_BENCH();
+}
+
+TEST_CASE("DISRUPTOR_TEST")
+{
+    REQUIRE(DISRUPTOR_Test()=="order=1 chain=1 observed=1 mp=15000 fifo=1");
+}
+
+TEST_CASE("DISRUPTOR_BENCH", "[.][bench]")
+{
+    DISRUPTOR_BENCH();
+}
+
+TEST_CASE("LATENCY_HIST_TEST")
+{
+    REQUIRE(LATENCY_HIST_Test()=="edges=1 n=10000 min=1 max=10000 p50=1 p99=1 mean=5000.5");
+}
+
+TEST_CASE("ORDER_TRACKER_TEST")
+{
+    REQUIRE(ORDER_TRACKER_Test()=="1:acked 2:acked 1:partially-filled 1:filled 3:acked 2:cancelled 4:rejected "
+                                  "unknown=2 bad=1 open=1 acks=3 fills=1 dup=1 table=1");
+}
+
+TEST_CASE("ORDER_TRACKER_BENCH", "[.][bench]")
+{
+    ORDER_TRACKER_BENCH();
+}
+
+TEST_CASE("RISK_TEST")
+{
+    REQUIRE(RISK_Test()=="ok max-qty max-notional band ok ok position ok open-orders ok ok throttled killed unknown");
+}
+
+TEST_CASE("RISK_BENCH", "[.][bench]")
+{
+    RISK_BENCH();
+}
+
+TEST_CASE("ORDER_THROTTLE_TEST")
+{
+    REQUIRE(ORDER_THROTTLE_Test()=="burst=5 refill=1 window=3 exact=1 admits=1010 blocked=2 overdrawn=0/0/5 queued=4 order=12345 p100-delay-ms=40");
+}
+
+TEST_CASE("ORDER_THROTTLE_BENCH", "[.][bench]")
+{
+    ORDER_THROTTLE_BENCH();
+}
+
+TEST_CASE("ORDER_AMEND_TEST")
+{
+    REQUIRE(ORDER_AMEND_Test()=="reverted=1 1:acked 3:replacing 3:partially-filled 3:partially-filled 3:cancelled "
+                               "in-place=1 both-ids=1 new-terms=1 cancel=1 unknown-refused=1 replaced=1 "
+                               "replace-rejected=1 cancel-rejected=1 open=0 cancel-before-ack=1");
+}
+
+TEST_CASE("ORDER_AMEND_BENCH", "[.][bench]")
+{
+    ORDER_AMEND_BENCH();
+}
+
+TEST_CASE("FIX_ENCODER_TEST")
+{
+    REQUIRE(FIX_ENCODER_Test()=="8=FIX.4.2|9=178|35=D|49=HFTL|56=XCHG|34=0000000007|52=20240102-03:04:05.678|"
+                                "11=00000000000123456789|21=1|55=0000001001|54=1|60=20240102-03:04:05.678|"
+                                "38=0000000050|40=2|44=00000101.25000000|59=0|10=211| "
+                                "digits=1 reference=1 refused=1 seq=2008");
+}
+
+TEST_CASE("FIX_ENCODER_BENCH", "[.][bench]")
+{
+    FIX_ENCODER_BENCH();
+}
+
+TEST_CASE("FIX_PARSER_TEST")
+{
+    REQUIRE(FIX_PARSER_Test()=="A100/0@10125 F101/10@10225 F102/20@10325 F103/30@10425 C104/40@10525 R105/50@10625 "
+                               "A106/60@10725 | splits=1 bytewise=1 messages=7 bad-checksum=1 malformed=1 resync=100,101,2/0");
+}
+
+TEST_CASE("FIX_PARSER_BENCH", "[.][bench]")
+{
+    FIX_PARSER_BENCH();
+}
+
+TEST_CASE("OUCH_CODEC_TEST")
+{
+    REQUIRE(OUCH_CODEC_Test()=="enter-bytes=1 round-trip=1 off-grid=1 splits=1 A7/100 E7/40 E7/60 sizes=27/29/13/35/37/0");
+}
+
+TEST_CASE("OUCH_CODEC_BENCH", "[.][bench]")
+{
+    OUCH_CODEC_BENCH();
+}
+
+TEST_CASE("MATCHING_ENGINE_TEST")
+{
+    REQUIRE(MATCHING_ENGINE_Test()=="1x4:10@10000 2x4:10@10000 3x4:5@10050 filled=1 replaced=1 leaves=3 wrong-owner=1 dup=1 bid=99x4 ask=101x3 cancel=1 open=1 off-tick=1 out-of-band=1 reference=1");
+}
+
+TEST_CASE("MATCHING_ENGINE_BENCH", "[.][bench]")
+{
+    MATCHING_ENGINE_BENCH();
+}
+
+TEST_CASE("EXCHANGE_SIM_TEST")
+{
+    REQUIRE(EXCHANGE_SIM_Test()=="A1/10 A2/15 F2/10@100/5 F1/10@100/0 A3/10 C3/0 R1/0 A4/1 | 10@100 10@100 0@100 5@100 0@100 10@99 0@99 1@98 0@98 open=0 trades=1 rejects=1");
+}
+
+TEST_CASE("ORDER_LOAD_GEN_TEST")
+{
+    REQUIRE(ORDER_LOAD_GEN_Test()=="steps=2 scheduled=1 answered=1 mix=1 measured=1");
+}
+
+TEST_CASE("ORDER_LOAD_GEN_BENCH", "[.][bench]")
+{
+    // offered-rate sweep against an in-process exchange-sim; prints per-step histograms and the knee
+    ORDER_LOAD_GEN_BENCH();
+}
+
+TEST_CASE("L3_BOOK_TEST")
+{
+    REQUIRE(L3_BOOK_Test()=="bid=10000x15/2 ask=10002x3/1 q=1:6,2:5 q=1:6,2:3 q=2:3,1:9 bid=10001x3/1 bid=10000x9/1 bid=9999x7/1 "
+                            "dup=1 unknown=1 unlevelled=1 open=3 reference=1");
+}
+
+TEST_CASE("L3_BOOK_BENCH", "[.][bench]")
+{
+    // replay of a synthetic feed day, pooled L3 book vs std::map book
+    L3_BOOK_BENCH();
+}
+
+TEST_CASE("SIMD_L2_BOOK_TEST")
+{
+    REQUIRE(SIMD_L2_BOOK_Test()=="bids=10000x5,9999x10,9990x7 asks=10001x4,10002x3 bids=10000x5,9999x12,9990x7 asks=10002x3 "
+                                 "unknown=1 bad-tick=1 at=7 spill=50/1051/100 rank=1 reference=1");
+}
+
+TEST_CASE("SIMD_L2_BOOK_BENCH", "[.][bench]")
+{
+    // L2 updates/s per depth profile, block search over ticks vs binary search over doubles
+    SIMD_L2_BOOK_BENCH();
+}
+
+TEST_CASE("PRICE_TEST")
+{
+    REQUIRE(PRICE_Test()=="ticks=1/10125 off-tick=1 negative=1 quarter=1/403,10 exact=1 wire=1012500/101.25 specs=0.25/0.01 "
+                          "parse=1/101.25,1/-0.5,1/7,1/1 refused=111111 fmt=100|0.1|-20.8 double-refused=1111/1 round-trip=1");
+}
+
+TEST_CASE("PRICE_BENCH", "[.][bench]")
+{
+    // ns per parse / format / tick conversion, fixed-point vs strtod / snprintf / double
+    PRICE_BENCH();
+}
+
+TEST_CASE("ASYNC_LOGGER_TEST")
+{
+    REQUIRE(ASYNC_LOGGER_Test()=="done|from thread 2|order id=7 px=101.25 side=B|payload hello");
+}
+
+TEST_CASE("ASYNC_LOGGER_BENCH", "[.][bench]")
+{
+    ASYNC_LOGGER_BENCH();
+}
+
+TEST_CASE("HOT_ALLOC_TEST")
+{
+#ifdef HFT_HOT_ALLOC_INTERPOSE
+    REQUIRE(HOT_ALLOC_Test()=="served=6401 fallbacks=1 heaps=8 owned=1");
+#else
+    REQUIRE(HOT_ALLOC_Test()=="served=6400 fallbacks=1 heaps=8 owned=1");
+#endif
+}
+
 #if 0
 TEST_CASE("MTCP_OG_TEST")
 {
@@ -111,12 +370,46 @@ TEST_CASE("MTCP_OG_TEST")
     using namespace std::chrono_literals;
     std::thread t{[](){
         std::this_thread::sleep_for(3s);
-        // running a localhost server at port 9000 to which mTCP will write the data to. incoming data will be written to a output.dat file
-        // for inspection
-        system("socat TCP-LISTEN:9000,bind=localhost,fork open:output.dat,creat");
+        // local exchange at port 9000: acks and fills the gateway's orders and publishes the trades on 239.255.0.1:12345
+        system("./exchange-sim 9000");
     }};
     t.detach();
     MTCP_OG_TEST();
     // REQUIRE(output.dat);
 }
+
+TEST_CASE("MTCP_MUX_TEST")
+{
+    using namespace std::chrono_literals;
+    std::thread t{[](){
+        // echo server for the gateway's sessions
+        system("socat TCP-LISTEN:9001,bind=localhost,reuseaddr,fork EXEC:cat");
+    }};
+    t.detach();
+    std::this_thread::sleep_for(1s);
+    REQUIRE(MTCP_MUX_Test("127.0.0.1", 9001, 4)=="sent=4 echoed=4");
+}
+
+TEST_CASE("MTCP_SHARD_TEST")
+{
+    using namespace std::chrono_literals;
+    std::thread t{[](){
+        system("socat TCP-LISTEN:9002,bind=localhost,reuseaddr,fork EXEC:cat");
+    }};
+    t.detach();
+    std::this_thread::sleep_for(1s);
+    REQUIRE(MTCP_SHARD_Test("127.0.0.1", 9002, 4)=="sessions=4 echoed=4 owner-only=1");
+}
+
+TEST_CASE("MTCP_SHARD_BENCH", "[.][bench]")
+{
+    using namespace std::chrono_literals;
+    std::thread t{[](){
+        system("socat TCP-LISTEN:9003,bind=localhost,reuseaddr,fork EXEC:cat");
+    }};
+    t.detach();
+    std::this_thread::sleep_for(1s);
+    // needs num_cores = 4 in mtcp.conf (and 4 NIC queues)
+    MTCP_SHARD_BENCH("127.0.0.1", 9003, {0, 1, 2, 3});
+}
 #endif